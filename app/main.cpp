@@ -8,6 +8,9 @@
 #include "editor/windows.h"
 
 int main(int argc, char *argv[]) {
+    // Where QSettings keeps state between launches.
+    QApplication::setOrganizationName("ArcheGraphics");
+    QApplication::setApplicationName("HydraViewer");
     QApplication app{argc, argv};
     {
         vox::Windows window(1280u, 720u);
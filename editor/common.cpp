@@ -168,6 +168,14 @@ std::string to_constants(PickModes value) {
     }
 }
 
+std::string to_constants(RegionSelectModes value) {
+    switch (value) {
+        case RegionSelectModes::MARQUEE: return "Marquee";
+        case RegionSelectModes::LASSO: return "Lasso";
+        case RegionSelectModes::Count: return "regionSelectMode";
+    }
+}
+
 std::string to_constants(SelectionHighlightModes value) {
     switch (value) {
         case SelectionHighlightModes::NEVER: return "Never";
@@ -177,6 +185,14 @@ std::string to_constants(SelectionHighlightModes value) {
     }
 }
 
+std::string to_constants(PlaybackModes value) {
+    switch (value) {
+        case PlaybackModes::REALTIME: return "Realtime";
+        case PlaybackModes::EVERY_FRAME: return "Every frame";
+        case PlaybackModes::Count: return "playbackMode";
+    }
+}
+
 std::string to_constants(CameraMaskModes value) {
     switch (value) {
         case CameraMaskModes::NONE: return "none";
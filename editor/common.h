@@ -161,6 +161,15 @@ enum class PickModes {
 };
 std::string to_constants(PickModes value);
 
+/// Shape of the region dragged out to select many prims at once.
+enum class RegionSelectModes {
+    MARQUEE,
+    LASSO,
+
+    Count
+};
+std::string to_constants(RegionSelectModes value);
+
 enum class SelectionHighlightModes {
     NEVER,
     ONLY_WHEN_PAUSED,
@@ -170,6 +179,17 @@ enum class SelectionHighlightModes {
 };
 std::string to_constants(SelectionHighlightModes value);
 
+/// How playback maps wall-clock time to time codes.
+enum class PlaybackModes {
+    /// Follows the timecode rate, dropping frames that can't be rendered in time.
+    REALTIME,
+    /// Shows every time code once, however long each takes.
+    EVERY_FRAME,
+
+    Count
+};
+std::string to_constants(PlaybackModes value);
+
 enum class CameraMaskModes {
     NONE,
     PARTIAL,
@@ -5,19 +5,33 @@
 //  property of any third parties.
 
 #include "framerate.h"
+#include <algorithm>
+#include <cmath>
 
 namespace vox {
+namespace {
+/// Nearest-rank percentile of `values`; reorders `values`.
+double percentile(std::vector<double> &values, double p) {
+    auto rank = size_t(std::ceil(p * double(values.size())));
+    auto nth = values.begin() + std::clamp<size_t>(rank, 1, values.size()) - 1;
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+}// namespace
 
-Framerate::Framerate(size_t n) noexcept
+Framerate::Framerate(size_t n, size_t capacity) noexcept
     : _history_size{n} {
-    _durations.reserve(n);
-    _frames.reserve(n);
+    capacity = std::max(capacity, n);
+    _durations.resize(capacity);
+    _frames.resize(capacity);
+    _scratch.reserve(capacity);
     _last = Clock::now();
 }
 
 void Framerate::clear() noexcept {
-    _durations.clear();
-    _frames.clear();
+    _head = 0;
+    _size = 0;
+    _total_over_budget = 0;
     _last = Clock::now();
 }
 
@@ -28,25 +42,64 @@ double Framerate::duration() const noexcept {
 }
 
 void Framerate::record(size_t frame_count) noexcept {
-    if (_durations.size() == _history_size) {
-        _durations.erase(_durations.begin());
-        _frames.erase(_frames.begin());
+    auto dt = duration();
+    _durations[_head] = dt;
+    _frames[_head] = frame_count;
+    _head = (_head + 1) % _durations.size();
+    _size = std::min(_size + 1, _durations.size());
+    if (frame_count > 0 && dt / double(frame_count) > _budget) {
+        _total_over_budget++;
     }
-    using namespace std::chrono_literals;
-    _durations.emplace_back(duration());
-    _frames.emplace_back(frame_count);
     _last = Clock::now();
 }
 
+double Framerate::_frameTime(size_t i) const noexcept {
+    auto index = (_head + _durations.size() - 1 - i) % _durations.size();
+    return _durations[index] / double(std::max<size_t>(_frames[index], 1));
+}
+
 double Framerate::report() const noexcept {
-    if (_durations.empty()) { return 0.0; }
+    if (_size == 0) { return 0.0; }
     auto total_duration = 0.0;
     auto total_frame_count = static_cast<size_t>(0u);
-    for (auto i = 0u; i < _durations.size(); i++) {
-        total_duration += _durations[i];
-        total_frame_count += _frames[i];
+    auto count = std::min(_size, _history_size);
+    for (auto i = 0u; i < count; i++) {
+        auto index = (_head + _durations.size() - 1 - i) % _durations.size();
+        total_duration += _durations[index];
+        total_frame_count += _frames[index];
     }
     return static_cast<double>(total_frame_count) / total_duration;
 }
 
+Framerate::Statistics Framerate::statistics(size_t window) const {
+    Statistics stats;
+    stats.count = std::min(window, _size);
+    if (stats.count == 0) { return stats; }
+
+    _scratch.clear();
+    auto total = 0.0;
+    for (size_t i = 0; i < stats.count; i++) {
+        auto dt = _frameTime(i);
+        _scratch.push_back(dt);
+        total += dt;
+        stats.max = std::max(stats.max, dt);
+        if (dt > _budget) {
+            stats.overBudget++;
+        }
+    }
+    stats.mean = total / double(stats.count);
+    stats.p50 = percentile(_scratch, 0.50);
+    stats.p95 = percentile(_scratch, 0.95);
+    stats.p99 = percentile(_scratch, 0.99);
+    return stats;
+}
+
+void Framerate::history(std::vector<float> &out, size_t count) const {
+    count = std::min(count, _size);
+    out.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        out[count - 1 - i] = float(_frameTime(i) * 1e3);
+    }
+}
+
 }// namespace vox
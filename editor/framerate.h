@@ -18,18 +18,53 @@ public:
     using Clock = std::chrono::steady_clock;
     using Timepoint = Clock::time_point;
 
+    /// Frame time statistics in seconds over a window of recent frames.
+    struct Statistics {
+        size_t count{0};
+        double mean{0.0};
+        double p50{0.0};
+        double p95{0.0};
+        double p99{0.0};
+        double max{0.0};
+        size_t overBudget{0};
+    };
+
 private:
+    // Ring buffers of per-record durations and frame counts.
     std::vector<double> _durations;
     std::vector<size_t> _frames;
+    size_t _head{0};
+    size_t _size{0};
     Timepoint _last;
     size_t _history_size;
+    double _budget{1.0 / 60.0};
+    size_t _total_over_budget{0};
+    mutable std::vector<double> _scratch;
+
+    /// Per-frame duration of the i-th most recent record, 0 being the latest.
+    [[nodiscard]] double _frameTime(size_t i) const noexcept;
 
 public:
-    explicit Framerate(size_t n = 5) noexcept;
+    /// `n` records are averaged by report(); up to `capacity` records are kept for statistics.
+    explicit Framerate(size_t n = 5, size_t capacity = 1024) noexcept;
     void clear() noexcept;
     void record(size_t frame_count = 1u) noexcept;
     [[nodiscard]] double duration() const noexcept;
     [[nodiscard]] double report() const noexcept;
+    /// Per-frame duration of the latest record, 0 if nothing was recorded yet.
+    [[nodiscard]] double lastFrameTime() const noexcept { return _size ? _frameTime(0) : 0.0; }
+
+    /// Frames slower than `seconds` are counted as over budget.
+    void setBudget(double seconds) noexcept { _budget = seconds; }
+    [[nodiscard]] double budget() const noexcept { return _budget; }
+    /// Over-budget frames since the last clear().
+    [[nodiscard]] size_t totalOverBudget() const noexcept { return _total_over_budget; }
+
+    [[nodiscard]] size_t capacity() const noexcept { return _durations.size(); }
+    /// Statistics over the `window` most recent frames.
+    [[nodiscard]] Statistics statistics(size_t window) const;
+    /// Writes up to `count` recent frame times in milliseconds, oldest first.
+    void history(std::vector<float> &out, size_t count) const;
 };
 
 }// namespace vox
@@ -0,0 +1,219 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "attribute_query_cache.h"
+
+#include <pxr/base/gf/range1f.h>
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec4f.h>
+#include <pxr/usd/usdGeom/boundable.h>
+#include <pxr/usd/usdGeom/camera.h>
+#include <pxr/usd/usdGeom/imageable.h>
+#include <pxr/usd/usdGeom/tokens.h>
+
+namespace {
+/// Entries are keyed by instance proxy paths, which edits to prototypes don't name.
+bool isInPrototype(const pxr::SdfPath &path) {
+    auto prefixes = path.GetPrefixes();
+    return !prefixes.empty() && pxr::UsdPrim::IsPrototypePath(prefixes.front());
+}
+}// namespace
+
+void AttributeQueryCache::setStage(const pxr::UsdStageRefPtr &stage) {
+    _stage = stage;
+    clear();
+}
+
+void AttributeQueryCache::clear() {
+    _attributes.clear();
+    _xforms.clear();
+    _prefetched.reset();
+}
+
+void AttributeQueryCache::setPrefetchedFrame(std::shared_ptr<const PrefetchedFrame> frame) {
+    _prefetched = std::move(frame);
+}
+
+const pxr::VtValue *AttributeQueryCache::_prefetchedValue(const pxr::UsdAttribute &attr, pxr::UsdTimeCode time) const {
+    if (!_prefetched || time.IsDefault() || _prefetched->time != time.GetValue()) {
+        return nullptr;
+    }
+    return _prefetched->value(attr.GetPath());
+}
+
+void AttributeQueryCache::processChanges(const pxr::UsdNotice::ObjectsChanged &notice) {
+    _prefetched.reset();
+    auto eraseProperty = [this](const pxr::SdfPath &path) {
+        _attributes.erase(path);
+        if (pxr::UsdGeomXformable::IsTransformationAffectedByAttrNamed(path.GetNameToken())) {
+            _xforms.erase(path.GetPrimPath());
+        }
+    };
+
+    for (const auto &path : notice.GetResyncedPaths()) {
+        if (path == pxr::SdfPath::AbsoluteRootPath() || isInPrototype(path)) {
+            clear();
+            return;
+        }
+        if (path.IsPropertyPath()) {
+            eraseProperty(path);
+        } else {
+            _eraseSubtree(path);
+        }
+    }
+
+    // Value edits; the query of an edited attribute may have stopped (or
+    // started) being time varying, so it is rebuilt rather than re-read.
+    for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+        if (isInPrototype(path)) {
+            clear();
+            return;
+        }
+        if (path.IsPropertyPath()) {
+            eraseProperty(path);
+        }
+    }
+}
+
+void AttributeQueryCache::_eraseSubtree(const pxr::SdfPath &path) {
+    for (auto it = _attributes.begin(); it != _attributes.end();) {
+        it = it->first.HasPrefix(path) ? _attributes.erase(it) : std::next(it);
+    }
+    for (auto it = _xforms.begin(); it != _xforms.end();) {
+        it = it->first.HasPrefix(path) ? _xforms.erase(it) : std::next(it);
+    }
+}
+
+AttributeQueryCache::Entry &AttributeQueryCache::_entry(const pxr::UsdAttribute &attr) {
+    auto [it, inserted] = _attributes.try_emplace(attr.GetPath());
+    if (inserted) {
+        it->second.query = pxr::UsdAttributeQuery(attr);
+        it->second.timeVarying = it->second.query.ValueMightBeTimeVarying();
+    }
+    return it->second;
+}
+
+bool AttributeQueryCache::mightBeTimeVarying(const pxr::UsdAttribute &attr) {
+    return _entry(attr).timeVarying;
+}
+
+pxr::TfToken AttributeQueryCache::visibility(const pxr::UsdPrim &prim, pxr::UsdTimeCode time) {
+    for (auto p = prim; p && !p.IsPseudoRoot(); p = p.GetParent()) {
+        pxr::UsdGeomImageable imageable{p};
+        if (!imageable) {
+            continue;
+        }
+        pxr::TfToken value;
+        if (get(imageable.GetVisibilityAttr(), time, &value) && value == pxr::UsdGeomTokens->invisible) {
+            return pxr::UsdGeomTokens->invisible;
+        }
+    }
+    return pxr::UsdGeomTokens->inherited;
+}
+
+AttributeQueryCache::XformEntry &AttributeQueryCache::_xformEntry(const pxr::UsdPrim &prim) {
+    auto [it, inserted] = _xforms.try_emplace(prim.GetPath());
+    if (inserted) {
+        if (pxr::UsdGeomXformable xformable{prim}) {
+            it->second.query = pxr::UsdGeomXformable::XformQuery(xformable);
+            it->second.xformable = true;
+            it->second.timeVarying = it->second.query.TransformMightBeTimeVarying();
+        }
+    }
+    return it->second;
+}
+
+bool AttributeQueryCache::_localTransform(const pxr::UsdPrim &prim, pxr::UsdTimeCode time, pxr::GfMatrix4d *xform) {
+    auto &entry = _xformEntry(prim);
+    if (!entry.xformable) {
+        return false;
+    }
+    if (entry.timeVarying) {
+        if (_prefetched && !time.IsDefault() && _prefetched->time == time.GetValue()) {
+            if (auto *prefetched = _prefetched->localTransform(prim.GetPath())) {
+                *xform = *prefetched;
+                return true;
+            }
+        }
+        entry.query.GetLocalTransformation(xform, time);
+        return true;
+    }
+    if (!entry.hasStaticValue) {
+        entry.query.GetLocalTransformation(&entry.staticValue, time);
+        entry.hasStaticValue = true;
+    }
+    *xform = entry.staticValue;
+    return true;
+}
+
+pxr::GfMatrix4d AttributeQueryCache::localToWorld(const pxr::UsdPrim &prim, pxr::UsdTimeCode time) {
+    pxr::GfMatrix4d result{1.0};
+    for (auto p = prim; p && !p.IsPseudoRoot(); p = p.GetParent()) {
+        pxr::GfMatrix4d local;
+        if (!_localTransform(p, time, &local)) {
+            continue;
+        }
+        result *= local;
+        if (_xformEntry(p).query.GetResetXformStack()) {
+            break;
+        }
+    }
+    return result;
+}
+
+bool AttributeQueryCache::extent(const pxr::UsdPrim &prim, pxr::UsdTimeCode time, pxr::VtVec3fArray *extent) {
+    pxr::UsdGeomBoundable boundable{prim};
+    if (!boundable) {
+        return false;
+    }
+    return get(boundable.GetExtentAttr(), time, extent) && extent->size() == 2;
+}
+
+pxr::GfCamera AttributeQueryCache::camera(const pxr::UsdPrim &prim, pxr::UsdTimeCode time) {
+    pxr::UsdGeomCamera schema{prim};
+    pxr::GfCamera camera;
+    camera.SetTransform(localToWorld(prim, time));
+
+    pxr::TfToken projection;
+    if (get(schema.GetProjectionAttr(), time, &projection)) {
+        camera.SetProjection(projection == pxr::UsdGeomTokens->orthographic ? pxr::GfCamera::Orthographic
+                                                                           : pxr::GfCamera::Perspective);
+    }
+
+    float value;
+    if (get(schema.GetHorizontalApertureAttr(), time, &value)) {
+        camera.SetHorizontalAperture(value);
+    }
+    if (get(schema.GetVerticalApertureAttr(), time, &value)) {
+        camera.SetVerticalAperture(value);
+    }
+    if (get(schema.GetHorizontalApertureOffsetAttr(), time, &value)) {
+        camera.SetHorizontalApertureOffset(value);
+    }
+    if (get(schema.GetVerticalApertureOffsetAttr(), time, &value)) {
+        camera.SetVerticalApertureOffset(value);
+    }
+    if (get(schema.GetFocalLengthAttr(), time, &value)) {
+        camera.SetFocalLength(value);
+    }
+
+    pxr::GfVec2f clippingRange;
+    if (get(schema.GetClippingRangeAttr(), time, &clippingRange)) {
+        camera.SetClippingRange(pxr::GfRange1f(clippingRange[0], clippingRange[1]));
+    }
+    pxr::VtVec4fArray clippingPlanes;
+    if (get(schema.GetClippingPlanesAttr(), time, &clippingPlanes)) {
+        camera.SetClippingPlanes({clippingPlanes.cbegin(), clippingPlanes.cend()});
+    }
+
+    if (get(schema.GetFStopAttr(), time, &value)) {
+        camera.SetFStop(value);
+    }
+    if (get(schema.GetFocusDistanceAttr(), time, &value)) {
+        camera.SetFocusDistance(value);
+    }
+    return camera;
+}
@@ -0,0 +1,102 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/camera.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/usd/usd/attributeQuery.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/xformable.h>
+#include <memory>
+#include <unordered_map>
+#include "frame_prefetcher.h"
+
+/// Per-stage cache of attribute queries for the reads the viewer repeats
+/// every frame: cameras, visibility, transforms and extents. Value
+/// resolution is done once per attribute; attributes that can't vary over
+/// time are read once and served from the cache after that. Entries are
+/// dropped by change notices, so edits are picked up on the next read.
+/// Time-varying values come from the prefetched frame when it has them.
+class AttributeQueryCache {
+public:
+    void setStage(const pxr::UsdStageRefPtr &stage);
+
+    /// Drops every entry.
+    void clear();
+
+    /// Drops the entries a stage edit may have made stale.
+    void processChanges(const pxr::UsdNotice::ObjectsChanged &notice);
+
+    /// Frame resolved ahead by the FramePrefetcher, used when its time is read.
+    void setPrefetchedFrame(std::shared_ptr<const PrefetchedFrame> frame);
+
+    /// Value of `attr` at `time`. Returns false if it has no value of type T.
+    template<typename T>
+    bool get(const pxr::UsdAttribute &attr, pxr::UsdTimeCode time, T *value) {
+        auto &entry = _entry(attr);
+        if (entry.timeVarying) {
+            if (auto *prefetched = _prefetchedValue(attr, time); prefetched && prefetched->IsHolding<T>()) {
+                *value = prefetched->UncheckedGet<T>();
+                return true;
+            }
+            return entry.query.Get(value, time);
+        }
+        if (!entry.hasStaticValue) {
+            entry.query.Get(&entry.staticValue, time);
+            entry.hasStaticValue = true;
+        }
+        if (!entry.staticValue.IsHolding<T>()) {
+            return false;
+        }
+        *value = entry.staticValue.UncheckedGet<T>();
+        return true;
+    }
+
+    bool mightBeTimeVarying(const pxr::UsdAttribute &attr);
+
+    /// Visibility computed through the ancestors, invisible or inherited.
+    pxr::TfToken visibility(const pxr::UsdPrim &prim, pxr::UsdTimeCode time);
+
+    pxr::GfMatrix4d localToWorld(const pxr::UsdPrim &prim, pxr::UsdTimeCode time);
+
+    /// Authored extent of a boundable prim.
+    bool extent(const pxr::UsdPrim &prim, pxr::UsdTimeCode time, pxr::VtVec3fArray *extent);
+
+    /// Same as UsdGeomCamera::GetCamera, read through cached queries.
+    pxr::GfCamera camera(const pxr::UsdPrim &prim, pxr::UsdTimeCode time);
+
+private:
+    struct Entry {
+        pxr::UsdAttributeQuery query;
+        bool timeVarying{false};
+        bool hasStaticValue{false};
+        pxr::VtValue staticValue;
+    };
+
+    struct XformEntry {
+        pxr::UsdGeomXformable::XformQuery query;
+        bool xformable{false};
+        bool timeVarying{false};
+        bool hasStaticValue{false};
+        pxr::GfMatrix4d staticValue{1.0};
+    };
+
+    Entry &_entry(const pxr::UsdAttribute &attr);
+    const pxr::VtValue *_prefetchedValue(const pxr::UsdAttribute &attr, pxr::UsdTimeCode time) const;
+    XformEntry &_xformEntry(const pxr::UsdPrim &prim);
+    /// Local transform of `prim`, false if it isn't xformable.
+    bool _localTransform(const pxr::UsdPrim &prim, pxr::UsdTimeCode time, pxr::GfMatrix4d *xform);
+    void _eraseSubtree(const pxr::SdfPath &path);
+
+    pxr::UsdStageRefPtr _stage;
+    std::unordered_map<pxr::SdfPath, Entry, pxr::SdfPath::Hash> _attributes;
+    std::unordered_map<pxr::SdfPath, XformEntry, pxr::SdfPath::Hash> _xforms;
+    std::shared_ptr<const PrefetchedFrame> _prefetched;
+};
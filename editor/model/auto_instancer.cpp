@@ -0,0 +1,190 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "auto_instancer.h"
+
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/pcp/layerStack.h>
+#include <pxr/usd/pcp/primIndex.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/gprim.h>
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+namespace {
+void combine(size_t &hash, size_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+}
+
+/// True if `node` is a reference or payload authored on the prim itself, or below one.
+bool isInsideAsset(pxr::PcpNodeRef node) {
+    for (; node; node = node.GetParentNode()) {
+        auto arc = node.GetArcType();
+        if ((arc == pxr::PcpArcTypeReference || arc == pxr::PcpArcTypePayload) && !node.IsDueToAncestor()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// True if a layer stack above the references and payloads that bring in
+/// `prim` overrides prims below it: the root layer stack, or that of an
+/// assembly referencing it. Instancing drops those overrides from the
+/// prototype, so copies that hash the same could draw differently.
+bool hasOverridesAbove(const pxr::UsdPrim &prim) {
+    auto range = prim.GetPrimIndex().GetNodeRange();
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto &node = *it;
+        if (isInsideAsset(node)) {
+            continue;
+        }
+        for (const auto &layer : node.GetLayerStack()->GetLayers()) {
+            if (auto spec = layer->GetPrimAtPath(node.GetPath()); spec && !spec->GetNameChildren().empty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/// Hash of the composed content below `root`, with paths relative to it. None
+/// if the subtree can't be instanced as is, or has no geometry to share.
+std::optional<size_t> hashSubtree(const pxr::UsdPrim &root) {
+    const auto &rootPath = root.GetPath();
+    size_t hash = 0;
+    bool hasGeometry = false;
+    for (const auto &prim : pxr::UsdPrimRange(root)) {
+        if (prim.IsInstance()) {
+            // Nested instances aren't traversed; their prototype stands for their content.
+            combine(hash, pxr::TfHash()(prim.GetPrototype().GetPath()));
+            hasGeometry = true;
+        }
+        hasGeometry |= prim.IsA<pxr::UsdGeomGprim>();
+        combine(hash, pxr::TfHash()(prim.GetPath().MakeRelativePath(rootPath)));
+        combine(hash, pxr::TfHash()(prim.GetTypeName()));
+        for (const auto &attr : prim.GetAttributes()) {
+            if (prim == root && attr.GetName().GetString().rfind("xformOp", 0) == 0) {
+                // Where the root is placed is what tells duplicates apart.
+                continue;
+            }
+            pxr::SdfPathVector sources;
+            attr.GetConnections(&sources);
+            for (const auto &source : sources) {
+                if (!source.HasPrefix(rootPath)) {
+                    return std::nullopt;
+                }
+                combine(hash, pxr::TfHash()(source.MakeRelativePath(rootPath)));
+            }
+            std::vector<double> times;
+            attr.GetTimeSamples(&times);
+            pxr::VtValue value;
+            if (!attr.Get(&value, times.empty() ? pxr::UsdTimeCode::Default() : pxr::UsdTimeCode(times.front()))) {
+                continue;
+            }
+            combine(hash, pxr::TfHash()(attr.GetName()));
+            combine(hash, value.GetHash());
+            if (!times.empty()) {
+                combine(hash, times.size());
+                combine(hash, pxr::TfHash()(times.back()));
+                if (attr.Get(&value, times.back())) {
+                    combine(hash, value.GetHash());
+                }
+            }
+        }
+        for (const auto &rel : prim.GetRelationships()) {
+            pxr::SdfPathVector targets;
+            rel.GetTargets(&targets);
+            combine(hash, pxr::TfHash()(rel.GetName()));
+            for (const auto &target : targets) {
+                if (!target.HasPrefix(rootPath) || target == rootPath) {
+                    return std::nullopt;
+                }
+                combine(hash, pxr::TfHash()(target.MakeRelativePath(rootPath)));
+            }
+        }
+    }
+    if (!hasGeometry) {
+        return std::nullopt;
+    }
+    return hash;
+}
+
+size_t countGprims(const pxr::UsdStageRefPtr &stage, bool instanceProxies) {
+    size_t count = 0;
+    auto predicate = instanceProxies ? pxr::UsdTraverseInstanceProxies(pxr::UsdPrimDefaultPredicate)
+                                     : pxr::UsdPrimDefaultPredicate;
+    for (const auto &prim : stage->Traverse(predicate)) {
+        count += prim.IsA<pxr::UsdGeomGprim>();
+    }
+    if (!instanceProxies) {
+        for (const auto &prototype : stage->GetPrototypes()) {
+            for (const auto &prim : pxr::UsdPrimRange(prototype)) {
+                count += prim.IsA<pxr::UsdGeomGprim>();
+            }
+        }
+    }
+    return count;
+}
+}// namespace
+
+AutoInstancer::Stats AutoInstancer::apply(const pxr::UsdStageRefPtr &stage) {
+    _stats = {};
+    if (!stage) {
+        return _stats;
+    }
+    _stats.gprimsBefore = countGprims(stage, true);
+
+    // Prims brought in by composition arcs, outside of instances.
+    std::vector<pxr::UsdPrim> candidates;
+    for (const auto &prim : stage->Traverse()) {
+        if (!prim.IsInstance() && (prim.HasAuthoredReferences() || prim.HasAuthoredPayloads())) {
+            candidates.push_back(prim);
+        }
+    }
+    _stats.candidates = candidates.size();
+
+    std::vector<std::optional<size_t>> hashes(candidates.size());
+    pxr::WorkParallelForN(candidates.size(), [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            if (!hasOverridesAbove(candidates[i])) {
+                hashes[i] = hashSubtree(candidates[i]);
+            }
+        }
+    });
+    std::unordered_map<size_t, size_t> counts;
+    for (const auto &hash : hashes) {
+        if (hash) {
+            ++counts[*hash];
+        }
+    }
+
+    // Traversal order puts ancestors first; a prim inside one being instanced goes with it.
+    std::vector<pxr::SdfPath> instanced;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const auto &path = candidates[i].GetPath();
+        if (!hashes[i] || counts[*hashes[i]] < 2 ||
+            (!instanced.empty() && path.HasPrefix(instanced.back()))) {
+            continue;
+        }
+        instanced.push_back(path);
+    }
+    if (!instanced.empty()) {
+        auto layer = stage->GetSessionLayer();
+        pxr::SdfChangeBlock changeBlock;
+        for (const auto &path : instanced) {
+            if (auto spec = pxr::SdfCreatePrimInLayer(layer, path)) {
+                spec->SetInstanceable(true);
+            }
+        }
+    }
+    _stats.instanced = instanced.size();
+    _stats.prototypes = stage->GetPrototypes().size();
+    _stats.gprimsAfter = countGprims(stage, false);
+    return _stats;
+}
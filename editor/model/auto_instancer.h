@@ -0,0 +1,44 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+
+/// Instances the duplicated assets of a stage that was authored without
+/// instancing. Prims brought in by references or payloads are hashed on
+/// worker threads from the composed content below them: topology, points
+/// and every other attribute, relationships and the hierarchy. Prims whose
+/// content appears more than once are marked instanceable in the session
+/// layer, so Hydra draws each distinct asset once per prototype.
+///
+/// A prim is left alone when instancing would change what is drawn: when
+/// the root layer stack, or that of an assembly referencing it, overrides
+/// prims below it, or when relationships or connections below it target
+/// prims outside of it, which prototypes can't see.
+class AutoInstancer {
+public:
+    struct Stats {
+        /// Prims with references or payloads that were hashed.
+        size_t candidates{0};
+        /// Prims marked instanceable.
+        size_t instanced{0};
+        /// Prototypes the stage has afterwards.
+        size_t prototypes{0};
+        /// Gprims drawn before and after; prototype gprims count once.
+        size_t gprimsBefore{0};
+        size_t gprimsAfter{0};
+    };
+
+    /// Marks the duplicates of `stage` instanceable. Edits the session layer,
+    /// so it should run before the stage is handed to anything else.
+    Stats apply(const pxr::UsdStageRefPtr &stage);
+
+    [[nodiscard]] const Stats &stats() const { return _stats; }
+
+private:
+    Stats _stats;
+};
@@ -9,5 +9,9 @@
 namespace vox {
 DataModel::DataModel()
     : _selectionDataModel(*this),
-      _viewSettingsDataModel(*this) {}
+      _viewSettingsDataModel(*this) {
+    connect(&_viewSettingsDataModel, &ViewSettingsDataModel::signalSettingChanged, this, [this]() {
+        setAutoInstancing(_viewSettingsDataModel.autoInstancing());
+    });
+}
 }// namespace vox
\ No newline at end of file
@@ -0,0 +1,182 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "frame_prefetcher.h"
+
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/camera.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <algorithm>
+
+namespace {
+/// Attributes AttributeQueryCache reads: those of cameras, and visibility and
+/// extent on any prim. Points and primvars are left to UsdImaging, which reads
+/// them itself.
+bool isRead(const pxr::UsdPrim &prim, const pxr::TfToken &name) {
+    static const auto cameraNames = []() {
+        const auto &names = pxr::UsdGeomCamera::GetSchemaAttributeNames(false);
+        return std::set<pxr::TfToken>(names.begin(), names.end());
+    }();
+    return name == pxr::UsdGeomTokens->visibility || name == pxr::UsdGeomTokens->extent ||
+           (prim.IsA<pxr::UsdGeomCamera>() && cameraNames.count(name));
+}
+}// namespace
+
+const pxr::VtValue *PrefetchedFrame::value(const pxr::SdfPath &attributePath) const {
+    auto it = attributeSlots->find(attributePath);
+    return it != attributeSlots->end() ? &values[it->second] : nullptr;
+}
+
+const pxr::GfMatrix4d *PrefetchedFrame::localTransform(const pxr::SdfPath &primPath) const {
+    auto it = xformSlots->find(primPath);
+    return it != xformSlots->end() ? &localTransforms[it->second] : nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+FramePrefetcher::~FramePrefetcher() {
+    wait();
+}
+
+void FramePrefetcher::setStage(const pxr::UsdStageRefPtr &stage) {
+    _stage = stage;
+    invalidate();
+}
+
+void FramePrefetcher::setDepth(int frames) {
+    _depth = std::max(frames, 0);
+}
+
+void FramePrefetcher::invalidate() {
+    wait();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frames.clear();
+    _inFlight.clear();
+    _attributes.clear();
+    _xforms.clear();
+    _attributeSlots.reset();
+    _xformSlots.reset();
+    _collected = false;
+}
+
+void FramePrefetcher::wait() {
+    _dispatcher.Wait();
+}
+
+void FramePrefetcher::_collect() {
+    _attributeSlots = std::make_shared<PrefetchedFrame::Slots>();
+    _xformSlots = std::make_shared<PrefetchedFrame::Slots>();
+    auto visit = [this](const pxr::UsdPrim &root) {
+        for (const auto &prim : pxr::UsdPrimRange(root)) {
+            if (pxr::UsdGeomXformable xformable{prim}) {
+                pxr::UsdGeomXformable::XformQuery query(xformable);
+                if (query.TransformMightBeTimeVarying()) {
+                    _xformSlots->emplace(prim.GetPath(), _xforms.size());
+                    _xforms.push_back(std::move(query));
+                }
+            }
+            for (const auto &attr : prim.GetAuthoredAttributes()) {
+                // Transform ops are resolved together by the prim's xform query.
+                if (pxr::UsdGeomXformable::IsTransformationAffectedByAttrNamed(attr.GetName()) ||
+                    !isRead(prim, attr.GetName()) || !attr.ValueMightBeTimeVarying()) {
+                    continue;
+                }
+                _attributeSlots->emplace(attr.GetPath(), _attributes.size());
+                _attributes.emplace_back(attr);
+            }
+        }
+    };
+
+    if (_stage) {
+        visit(_stage->GetPseudoRoot());
+        for (const auto &prototype : _stage->GetPrototypes()) {
+            visit(prototype);
+        }
+    }
+    _collected = true;
+}
+
+std::shared_ptr<const PrefetchedFrame> FramePrefetcher::_resolve(double time) const {
+    auto frame = std::make_shared<PrefetchedFrame>();
+    frame->time = time;
+    frame->attributeSlots = _attributeSlots;
+    frame->xformSlots = _xformSlots;
+    frame->values.resize(_attributes.size());
+    frame->localTransforms.resize(_xforms.size(), pxr::GfMatrix4d(1.0));
+
+    pxr::WorkParallelForN(_attributes.size(), [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            _attributes[i].Get(&frame->values[i], time);
+        }
+    });
+    pxr::WorkParallelForN(_xforms.size(), [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            _xforms[i].GetLocalTransformation(&frame->localTransforms[i], time);
+        }
+    });
+    return frame;
+}
+
+void FramePrefetcher::prefetch(double time, double startTime, double endTime, double step) {
+    if (!_stage || _depth == 0 || endTime <= startTime || step <= 0.0) {
+        return;
+    }
+    if (!_collected) {
+        wait();
+        _collect();
+    }
+    if (_attributes.empty() && _xforms.empty()) {
+        return;
+    }
+
+    // The frames playback shows next, looping like the viewport does.
+    std::set<double> window;
+    auto next = time;
+    for (int i = 0; i < _depth; ++i) {
+        next += step;
+        if (next > endTime) {
+            next = startTime;
+        }
+        window.insert(next);
+    }
+
+    std::vector<double> missing;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto it = _frames.begin(); it != _frames.end();) {
+            auto keep = it->first == time || window.count(it->first);
+            it = keep ? std::next(it) : _frames.erase(it);
+        }
+        for (auto t : window) {
+            if (!_frames.count(t) && _inFlight.insert(t).second) {
+                missing.push_back(t);
+            }
+        }
+    }
+
+    for (auto t : missing) {
+        _dispatcher.Run([this, t]() {
+            auto frame = _resolve(t);
+            std::lock_guard<std::mutex> lock(_mutex);
+            _inFlight.erase(t);
+            _frames[t] = std::move(frame);
+        });
+    }
+}
+
+std::shared_ptr<const PrefetchedFrame> FramePrefetcher::frame(pxr::UsdTimeCode time) {
+    if (_depth == 0 || time.IsDefault() || valueCount() == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _frames.find(time.GetValue());
+    if (it == _frames.end()) {
+        ++_misses;
+        return nullptr;
+    }
+    ++_hits;
+    return it->second;
+}
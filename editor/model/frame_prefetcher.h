@@ -0,0 +1,99 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/base/work/dispatcher.h>
+#include <pxr/usd/usd/attributeQuery.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/xformable.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/// Values of the time-varying attributes and transforms of a stage at one time code.
+struct PrefetchedFrame {
+    using Slots = std::unordered_map<pxr::SdfPath, size_t, pxr::SdfPath::Hash>;
+
+    double time{};
+    std::shared_ptr<const Slots> attributeSlots;
+    std::shared_ptr<const Slots> xformSlots;
+    std::vector<pxr::VtValue> values;
+    std::vector<pxr::GfMatrix4d> localTransforms;
+
+    /// Value of the attribute at `attributePath`, null if it wasn't prefetched.
+    [[nodiscard]] const pxr::VtValue *value(const pxr::SdfPath &attributePath) const;
+
+    /// Local transform of the prim at `primPath`, null if it wasn't prefetched.
+    [[nodiscard]] const pxr::GfMatrix4d *localTransform(const pxr::SdfPath &primPath) const;
+};
+
+/// Resolves the time-varying values AttributeQueryCache serves (transforms,
+/// cameras, visibility and extents) for the frames ahead of playback on
+/// worker threads, into a cache bounded to those frames. Points and primvars
+/// aren't resolved, Hydra reads those through UsdImaging. The set of
+/// time-varying values is gathered once per stage edit, with a query each.
+///
+/// Prims are visited without instance proxies, so values under instances are
+/// keyed by their prototype paths. The stage must not be edited while the
+/// workers run; callers start them for a frame and wait before returning to
+/// the event loop.
+class FramePrefetcher {
+public:
+    ~FramePrefetcher();
+
+    void setStage(const pxr::UsdStageRefPtr &stage);
+
+    /// Number of frames resolved ahead of the current one, 0 disables prefetching.
+    void setDepth(int frames);
+    [[nodiscard]] int depth() const { return _depth; }
+
+    /// Drops the resolved frames and the time-varying set, after stage edits.
+    void invalidate();
+
+    /// Starts resolving the `depth` frames after `time` that aren't cached,
+    /// stepping by `step` and wrapping from `endTime` back to `startTime`.
+    /// Frames outside that window are evicted. Returns immediately.
+    void prefetch(double time, double startTime, double endTime, double step = 1.0);
+
+    /// Blocks until every frame started by prefetch() is resolved.
+    void wait();
+
+    /// Resolved frame at `time`, null if it isn't cached.
+    std::shared_ptr<const PrefetchedFrame> frame(pxr::UsdTimeCode time);
+
+    [[nodiscard]] size_t hits() const { return _hits; }
+    [[nodiscard]] size_t misses() const { return _misses; }
+    /// Number of attributes and transforms resolved per frame.
+    [[nodiscard]] size_t valueCount() const { return _attributes.size() + _xforms.size(); }
+
+private:
+    void _collect();
+    std::shared_ptr<const PrefetchedFrame> _resolve(double time) const;
+
+    pxr::UsdStageRefPtr _stage;
+    int _depth{0};
+    bool _collected{false};
+
+    std::vector<pxr::UsdAttributeQuery> _attributes;
+    std::vector<pxr::UsdGeomXformable::XformQuery> _xforms;
+    std::shared_ptr<PrefetchedFrame::Slots> _attributeSlots;
+    std::shared_ptr<PrefetchedFrame::Slots> _xformSlots;
+
+    // Guards the cache, which workers fill while the main thread reads it.
+    std::mutex _mutex;
+    std::map<double, std::shared_ptr<const PrefetchedFrame>> _frames;
+    std::set<double> _inFlight;
+    size_t _hits{0};
+    size_t _misses{0};
+
+    pxr::WorkDispatcher _dispatcher;
+};
@@ -5,9 +5,11 @@
 //  property of any third parties.
 
 #include "free_camera.h"
+#include "model_bounds_cache.h"
 #include <QDebug>
 #include <utility>
 #include <pxr/base/gf/frustum.h>
+#include <pxr/imaging/cameraUtil/conformWindow.h>
 
 FreeCamera::FreeCamera(bool isZup, float fov, float aspectRatio,
                        std::optional<float> overrideNear,
@@ -127,8 +129,9 @@ void FreeCamera::resetClippingPlanes() {
     _camera.SetClippingRange(pxr::GfRange1f(near, far));
 }
 
-void FreeCamera::setClippingPlanes(pxr::GfBBox3d stageBBox) {
-    bool debugClipping = true;
+void FreeCamera::setClippingPlanes(pxr::GfBBox3d stageBBox, ModelBoundsCache *modelBounds,
+                                   std::optional<float> windowAspect) {
+    bool debugClipping = false;
     float computedNear, computedFar;
     // If the scene bounding box is empty, or we are fully on manual
     // override, then just initialize to defaults.
@@ -168,6 +171,24 @@ void FreeCamera::setClippingPlanes(pxr::GfBBox3d stageBBox) {
         auto result = _rangeOfBoxAlongRay(camRay, stageBBox, debugClipping);
         computedNear = result.first;
         computedFar = result.second;
+
+        // Of the stage, only the models inside the frustum need to fit.
+        if (modelBounds) {
+            // The models at the sides of a wide window are seen through the frustum it is drawn with.
+            if (windowAspect) {
+                pxr::GfCamera conformed(_camera);
+                pxr::CameraUtilConformWindow(&conformed, pxr::CameraUtilFit, *windowAspect);
+                frustum = conformed.GetFrustum();
+            }
+            frustum.SetNearFar(pxr::GfRange1d(computedNear, computedFar));
+            if (auto range = modelBounds->rangeInFrustum(frustum)) {
+                auto modelNear = range->GetMin() < defaultNear ? defaultNear : range->GetMin() * 0.99;
+                computedNear = std::max(computedNear, float(modelNear));
+                computedFar = std::min(computedFar, float(range->GetMax() * 1.01));
+                if (debugClipping)
+                    qDebug("Models in frustum near/far: %f, %f", computedNear, computedFar);
+            }
+        }
         auto precisionNear = computedFar / FreeCamera::maxGoodZResolution;
 
         if (_closestVisibleDist) {
@@ -215,10 +236,11 @@ void FreeCamera::setClippingPlanes(pxr::GfBBox3d stageBBox) {
     _camera.SetClippingRange(pxr::GfRange1f(near, far));
 }
 
-pxr::GfCamera FreeCamera::computeGfCamera(pxr::GfBBox3d stageBBox, bool autoClip) {
+pxr::GfCamera FreeCamera::computeGfCamera(pxr::GfBBox3d stageBBox, bool autoClip, ModelBoundsCache *modelBounds,
+                                          std::optional<float> windowAspect) {
     _pushToCameraTransform();
     if (autoClip) {
-        setClippingPlanes(stageBBox);
+        setClippingPlanes(stageBBox, modelBounds, windowAspect);
     } else {
         resetClippingPlanes();
     }
@@ -247,13 +269,18 @@ void FreeCamera::frameSelection(pxr::GfBBox3d selBBox, float frameFit) {
     }
 }
 
-void FreeCamera::setClosestVisibleDistFromPoint(pxr::GfVec3d point) {
+bool FreeCamera::setClosestVisibleDistFromPoint(pxr::GfVec3d point, float tolerance) {
     auto frustum = _camera.GetFrustum();
     auto camPos = frustum.GetPosition();
     auto camRay = pxr::GfRay(camPos, frustum.ComputeViewDirection());
-    _closestVisibleDist = camRay.FindClosestPoint(point)[1];
+    float closestDist = camRay.FindClosestPoint(point)[1];
+    if (_closestVisibleDist && std::abs(closestDist - *_closestVisibleDist) <= tolerance * *_closestVisibleDist) {
+        return false;
+    }
+    _closestVisibleDist = closestDist;
     _lastFramedDist = dist();
     _lastFramedClosestDist = _closestVisibleDist.value();
+    return true;
 }
 
 float FreeCamera::ComputePixelsToWorldFactor(float viewportHeight) {
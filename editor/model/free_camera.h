@@ -13,6 +13,8 @@
 #include <pxr/base/gf/ray.h>
 #include <pxr/base/gf/bbox3d.h>
 
+class ModelBoundsCache;
+
 class FreeCamera : public QObject {
     Q_OBJECT
 signals:
@@ -47,19 +49,26 @@ public:
     //  object in the central view of the camera (closestVisibleDist).
     //
     //  If either of the "override" clipping attributes are not None,
-    //  we use those instead
-    void setClippingPlanes(pxr::GfBBox3d stageBBox);
+    //  we use those instead. With 'modelBounds', the range is narrowed to
+    //  the models inside the view frustum, conformed to 'windowAspect' when
+    //  the view isn't drawn at the camera's own aspect ratio.
+    void setClippingPlanes(pxr::GfBBox3d stageBBox, ModelBoundsCache *modelBounds = nullptr,
+                           std::optional<float> windowAspect = std::nullopt);
 
     /// Makes sure the FreeCamera's computed parameters are up-to-date, and
     //  returns the GfCamera object.  If 'autoClip' is True, then compute
     //  "optimal" positions for the near/far clipping planes based on the
     //  current closestVisibleDist, in order to maximize Z-buffer resolution
-    pxr::GfCamera computeGfCamera(pxr::GfBBox3d stageBBox, bool autoClip = false);
+    pxr::GfCamera computeGfCamera(pxr::GfBBox3d stageBBox, bool autoClip = false,
+                                  ModelBoundsCache *modelBounds = nullptr,
+                                  std::optional<float> windowAspect = std::nullopt);
 
     /// needs to be recomputed
     void frameSelection(pxr::GfBBox3d selBBox, float frameFit);
 
-    void setClosestVisibleDistFromPoint(pxr::GfVec3d point);
+    /// Sets the closest visible distance from `point`, unless it is within
+    //  `tolerance` of the current one, relative to it. Returns true if it changed.
+    bool setClosestVisibleDistFromPoint(pxr::GfVec3d point, float tolerance = 0.f);
 
     /// Computes the ratio that converts pixel distance into world units.
     //
@@ -0,0 +1,268 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "mesh_simplifier.h"
+
+#include <pxr/base/gf/matrix3d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+/// Weight of the planes holding open borders in place, relative to the surface.
+constexpr double BoundaryWeight = 100.0;
+
+/// Symmetric 4x4 error quadric, upper triangle row by row.
+struct Quadric {
+    std::array<double, 10> q{};
+
+    static Quadric plane(const pxr::GfVec3d &normal, double d, double weight) {
+        auto a = normal[0], b = normal[1], c = normal[2];
+        Quadric result;
+        result.q = {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+        for (auto &value : result.q) {
+            value *= weight;
+        }
+        return result;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        for (size_t i = 0; i < q.size(); ++i) {
+            q[i] += other.q[i];
+        }
+        return *this;
+    }
+
+    [[nodiscard]] double error(const pxr::GfVec3d &v) const {
+        auto x = v[0], y = v[1], z = v[2];
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+               q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+               q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+
+    /// Position of least error, if the quadric isn't singular.
+    [[nodiscard]] bool optimum(pxr::GfVec3d *v) const {
+        pxr::GfMatrix3d a(q[0], q[1], q[2], q[1], q[4], q[5], q[2], q[5], q[7]);
+        double det = 0.0;
+        auto inverse = a.GetInverse(&det, 1e-12);
+        if (std::abs(det) <= 1e-12) {
+            return false;
+        }
+        *v = -(inverse * pxr::GfVec3d(q[3], q[6], q[8]));
+        return true;
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t keep;
+    uint32_t remove;
+    uint32_t keepVersion;
+    uint32_t removeVersion;
+    pxr::GfVec3d position;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+pxr::GfVec3d faceNormal(const pxr::GfVec3d &a, const pxr::GfVec3d &b, const pxr::GfVec3d &c) {
+    return pxr::GfCross(b - a, c - a);
+}
+}// namespace
+
+SimplifiedMesh simplifyMesh(const pxr::VtVec3fArray &points, const pxr::VtIntArray &faceVertexCounts,
+                            const pxr::VtIntArray &faceVertexIndices, float ratio) {
+    // Polygons as fans of triangles, without the degenerate ones.
+    std::vector<std::array<uint32_t, 3>> triangles;
+    size_t offset = 0;
+    auto pointCount = int(points.size());
+    for (auto count : faceVertexCounts) {
+        if (count < 0 || offset + size_t(count) > faceVertexIndices.size()) {
+            break;
+        }
+        for (int i = 2; i < count; ++i) {
+            std::array<int, 3> corner = {faceVertexIndices[offset], faceVertexIndices[offset + i - 1],
+                                         faceVertexIndices[offset + i]};
+            if (std::any_of(corner.begin(), corner.end(), [pointCount](int index) { return index < 0 || index >= pointCount; }) ||
+                corner[0] == corner[1] || corner[1] == corner[2] || corner[0] == corner[2]) {
+                continue;
+            }
+            triangles.push_back({uint32_t(corner[0]), uint32_t(corner[1]), uint32_t(corner[2])});
+        }
+        offset += size_t(count);
+    }
+
+    SimplifiedMesh result;
+    result.sourceTriangles = triangles.size();
+    std::vector<pxr::GfVec3d> positions(points.begin(), points.end());
+    std::vector<bool> alive(triangles.size(), true);
+    auto liveCount = triangles.size();
+    auto target = size_t(std::max(1.0, std::round(double(std::clamp(ratio, 0.f, 1.f)) * double(triangles.size()))));
+
+    if (liveCount > target) {
+        std::vector<Quadric> quadrics(positions.size());
+        std::vector<std::vector<uint32_t>> vertexTriangles(positions.size());
+        // Edge to the number of triangles using it, and the last one seen.
+        std::unordered_map<uint64_t, std::pair<int, uint32_t>> edges;
+        for (uint32_t t = 0; t < triangles.size(); ++t) {
+            const auto &tri = triangles[t];
+            auto normal = faceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+            auto length = normal.GetLength();
+            if (length > 0.0) {
+                normal /= length;
+                // Weighted by area, so slivers don't pin their vertices.
+                auto plane = Quadric::plane(normal, -pxr::GfDot(normal, positions[tri[0]]), length * 0.5);
+                for (auto v : tri) {
+                    quadrics[v] += plane;
+                }
+            }
+            for (int i = 0; i < 3; ++i) {
+                vertexTriangles[tri[i]].push_back(t);
+                auto &edge = edges[edgeKey(tri[i], tri[(i + 1) % 3])];
+                ++edge.first;
+                edge.second = t;
+            }
+        }
+        for (const auto &[key, edge] : edges) {
+            if (edge.first != 1) {
+                continue;
+            }
+            // A plane through the border edge, perpendicular to its triangle.
+            auto a = uint32_t(key >> 32), b = uint32_t(key & 0xffffffffu);
+            const auto &tri = triangles[edge.second];
+            auto normal = faceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+            auto direction = positions[b] - positions[a];
+            auto borderNormal = pxr::GfCross(direction, normal);
+            auto length = borderNormal.GetLength();
+            if (length <= 0.0) {
+                continue;
+            }
+            borderNormal /= length;
+            auto plane = Quadric::plane(borderNormal, -pxr::GfDot(borderNormal, positions[a]),
+                                        BoundaryWeight * direction.GetLengthSq());
+            quadrics[a] += plane;
+            quadrics[b] += plane;
+        }
+
+        std::vector<uint32_t> versions(positions.size(), 0);
+        std::vector<bool> removed(positions.size(), false);
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> heap;
+        auto push = [&](uint32_t a, uint32_t b) {
+            auto quadric = quadrics[a];
+            quadric += quadrics[b];
+            pxr::GfVec3d position;
+            if (!quadric.optimum(&position)) {
+                // Singular along the edge: the better of its ends and its middle.
+                std::array<pxr::GfVec3d, 3> candidates = {positions[a], positions[b], (positions[a] + positions[b]) * 0.5};
+                position = *std::min_element(candidates.begin(), candidates.end(), [&](const auto &x, const auto &y) {
+                    return quadric.error(x) < quadric.error(y);
+                });
+            }
+            heap.push({std::max(0.0, quadric.error(position)), a, b, versions[a], versions[b], position});
+        };
+        for (const auto &[key, edge] : edges) {
+            push(uint32_t(key >> 32), uint32_t(key & 0xffffffffu));
+        }
+
+        // True if moving `from` to `position` turns over a triangle that doesn't use `other`.
+        auto flips = [&](uint32_t from, uint32_t other, const pxr::GfVec3d &position) {
+            for (auto t : vertexTriangles[from]) {
+                const auto &tri = triangles[t];
+                if (!alive[t] || std::find(tri.begin(), tri.end(), other) != tri.end()) {
+                    continue;
+                }
+                std::array<pxr::GfVec3d, 3> moved = {positions[tri[0]], positions[tri[1]], positions[tri[2]]};
+                for (int i = 0; i < 3; ++i) {
+                    if (tri[i] == from) {
+                        moved[i] = position;
+                    }
+                }
+                auto before = faceNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+                auto after = faceNormal(moved[0], moved[1], moved[2]);
+                if (pxr::GfDot(before, after) <= 0.0) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        while (liveCount > target && !heap.empty()) {
+            auto collapse = heap.top();
+            heap.pop();
+            auto keep = collapse.keep, remove = collapse.remove;
+            if (removed[keep] || removed[remove] || versions[keep] != collapse.keepVersion ||
+                versions[remove] != collapse.removeVersion) {
+                continue;
+            }
+            if (flips(keep, remove, collapse.position) || flips(remove, keep, collapse.position)) {
+                continue;
+            }
+
+            positions[keep] = collapse.position;
+            quadrics[keep] += quadrics[remove];
+            removed[remove] = true;
+            for (auto t : vertexTriangles[remove]) {
+                if (!alive[t]) {
+                    continue;
+                }
+                auto &tri = triangles[t];
+                if (std::find(tri.begin(), tri.end(), keep) != tri.end()) {
+                    alive[t] = false;
+                    --liveCount;
+                    continue;
+                }
+                std::replace(tri.begin(), tri.end(), remove, keep);
+                vertexTriangles[keep].push_back(t);
+            }
+            vertexTriangles[remove].clear();
+            auto &kept = vertexTriangles[keep];
+            kept.erase(std::remove_if(kept.begin(), kept.end(), [&](uint32_t t) { return !alive[t]; }), kept.end());
+            ++versions[keep];
+
+            std::vector<uint32_t> neighbors;
+            for (auto t : kept) {
+                for (auto v : triangles[t]) {
+                    if (v != keep) {
+                        neighbors.push_back(v);
+                    }
+                }
+            }
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            for (auto neighbor : neighbors) {
+                push(keep, neighbor);
+            }
+        }
+    }
+
+    // Only the points the remaining triangles use.
+    std::vector<int> remap(positions.size(), -1);
+    std::vector<pxr::GfVec3f> outPoints;
+    std::vector<int> outIndices;
+    outIndices.reserve(liveCount * 3);
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        if (!alive[t]) {
+            continue;
+        }
+        for (auto v : triangles[t]) {
+            if (remap[v] < 0) {
+                remap[v] = int(outPoints.size());
+                outPoints.emplace_back(positions[v]);
+            }
+            outIndices.push_back(remap[v]);
+        }
+    }
+    result.points.assign(outPoints.begin(), outPoints.end());
+    result.faceVertexIndices.assign(outIndices.begin(), outIndices.end());
+    return result;
+}
@@ -0,0 +1,27 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/types.h>
+
+/// Triangles left by simplifyMesh, over the points they use.
+struct SimplifiedMesh {
+    pxr::VtVec3fArray points;
+    pxr::VtIntArray faceVertexIndices;
+    /// Triangles the polygons of the source mesh made.
+    size_t sourceTriangles{0};
+
+    [[nodiscard]] size_t triangleCount() const { return faceVertexIndices.size() / 3; }
+};
+
+/// Simplifies a polygon mesh to about `ratio` of its triangles by quadric
+/// edge collapse (Garland and Heckbert). Open borders are weighted so they
+/// keep their outline, and collapses that would flip a triangle are refused,
+/// so the result can stop above the target. Safe to call from any thread.
+SimplifiedMesh simplifyMesh(const pxr::VtVec3fArray &points, const pxr::VtIntArray &faceVertexCounts,
+                            const pxr::VtIntArray &faceVertexIndices, float ratio);
@@ -0,0 +1,372 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "model_bounds_cache.h"
+#include "common.h"
+
+#include <pxr/base/gf/plane.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/gprim.h>
+#include <pxr/usd/usdGeom/pointBased.h>
+#include <pxr/usd/usdGeom/pointInstancer.h>
+#include <pxr/usd/usdGeom/xformable.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace {
+bool transformMightBeTimeVarying(const pxr::UsdPrim &prim) {
+    pxr::UsdGeomXformable xformable{prim};
+    return xformable && xformable.TransformMightBeTimeVarying();
+}
+
+/// Extent, points or positions of `prim` may change with time.
+bool geometryMightBeTimeVarying(const pxr::UsdPrim &prim) {
+    if (pxr::UsdGeomBoundable boundable{prim}) {
+        if (boundable.GetExtentAttr().ValueMightBeTimeVarying()) {
+            return true;
+        }
+    }
+    if (pxr::UsdGeomPointBased pointBased{prim}) {
+        return pointBased.GetPointsAttr().ValueMightBeTimeVarying();
+    }
+    if (pxr::UsdGeomPointInstancer instancer{prim}) {
+        return instancer.GetPositionsAttr().ValueMightBeTimeVarying();
+    }
+    return false;
+}
+
+/// Prims whose bounds are tested as a whole; nothing below them gets a node.
+bool isLeaf(const pxr::UsdPrim &prim) {
+    return prim.IsComponent() || prim.IsInstance() || prim.IsA<pxr::UsdGeomGprim>() ||
+           prim.IsA<pxr::UsdGeomPointInstancer>();
+}
+
+struct BuildNode {
+    pxr::UsdPrim prim;
+    std::vector<size_t> children;
+    bool timeVarying{false};
+};
+}// namespace
+
+ModelBoundsCache::ModelBoundsCache()
+    : _bboxCache{pxr::UsdTimeCode::Default(),
+                 {to_constants(IncludedPurposes::DEFAULT),
+                  to_constants(IncludedPurposes::PROXY)},
+                 true} {
+}
+
+void ModelBoundsCache::setStage(const pxr::UsdStageRefPtr &stage) {
+    _stage = stage;
+    invalidate();
+}
+
+void ModelBoundsCache::setTime(pxr::UsdTimeCode time) {
+    if (time == _bboxCache.GetTime()) {
+        return;
+    }
+    _bboxCache.SetTime(time);
+    if (_timeVarying && !_structureDirty) {
+        for (auto index : _timeVaryingLeaves) {
+            _nodes[index].dirty = true;
+        }
+        _someBoundsDirty = true;
+    }
+}
+
+void ModelBoundsCache::setIncludedPurposes(const pxr::TfTokenVector &purposes) {
+    _bboxCache.SetIncludedPurposes(purposes);
+    _boundsDirty = true;
+}
+
+void ModelBoundsCache::setUseExtentsHint(bool value) {
+    if (value != _bboxCache.GetUseExtentsHint()) {
+        _bboxCache = pxr::UsdGeomBBoxCache(_bboxCache.GetTime(), _bboxCache.GetIncludedPurposes(), value);
+        _boundsDirty = true;
+    }
+}
+
+void ModelBoundsCache::invalidate() {
+    _structureDirty = true;
+    _boundsDirty = true;
+}
+
+void ModelBoundsCache::invalidateBounds() {
+    _boundsDirty = true;
+}
+
+void ModelBoundsCache::invalidateBounds(const pxr::SdfPathVector &paths) {
+    if (_structureDirty || _boundsDirty) {
+        return;
+    }
+    for (const auto &changed : paths) {
+        auto path = changed.GetPrimPath();
+        // The leaf holding the prim, or any leaf below it.
+        for (auto ancestor = path; !ancestor.IsEmpty(); ancestor = ancestor.GetParentPath()) {
+            if (auto leaf = _leaves.find(ancestor); leaf != _leaves.end()) {
+                _nodes[leaf->second].dirty = true;
+                _someBoundsDirty = true;
+                break;
+            }
+        }
+        for (auto leaf = _leaves.lower_bound(path); leaf != _leaves.end() && leaf->first.HasPrefix(path); ++leaf) {
+            _nodes[leaf->second].dirty = true;
+            _someBoundsDirty = true;
+        }
+    }
+}
+
+void ModelBoundsCache::_rebuild() {
+    _nodes.clear();
+    _leaves.clear();
+    _timeVaryingLeaves.clear();
+    _timeVarying = false;
+    if (!_stage) {
+        return;
+    }
+
+    // Gather the model hierarchy depth first, each prim under its closest node ancestor.
+    std::vector<BuildNode> tree{{_stage->GetPseudoRoot(), {}}};
+    std::vector<std::pair<pxr::SdfPath, size_t>> ancestors{{pxr::SdfPath::AbsoluteRootPath(), 0}};
+    std::vector<std::pair<pxr::SdfPath, size_t>> leafPaths;
+    // Prims above the current one whose transform is animated; every leaf below them moves.
+    std::vector<pxr::SdfPath> animatedTransforms;
+    auto range = pxr::UsdPrimRange::Stage(_stage);
+    for (auto iter = range.begin(); iter != range.end(); ++iter) {
+        const auto &prim = *iter;
+        const auto &path = prim.GetPath();
+        while (!animatedTransforms.empty() && !path.HasPrefix(animatedTransforms.back())) {
+            animatedTransforms.pop_back();
+        }
+
+        // Inside a leaf only time variation matters.
+        while (!leafPaths.empty() && !path.HasPrefix(leafPaths.back().first)) {
+            leafPaths.pop_back();
+        }
+        if (!leafPaths.empty()) {
+            auto &leafNode = tree[leafPaths.back().second];
+            leafNode.timeVarying = leafNode.timeVarying || transformMightBeTimeVarying(prim) ||
+                                   geometryMightBeTimeVarying(prim);
+            if (leafNode.timeVarying) {
+                iter.PruneChildren();
+            }
+            continue;
+        }
+
+        auto transformVarying = transformMightBeTimeVarying(prim);
+        auto leaf = isLeaf(prim);
+        if (!leaf && !prim.IsModel()) {
+            if (transformVarying) {
+                animatedTransforms.push_back(path);
+            }
+            continue;
+        }
+        while (!path.HasPrefix(ancestors.back().first)) {
+            ancestors.pop_back();
+        }
+        auto index = tree.size();
+        tree[ancestors.back().second].children.push_back(index);
+        tree.push_back({prim, {}});
+        if (leaf) {
+            tree[index].timeVarying = !animatedTransforms.empty() || transformVarying || geometryMightBeTimeVarying(prim);
+            leafPaths.emplace_back(path, index);
+        } else {
+            if (transformVarying) {
+                animatedTransforms.push_back(path);
+            }
+            ancestors.emplace_back(path, index);
+        }
+    }
+
+    // Flatten breadth first so that the children of every node are contiguous.
+    _nodes.reserve(tree.size());
+    _nodes.push_back({tree[0].prim});
+    std::vector<size_t> order{0};
+    for (size_t i = 0; i < order.size(); ++i) {
+        const auto &children = tree[order[i]].children;
+        _nodes[i].firstChild = uint32_t(_nodes.size());
+        _nodes[i].childCount = uint32_t(children.size());
+        for (auto child : children) {
+            order.push_back(child);
+            _nodes.push_back({tree[child].prim});
+        }
+    }
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        if (_nodes[i].childCount > 0) {
+            continue;
+        }
+        _leaves.emplace(_nodes[i].prim.GetPath(), uint32_t(i));
+        if (tree[order[i]].timeVarying) {
+            _nodes[i].timeVarying = true;
+            _timeVaryingLeaves.push_back(uint32_t(i));
+        }
+    }
+    _timeVarying = !_timeVaryingLeaves.empty();
+}
+
+void ModelBoundsCache::_updateBounds() {
+    auto count = _nodes.size();
+    for (auto *values : {&_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ}) {
+        values->resize(count);
+    }
+    auto setRange = [this](size_t i, const pxr::GfRange3d &range) {
+        if (range.IsEmpty()) {
+            // A negative extent is outside every plane.
+            _centerX[i] = _centerY[i] = _centerZ[i] = 0.0;
+            _extentX[i] = _extentY[i] = _extentZ[i] = -std::numeric_limits<double>::max();
+            return;
+        }
+        auto center = range.GetMidpoint();
+        auto extent = range.GetSize() * 0.5;
+        _centerX[i] = center[0];
+        _centerY[i] = center[1];
+        _centerZ[i] = center[2];
+        _extentX[i] = extent[0];
+        _extentY[i] = extent[1];
+        _extentZ[i] = extent[2];
+    };
+
+    // The cache can't drop single prims, and those of the edited ones are stale;
+    // only the dirty leaves are computed from it, so only their subtrees are read.
+    _bboxCache.Clear();
+    for (size_t i = 0; i < count; ++i) {
+        auto &node = _nodes[i];
+        if (node.childCount > 0 || !(node.dirty || _boundsDirty)) {
+            continue;
+        }
+        setRange(i, _bboxCache.ComputeWorldBound(node.prim).ComputeAlignedRange());
+        node.dirty = false;
+    }
+    // Children come after their parent, so walking backwards unites them first.
+    for (size_t i = count; i-- > 0;) {
+        const auto &node = _nodes[i];
+        if (node.childCount == 0) {
+            continue;
+        }
+        pxr::GfRange3d range;
+        for (size_t c = node.firstChild; c < size_t(node.firstChild + node.childCount); ++c) {
+            if (_extentX[c] >= 0.0) {
+                pxr::GfVec3d center(_centerX[c], _centerY[c], _centerZ[c]);
+                pxr::GfVec3d extent(_extentX[c], _extentY[c], _extentZ[c]);
+                range.UnionWith(pxr::GfRange3d(center - extent, center + extent));
+            }
+        }
+        setRange(i, range);
+    }
+}
+
+void ModelBoundsCache::_update() {
+    if (_structureDirty) {
+        _rebuild();
+        _structureDirty = false;
+        _boundsDirty = true;
+    }
+    if (_boundsDirty || _someBoundsDirty) {
+        _updateBounds();
+        _boundsDirty = false;
+        _someBoundsDirty = false;
+        ++_version;
+    }
+}
+
+const std::vector<ModelBoundsCache::ModelBounds> &ModelBoundsCache::components() {
+    _update();
+    if (_componentsVersion != _version) {
+        _componentsVersion = _version;
+        _components.clear();
+        for (size_t i = 0; i < _nodes.size(); ++i) {
+            const auto &prim = _nodes[i].prim;
+            if (!prim.IsComponent() || prim.IsInstance() || _extentX[i] < 0.0) {
+                continue;
+            }
+            pxr::GfVec3d center(_centerX[i], _centerY[i], _centerZ[i]);
+            pxr::GfVec3d extent(_extentX[i], _extentY[i], _extentZ[i]);
+            _components.push_back({prim.GetPath(), pxr::GfRange3d(center - extent, center + extent)});
+        }
+    }
+    return _components;
+}
+
+std::optional<pxr::GfRange1d> ModelBoundsCache::rangeInFrustum(const pxr::GfFrustum &frustum) {
+    _update();
+    if (_nodes.empty()) {
+        return std::nullopt;
+    }
+
+    // Frustum planes facing inward, from the corners: left/right bottom/top near, then far.
+    auto corners = frustum.ComputeCorners();
+    pxr::GfVec3d centroid(0.0);
+    for (const auto &corner : corners) {
+        centroid += corner / 8.0;
+    }
+    std::array<pxr::GfPlane, 6> planes = {
+        pxr::GfPlane(corners[0], corners[1], corners[2]), pxr::GfPlane(corners[4], corners[6], corners[5]),
+        pxr::GfPlane(corners[0], corners[2], corners[4]), pxr::GfPlane(corners[1], corners[5], corners[3]),
+        pxr::GfPlane(corners[0], corners[4], corners[1]), pxr::GfPlane(corners[2], corners[3], corners[6])};
+    std::array<double, 6> normalX{}, normalY{}, normalZ{}, offset{};
+    for (size_t p = 0; p < planes.size(); ++p) {
+        planes[p].Reorient(centroid);
+        const auto &normal = planes[p].GetNormal();
+        normalX[p] = normal[0];
+        normalY[p] = normal[1];
+        normalZ[p] = normal[2];
+        offset[p] = planes[p].GetDistanceFromOrigin();
+    }
+
+    // An AABB projects onto a direction as center . d +- extent . |d|, the
+    // same range as projecting all eight corners.
+    auto eye = frustum.GetPosition();
+    auto dir = frustum.ComputeViewDirection();
+    auto eyeDepth = pxr::GfDot(eye, dir);
+    auto absDirX = std::abs(dir[0]), absDirY = std::abs(dir[1]), absDirZ = std::abs(dir[2]);
+
+    auto minDepth = std::numeric_limits<double>::infinity();
+    auto maxDepth = -std::numeric_limits<double>::infinity();
+    enum : uint8_t { Outside,
+                     Intersecting,
+                     Inside };
+    std::vector<uint8_t> state;
+    std::vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+        const auto &node = _nodes[stack.back()];
+        stack.pop_back();
+        auto first = size_t(node.firstChild);
+        auto count = size_t(node.childCount);
+        state.assign(count, Inside);
+
+        for (size_t p = 0; p < planes.size(); ++p) {
+            for (size_t i = 0; i < count; ++i) {
+                auto c = first + i;
+                auto distance = normalX[p] * _centerX[c] + normalY[p] * _centerY[c] + normalZ[p] * _centerZ[c] - offset[p];
+                auto radius = std::abs(normalX[p]) * _extentX[c] + std::abs(normalY[p]) * _extentY[c] +
+                              std::abs(normalZ[p]) * _extentZ[c];
+                uint8_t planeState = distance + radius < 0.0 ? Outside : (distance - radius < 0.0 ? Intersecting : Inside);
+                state[i] = std::min(state[i], planeState);
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            auto c = first + i;
+            if (state[i] == Outside) {
+                continue;
+            }
+            if (state[i] == Intersecting && _nodes[c].childCount > 0) {
+                stack.push_back(uint32_t(c));
+                continue;
+            }
+            auto depth = dir[0] * _centerX[c] + dir[1] * _centerY[c] + dir[2] * _centerZ[c] - eyeDepth;
+            auto radius = absDirX * _extentX[c] + absDirY * _extentY[c] + absDirZ * _extentZ[c];
+            minDepth = std::min(minDepth, depth - radius);
+            maxDepth = std::max(maxDepth, depth + radius);
+        }
+    }
+
+    if (minDepth > maxDepth) {
+        return std::nullopt;
+    }
+    return pxr::GfRange1d(minDepth, maxDepth);
+}
@@ -0,0 +1,94 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/range1d.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <map>
+#include <optional>
+#include <vector>
+
+/// World bounds of the model hierarchy of a stage (assemblies, groups,
+/// components, and gprims outside components), for culling against a
+/// camera frustum. Bounds are stored structure-of-arrays with children
+/// contiguous, so a node's children are tested and projected in one loop.
+/// Only the leaves of the hierarchy are computed from the stage, and only
+/// those edited or animated since; the nodes above them are their union.
+class ModelBoundsCache {
+public:
+    struct ModelBounds {
+        pxr::SdfPath path;
+        pxr::GfRange3d range;
+    };
+
+    ModelBoundsCache();
+
+    void setStage(const pxr::UsdStageRefPtr &stage);
+
+    /// Only the bounds the stage animates are recomputed on time changes.
+    void setTime(pxr::UsdTimeCode time);
+
+    void setIncludedPurposes(const pxr::TfTokenVector &purposes);
+
+    void setUseExtentsHint(bool value);
+
+    /// The model hierarchy changed; rebuilt on the next query.
+    void invalidate();
+
+    /// Properties changed; bounds are recomputed on the next query.
+    void invalidateBounds();
+
+    /// Properties of `paths` changed; the bounds of the models at, above and
+    /// below them are recomputed on the next query.
+    void invalidateBounds(const pxr::SdfPathVector &paths);
+
+    /// Range along the view direction covered by the bounds of the models
+    /// inside `frustum`, or nullopt if none are.
+    std::optional<pxr::GfRange1d> rangeInFrustum(const pxr::GfFrustum &frustum);
+
+    /// Components outside of instances with their world bounds, breadth first.
+    const std::vector<ModelBounds> &components();
+
+    /// Bumped whenever bounds are recomputed.
+    [[nodiscard]] uint64_t version() const { return _version; }
+
+private:
+    struct Node {
+        pxr::UsdPrim prim;
+        uint32_t firstChild{0};
+        uint32_t childCount{0};
+        /// Leaves only: the bounds may change with time, and have to be computed again.
+        bool timeVarying{false};
+        bool dirty{true};
+    };
+
+    void _update();
+    void _rebuild();
+    void _updateBounds();
+
+    pxr::UsdStageRefPtr _stage;
+    pxr::UsdGeomBBoxCache _bboxCache;
+    bool _timeVarying{false};
+    bool _structureDirty{true};
+    /// Every leaf is dirty, or only some of them.
+    bool _boundsDirty{true};
+    bool _someBoundsDirty{false};
+    uint64_t _version{0};
+    uint64_t _componentsVersion{0};
+    std::vector<ModelBounds> _components;
+
+    // Node 0 is the pseudo root, children of a node are contiguous.
+    std::vector<Node> _nodes;
+    /// Leaves by path; descendants of a path sort right after it.
+    std::map<pxr::SdfPath, uint32_t> _leaves;
+    std::vector<uint32_t> _timeVaryingLeaves;
+    std::vector<double> _centerX, _centerY, _centerZ;
+    std::vector<double> _extentX, _extentY, _extentZ;
+};
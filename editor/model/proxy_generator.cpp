@@ -0,0 +1,348 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "proxy_generator.h"
+#include "mesh_simplifier.h"
+
+#include <QStandardPaths>
+#include <fmt/format.h>
+#include <pxr/base/arch/hash.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/listOp.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/relationshipSpec.h>
+#include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/primvarsAPI.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/subset.h>
+#include <pxr/usd/usdShade/materialBindingAPI.h>
+#include <pxr/usd/usdShade/shader.h>
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+/// Custom data of a proxy holding the hash of the mesh it was simplified from.
+const std::string HashKey = "proxyHash";
+
+/// A render mesh and its proxy, simplified or found in the sidecar.
+struct Job {
+    pxr::UsdPrim prim;
+    pxr::VtVec3fArray points;
+    pxr::VtIntArray counts;
+    pxr::VtIntArray indices;
+    std::string hash;
+    size_t sourceTriangles{0};
+    pxr::VtVec3fArray proxyPoints;
+    pxr::VtIntArray proxyIndices;
+    bool cached{false};
+};
+
+/// Stays the same from one session to the next, so it can name the proxies saved.
+std::string hashMesh(const Job &job, float ratio) {
+    auto hash = pxr::ArchHash64(reinterpret_cast<const char *>(&ratio), sizeof(ratio));
+    hash = pxr::ArchHash64(reinterpret_cast<const char *>(job.points.cdata()), job.points.size() * sizeof(pxr::GfVec3f), hash);
+    hash = pxr::ArchHash64(reinterpret_cast<const char *>(job.counts.cdata()), job.counts.size() * sizeof(int), hash);
+    hash = pxr::ArchHash64(reinterpret_cast<const char *>(job.indices.cdata()), job.indices.size() * sizeof(int), hash);
+    return fmt::format("{:016x}", hash);
+}
+
+/// Next to the root layer first, then in the cache for stages that can't have one there.
+std::vector<std::string> sidecarCandidates(const pxr::UsdStageRefPtr &stage) {
+    std::vector<std::string> candidates;
+    const auto &root = stage->GetRootLayer();
+    std::filesystem::path rootPath(root->GetRealPath());
+    if (!rootPath.empty()) {
+        candidates.push_back((rootPath.parent_path() / (rootPath.stem().string() + ".proxy.usdc")).string());
+    }
+    auto cache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString();
+    auto directory = (cache.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(cache)) / "proxies";
+    const auto &identifier = root->GetIdentifier();
+    candidates.push_back((directory / fmt::format("{:016x}.proxy.usdc", pxr::ArchHash64(identifier.data(), identifier.size()))).string());
+    return candidates;
+}
+
+void sublayer(const pxr::UsdStageRefPtr &stage, const pxr::SdfLayerRefPtr &layer) {
+    auto session = stage->GetSessionLayer();
+    auto paths = session->GetSubLayerPaths();
+    if (std::find(paths.begin(), paths.end(), layer->GetIdentifier()) == paths.end()) {
+        session->InsertSubLayerPath(layer->GetIdentifier());
+    }
+}
+
+void setAttribute(const pxr::SdfPrimSpecHandle &spec, const pxr::TfToken &name, const pxr::SdfValueTypeName &type,
+                  const pxr::VtValue &value, pxr::SdfVariability variability = pxr::SdfVariabilityVarying) {
+    if (auto attr = pxr::SdfAttributeSpec::New(spec, name, type, variability)) {
+        attr->SetDefaultValue(value);
+    }
+}
+
+/// The mesh stays as it was authored, but is drawn only for render purpose and names its proxy.
+void authorRenderMesh(const pxr::SdfLayerRefPtr &layer, const pxr::SdfPath &path, const pxr::SdfPath &proxyPath) {
+    auto spec = pxr::SdfCreatePrimInLayer(layer, path);
+    setAttribute(spec, pxr::UsdGeomTokens->purpose, pxr::SdfValueTypeNames->Token,
+                 pxr::VtValue(pxr::UsdGeomTokens->render), pxr::SdfVariabilityUniform);
+    if (auto rel = pxr::SdfRelationshipSpec::New(spec, pxr::UsdGeomTokens->proxyPrim)) {
+        rel->GetTargetPathList().Prepend(proxyPath);
+    }
+}
+
+/// The diffuse color of the surface `material` outputs, if it is a constant.
+std::optional<pxr::GfVec3f> diffuseColor(const pxr::UsdShadeMaterial &material) {
+    static const pxr::TfToken diffuseColorInput("diffuseColor");
+    auto shader = material ? material.ComputeSurfaceSource() : pxr::UsdShadeShader();
+    auto input = shader ? shader.GetInput(diffuseColorInput) : pxr::UsdShadeInput();
+    pxr::GfVec3f color;
+    if (!input || !input.Get(&color)) {
+        return std::nullopt;
+    }
+    return color;
+}
+
+/// The proxy has no faces to keep per-face materials apart, so a mesh with material subsets
+/// is drawn in the diffuse colors of its materials, averaged over the faces they cover.
+std::optional<pxr::GfVec3f> subsetColor(const pxr::UsdPrim &prim, size_t faceCount) {
+    pxr::UsdShadeMaterialBindingAPI binding(prim);
+    auto subsets = binding.GetMaterialBindSubsets();
+    if (subsets.empty() || faceCount == 0) {
+        return std::nullopt;
+    }
+    pxr::GfVec3f sum(0.f);
+    float weight = 0.f;
+    size_t covered = 0;
+    for (const auto &subset : subsets) {
+        pxr::VtIntArray indices;
+        subset.GetIndicesAttr().Get(&indices, pxr::UsdTimeCode::EarliestTime());
+        auto color = diffuseColor(pxr::UsdShadeMaterialBindingAPI(subset.GetPrim()).ComputeBoundMaterial());
+        covered += indices.size();
+        if (color && !indices.empty()) {
+            sum += *color * float(indices.size());
+            weight += float(indices.size());
+        }
+    }
+    // Faces in no subset keep the mesh's own material.
+    if (covered < faceCount) {
+        if (auto color = diffuseColor(binding.ComputeBoundMaterial())) {
+            sum += *color * float(faceCount - covered);
+            weight += float(faceCount - covered);
+        }
+    }
+    if (weight == 0.f) {
+        return std::nullopt;
+    }
+    return sum / weight;
+}
+
+void authorProxy(const pxr::SdfLayerRefPtr &layer, const pxr::SdfPath &path, const Job &job) {
+    auto spec = pxr::SdfCreatePrimInLayer(layer, path);
+    spec->SetSpecifier(pxr::SdfSpecifierDef);
+    spec->SetTypeName("Mesh");
+    spec->SetCustomData(pxr::TfToken(HashKey), pxr::VtValue(job.hash));
+
+    pxr::VtIntArray counts(job.proxyIndices.size() / 3, 3);
+    pxr::VtVec3fArray extent;
+    pxr::UsdGeomPointBased::ComputeExtent(job.proxyPoints, &extent);
+    setAttribute(spec, pxr::UsdGeomTokens->purpose, pxr::SdfValueTypeNames->Token,
+                 pxr::VtValue(pxr::UsdGeomTokens->proxy), pxr::SdfVariabilityUniform);
+    setAttribute(spec, pxr::UsdGeomTokens->points, pxr::SdfValueTypeNames->Point3fArray, pxr::VtValue(job.proxyPoints));
+    setAttribute(spec, pxr::UsdGeomTokens->faceVertexCounts, pxr::SdfValueTypeNames->IntArray, pxr::VtValue(counts));
+    setAttribute(spec, pxr::UsdGeomTokens->faceVertexIndices, pxr::SdfValueTypeNames->IntArray, pxr::VtValue(job.proxyIndices));
+    setAttribute(spec, pxr::UsdGeomTokens->extent, pxr::SdfValueTypeNames->Float3Array, pxr::VtValue(extent));
+    setAttribute(spec, pxr::UsdGeomTokens->subdivisionScheme, pxr::SdfValueTypeNames->Token,
+                 pxr::VtValue(pxr::UsdGeomTokens->none), pxr::SdfVariabilityUniform);
+
+    // Looks like the mesh it stands in for: same place, sidedness, winding, material and color.
+    const auto &prim = job.prim;
+    pxr::GfMatrix4d transform(1.0);
+    bool resetsXformStack = false;
+    pxr::UsdGeomXformable(prim).GetLocalTransformation(&transform, &resetsXformStack);
+    pxr::VtTokenArray order;
+    if (resetsXformStack) {
+        order.push_back(pxr::UsdGeomXformOpTypes->resetXformStack);
+    }
+    if (transform != pxr::GfMatrix4d(1.0)) {
+        static const pxr::TfToken transformOp("xformOp:transform");
+        setAttribute(spec, transformOp, pxr::SdfValueTypeNames->Matrix4d, pxr::VtValue(transform));
+        order.push_back(transformOp);
+    }
+    if (!order.empty()) {
+        setAttribute(spec, pxr::UsdGeomTokens->xformOpOrder, pxr::SdfValueTypeNames->TokenArray,
+                     pxr::VtValue(order), pxr::SdfVariabilityUniform);
+    }
+    bool doubleSided = false;
+    if (pxr::UsdGeomMesh(prim).GetDoubleSidedAttr().Get(&doubleSided) && doubleSided) {
+        setAttribute(spec, pxr::UsdGeomTokens->doubleSided, pxr::SdfValueTypeNames->Bool,
+                     pxr::VtValue(true), pxr::SdfVariabilityUniform);
+    }
+    // The simplified triangles keep the winding of the faces they came from.
+    pxr::TfToken orientation;
+    if (pxr::UsdGeomMesh(prim).GetOrientationAttr().Get(&orientation) && orientation == pxr::UsdGeomTokens->leftHanded) {
+        setAttribute(spec, pxr::UsdGeomTokens->orientation, pxr::SdfValueTypeNames->Token,
+                     pxr::VtValue(orientation), pxr::SdfVariabilityUniform);
+    }
+    if (auto color = subsetColor(prim, job.counts.size())) {
+        setAttribute(spec, pxr::UsdGeomTokens->primvarsDisplayColor, pxr::SdfValueTypeNames->Color3fArray,
+                     pxr::VtValue(pxr::VtVec3fArray{*color}));
+        return;
+    }
+    if (auto material = pxr::UsdShadeMaterialBindingAPI(prim).ComputeBoundMaterial()) {
+        pxr::SdfTokenListOp schemas;
+        schemas.SetPrependedItems({pxr::TfToken("MaterialBindingAPI")});
+        spec->SetInfo(pxr::UsdTokens->apiSchemas, pxr::VtValue(schemas));
+        if (auto rel = pxr::SdfRelationshipSpec::New(spec, pxr::UsdShadeTokens->materialBinding)) {
+            rel->GetTargetPathList().Prepend(material.GetPath());
+        }
+    }
+    // Only a constant color carries over; per-vertex ones don't survive the collapses.
+    auto displayColor = pxr::UsdGeomPrimvarsAPI(prim).GetPrimvar(pxr::UsdGeomTokens->primvarsDisplayColor);
+    pxr::VtVec3fArray colors;
+    if (displayColor && displayColor.GetInterpolation() == pxr::UsdGeomTokens->constant &&
+        displayColor.ComputeFlattened(&colors) && colors.size() == 1) {
+        setAttribute(spec, pxr::UsdGeomTokens->primvarsDisplayColor, pxr::SdfValueTypeNames->Color3fArray,
+                     pxr::VtValue(colors));
+    }
+}
+}// namespace
+
+void ProxyGenerator::setStage(const pxr::UsdStageRefPtr &stage) {
+    _stage = stage;
+    _sidecar = nullptr;
+    _sidecarPath.clear();
+    _stats = {};
+    if (!_stage) {
+        return;
+    }
+    auto candidates = sidecarCandidates(_stage);
+    _sidecarPath = candidates.front();
+    for (const auto &candidate : candidates) {
+        std::error_code error;
+        if (std::filesystem::exists(candidate, error)) {
+            if ((_sidecar = pxr::SdfLayer::FindOrOpen(candidate))) {
+                _sidecarPath = candidate;
+                sublayer(_stage, _sidecar);
+            }
+            break;
+        }
+    }
+}
+
+bool ProxyGenerator::generate(float ratio) {
+    _stats = {};
+    if (!_stage) {
+        return false;
+    }
+    if (!_sidecar) {
+        for (const auto &candidate : sidecarCandidates(_stage)) {
+            std::error_code error;
+            std::filesystem::create_directories(std::filesystem::path(candidate).parent_path(), error);
+            _sidecar = std::filesystem::exists(candidate, error) ? pxr::SdfLayer::FindOrOpen(candidate)
+                                                                 : pxr::SdfLayer::CreateNew(candidate);
+            if (_sidecar) {
+                _sidecarPath = candidate;
+                break;
+            }
+        }
+        if (!_sidecar) {
+            return false;
+        }
+    }
+
+    // Proxies of the last run, by the hash of their mesh; the sidecar is then
+    // cleared, so the stage shows the meshes as the asset authored them.
+    std::unordered_map<std::string, std::pair<pxr::VtVec3fArray, pxr::VtIntArray>> previous;
+    _sidecar->Traverse(pxr::SdfPath::AbsoluteRootPath(), [&](const pxr::SdfPath &path) {
+        auto spec = _sidecar->GetPrimAtPath(path);
+        if (!spec) {
+            return;
+        }
+        auto hash = spec->GetCustomData().find(HashKey);
+        auto points = _sidecar->GetAttributeAtPath(path.AppendProperty(pxr::UsdGeomTokens->points));
+        auto indices = _sidecar->GetAttributeAtPath(path.AppendProperty(pxr::UsdGeomTokens->faceVertexIndices));
+        if (hash != spec->GetCustomData().end() && hash->second.IsHolding<std::string>() && points && indices &&
+            points->GetDefaultValue().IsHolding<pxr::VtVec3fArray>() && indices->GetDefaultValue().IsHolding<pxr::VtIntArray>()) {
+            previous.emplace(hash->second.UncheckedGet<std::string>(),
+                             std::make_pair(points->GetDefaultValue().UncheckedGet<pxr::VtVec3fArray>(),
+                                            indices->GetDefaultValue().UncheckedGet<pxr::VtIntArray>()));
+        }
+    });
+    _sidecar->Clear();
+
+    std::vector<Job> jobs;
+    for (const auto &prim : _stage->Traverse()) {
+        pxr::UsdGeomMesh mesh(prim);
+        if (!mesh) {
+            continue;
+        }
+        auto purpose = mesh.ComputePurpose();
+        if (purpose != pxr::UsdGeomTokens->default_ && purpose != pxr::UsdGeomTokens->render) {
+            continue;
+        }
+        // Meshes with a proxy of their own, or whose proxy name is taken, are left alone.
+        pxr::SdfPathVector targets;
+        if (mesh.GetProxyPrimRel().GetTargets(&targets) && !targets.empty()) {
+            continue;
+        }
+        auto proxyName = prim.GetName().GetString() + "_proxy";
+        if (prim.GetParent().GetChild(pxr::TfToken(proxyName))) {
+            continue;
+        }
+        // Deforming meshes would need a proxy per frame.
+        if (mesh.GetPointsAttr().ValueMightBeTimeVarying()) {
+            continue;
+        }
+        Job job{prim};
+        auto time = pxr::UsdTimeCode::EarliestTime();
+        if (mesh.GetPointsAttr().Get(&job.points, time) && mesh.GetFaceVertexCountsAttr().Get(&job.counts, time) &&
+            mesh.GetFaceVertexIndicesAttr().Get(&job.indices, time) && !job.points.empty()) {
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    pxr::WorkParallelForN(jobs.size(), [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto &job = jobs[i];
+            job.hash = hashMesh(job, ratio);
+            if (auto found = previous.find(job.hash); found != previous.end()) {
+                std::tie(job.proxyPoints, job.proxyIndices) = found->second;
+                for (auto count : job.counts) {
+                    job.sourceTriangles += size_t(std::max(count - 2, 0));
+                }
+                job.cached = true;
+                continue;
+            }
+            auto simplified = simplifyMesh(job.points, job.counts, job.indices, ratio);
+            job.sourceTriangles = simplified.sourceTriangles;
+            job.proxyPoints = std::move(simplified.points);
+            job.proxyIndices = std::move(simplified.faceVertexIndices);
+        }
+    });
+
+    {
+        pxr::SdfChangeBlock changeBlock;
+        for (const auto &job : jobs) {
+            if (job.proxyIndices.empty()) {
+                continue;
+            }
+            auto path = job.prim.GetPath();
+            auto proxyPath = path.GetParentPath().AppendChild(pxr::TfToken(path.GetName() + "_proxy"));
+            authorRenderMesh(_sidecar, path, proxyPath);
+            authorProxy(_sidecar, proxyPath, job);
+
+            ++(job.cached ? _stats.cached : _stats.generated);
+            _stats.trianglesBefore += job.sourceTriangles;
+            _stats.trianglesAfter += job.proxyIndices.size() / 3;
+        }
+    }
+    _stats.meshes = jobs.size();
+    sublayer(_stage, _sidecar);
+    return _sidecar->Save();
+}
@@ -0,0 +1,55 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/usd/stage.h>
+#include <string>
+
+/// Gives the render meshes of a stage simplified stand-ins of proxy purpose,
+/// for assets authored without any. Meshes are simplified on worker threads
+/// by quadric edge collapse, and each one gets a `<name>_proxy` sibling with
+/// the same transform, orientation, material and display color, while the
+/// mesh itself is made of render purpose and points at its proxy. Meshes with
+/// per-face material subsets get their materials' averaged diffuse color
+/// instead, as the simplified faces no longer match the subsets.
+///
+/// The results go to a sidecar layer next to the root layer, sublayered in
+/// the session layer whenever the stage is opened again. Proxies are named
+/// by a hash of the mesh they came from, so meshes that didn't change since
+/// the last run are taken from the sidecar instead of simplified again.
+class ProxyGenerator {
+public:
+    struct Stats {
+        /// Render meshes of the stage without a proxy of their own.
+        size_t meshes{0};
+        /// Proxies simplified by this run, and taken from the sidecar.
+        size_t generated{0};
+        size_t cached{0};
+        /// Triangles of those meshes, and of their proxies.
+        size_t trianglesBefore{0};
+        size_t trianglesAfter{0};
+    };
+
+    /// Sublayers the sidecar of `stage` in its session layer, if there is one.
+    void setStage(const pxr::UsdStageRefPtr &stage);
+
+    /// Simplifies the render meshes to about `ratio` of their triangles and
+    /// saves the proxies to the sidecar. Returns false if it couldn't be written.
+    bool generate(float ratio);
+
+    [[nodiscard]] const Stats &stats() const { return _stats; }
+
+    /// Where the proxies of the current stage are saved.
+    [[nodiscard]] const std::string &sidecarPath() const { return _sidecarPath; }
+
+private:
+    pxr::UsdStageRefPtr _stage;
+    pxr::SdfLayerRefPtr _sidecar;
+    std::string _sidecarPath;
+    Stats _stats;
+};
@@ -6,6 +6,9 @@
 
 #include "root_data_model.h"
 #include "common.h"
+#include "viewer_edit.h"
+
+#include <pxr/base/work/detachedTask.h>
 
 RootDataModel::RootDataModel()
     : _bboxCache{_currentFrame,
@@ -25,7 +28,21 @@ void RootDataModel::setStage(pxr::UsdStageRefPtr value) {
             _pcListener = std::nullopt;
         }
 
+        // Held until every listener has moved to the new stage, then released off the main thread.
+        auto previous = std::move(_stage);
         _stage = value;
+        // Sublayered before instancing, which leaves prims with proxies in the session layer stack alone.
+        _proxyGenerator.setStage(_stage);
+        if (_autoInstancing) {
+            _autoInstancer.apply(_stage);
+        } else {
+            _autoInstancer = {};
+        }
+        _modelBounds.setStage(_stage);
+        _attributeQueries.setStage(_stage);
+        _framePrefetcher.setStage(_stage);
+        _texturePrefetcher.cancel();
+        _textureBudget.setStage(_stage);
 
         if (_stage) {
             _pcListener = pxr::TfNotice::Register(pxr::TfCreateWeakPtr(this),
@@ -33,6 +50,9 @@ void RootDataModel::setStage(pxr::UsdStageRefPtr value) {
                                                   _stage);
         }
         emit signalStageReplaced();
+        if (previous) {
+            pxr::WorkMoveDestroyAsync(previous);
+        }
     }
 }
 
@@ -43,6 +63,8 @@ void RootDataModel::setCurrentFrame(pxr::UsdTimeCode &frame) {
     _currentFrame = frame;
     _bboxCache.SetTime(_currentFrame);
     _xformCache.SetTime(_currentFrame);
+    _modelBounds.setTime(_currentFrame);
+    _attributeQueries.setPrefetchedFrame(_framePrefetcher.frame(_currentFrame));
 }
 
 bool RootDataModel::playing() const {
@@ -52,6 +74,13 @@ void RootDataModel::setPlaying(bool flags) {
     _playing = flags;
 }
 
+bool RootDataModel::autoInstancing() const {
+    return _autoInstancing;
+}
+void RootDataModel::setAutoInstancing(bool value) {
+    _autoInstancing = value;
+}
+
 bool RootDataModel::useExtentsHint() {
     return _bboxCache.GetUseExtentsHint();
 }
@@ -61,6 +90,7 @@ void RootDataModel::setUseExtentsHint(bool value) {
         // other alternative, currently.
         auto purposes = _bboxCache.GetIncludedPurposes();
         _bboxCache = pxr::UsdGeomBBoxCache(_currentFrame, purposes, value);
+        _modelBounds.setUseExtentsHint(value);
     }
 }
 
@@ -72,12 +102,41 @@ std::set<pxr::TfToken> RootDataModel::includedPurposes() {
 void RootDataModel::setIncludedPurposes(const std::set<pxr::TfToken> &value) {
     std::vector<pxr::TfToken> purposes(value.begin(), value.end());
     _bboxCache.SetIncludedPurposes(purposes);
+    _modelBounds.setIncludedPurposes(purposes);
 }
 
 pxr::GfBBox3d RootDataModel::computeWorldBound(const pxr::UsdPrim &prim) {
     return _bboxCache.ComputeWorldBound(prim);
 }
 
+ModelBoundsCache &RootDataModel::modelBounds() {
+    return _modelBounds;
+}
+
+AttributeQueryCache &RootDataModel::attributeQueries() {
+    return _attributeQueries;
+}
+
+FramePrefetcher &RootDataModel::framePrefetcher() {
+    return _framePrefetcher;
+}
+
+TexturePrefetcher &RootDataModel::texturePrefetcher() {
+    return _texturePrefetcher;
+}
+
+TextureBudget &RootDataModel::textureBudget() {
+    return _textureBudget;
+}
+
+const AutoInstancer &RootDataModel::autoInstancer() const {
+    return _autoInstancer;
+}
+
+ProxyGenerator &RootDataModel::proxyGenerator() {
+    return _proxyGenerator;
+}
+
 pxr::GfMatrix4d RootDataModel::getLocalToWorldTransform(const pxr::UsdPrim &prim) {
     return _xformCache.GetLocalToWorldTransform(prim);
 }
@@ -92,6 +151,10 @@ void RootDataModel::_emitPrimsChanged(ChangeNotice primChange, ChangeNotice prop
 
 void RootDataModel::_onPrimsChanged(pxr::UsdNotice::ObjectsChanged const &notice,
                                     pxr::UsdStageWeakPtr const &sender) {
+    // The viewer's own mip requests and draw modes would otherwise drop every cache, every few frames.
+    if (ViewerEdit::active()) {
+        return;
+    }
     auto primChange = ChangeNotice::NONE;
     auto propertyChange = ChangeNotice::NONE;
 
@@ -117,6 +180,23 @@ void RootDataModel::_onPrimsChanged(pxr::UsdNotice::ObjectsChanged const &notice
         }
     }
 
+    _framePrefetcher.invalidate();
+    _attributeQueries.processChanges(notice);
+
+    // Only prims coming and going change the textures.
+    if (primChange == ChangeNotice::RESYNC) {
+        _textureBudget.invalidate();
+    }
+    if (primChange == ChangeNotice::RESYNC || propertyChange == ChangeNotice::RESYNC) {
+        _modelBounds.invalidate();
+    } else if (primChange != ChangeNotice::NONE || propertyChange != ChangeNotice::NONE) {
+        pxr::SdfPathVector changedPaths;
+        for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+            changedPaths.push_back(path);
+        }
+        _modelBounds.invalidateBounds(changedPaths);
+    }
+
     _emitPrimsChanged(primChange, propertyChange);
 }
 void RootDataModel::_clearCaches() {
@@ -14,6 +14,13 @@
 #include <pxr/usd/usd/notice.h>
 #include <pxr/base/tf/notice.h>
 #include <pxr/usd/usdShade/materialBindingAPI.h>
+#include "model_bounds_cache.h"
+#include "attribute_query_cache.h"
+#include "frame_prefetcher.h"
+#include "texture_prefetcher.h"
+#include "texture_budget.h"
+#include "auto_instancer.h"
+#include "proxy_generator.h"
 
 enum class ChangeNotice {
     NONE = 0,
@@ -47,6 +54,10 @@ public:
     bool playing() const;
     void setPlaying(bool flags);
 
+    /// Whether stages set from now on have their duplicated assets instanced.
+    bool autoInstancing() const;
+    void setAutoInstancing(bool value);
+
     /// Return True if bounding box calculations use extents hints from prims.
     bool useExtentsHint();
     /// Set whether whether bounding box calculations should use extents from prims.
@@ -59,6 +70,20 @@ public:
 
     /// Compute the world-space bounds of a prim.
     pxr::GfBBox3d computeWorldBound(const pxr::UsdPrim &prim);
+    /// Bounds of the model hierarchy, for fitting clipping planes to what the camera sees.
+    ModelBoundsCache &modelBounds();
+    /// Cached attribute queries for values read every frame, such as the scene camera.
+    AttributeQueryCache &attributeQueries();
+    /// Resolves the time-varying values of upcoming frames during playback.
+    FramePrefetcher &framePrefetcher();
+    /// Reads the textures of the stage ahead of the renderer.
+    TexturePrefetcher &texturePrefetcher();
+    /// Mip levels of the stage textures, chosen to fit the texture memory budget.
+    TextureBudget &textureBudget();
+    /// What auto instancing did to the current stage.
+    const AutoInstancer &autoInstancer() const;
+    /// Simplified proxies of the render meshes, saved in a sidecar layer of the stage.
+    ProxyGenerator &proxyGenerator();
     /// Compute the transformation matrix of a prim.
     pxr::GfMatrix4d getLocalToWorldTransform(const pxr::UsdPrim &prim);
     /// Compute the material that the prim is bound to, for the given value of material purpose.
@@ -70,6 +95,14 @@ private:
     bool _playing{false};
     pxr::UsdGeomBBoxCache _bboxCache;
     pxr::UsdGeomXformCache _xformCache;
+    ModelBoundsCache _modelBounds;
+    AttributeQueryCache _attributeQueries;
+    FramePrefetcher _framePrefetcher;
+    TexturePrefetcher _texturePrefetcher;
+    TextureBudget _textureBudget;
+    AutoInstancer _autoInstancer;
+    bool _autoInstancing{false};
+    ProxyGenerator _proxyGenerator;
     std::optional<pxr::TfNotice::Key> _pcListener;
 
     void _emitPrimsChanged(ChangeNotice primChange, ChangeNotice propertyChange);
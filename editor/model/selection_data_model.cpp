@@ -120,6 +120,25 @@ void SelectionDataModel::setPrimPath(const pxr::SdfPath &path, int instance) {
     addPrimPath(path, instance);
 }
 
+void SelectionDataModel::setPrimPaths(const std::vector<std::pair<pxr::SdfPath, int>> &paths) {
+    _primSelection.clear();
+    for (const auto &[path, instance] : paths) {
+        _ensureValidPrimPath(path);
+        _validateInstanceIndexParameter(instance);
+        _primSelection.addPrimPath(path, instance);
+    }
+    _primSelectionChanged();
+}
+
+void SelectionDataModel::togglePrimPaths(const std::vector<std::pair<pxr::SdfPath, int>> &paths) {
+    for (const auto &[path, instance] : paths) {
+        _ensureValidPrimPath(path);
+        _validateInstanceIndexParameter(instance);
+        _primSelection.togglePrimPath(path, instance);
+    }
+    _primSelectionChanged();
+}
+
 pxr::SdfPath SelectionDataModel::getFocusPrimPath() {
     _requireNotBatchingPrims();
     return _primSelection.getPrimPaths()[0];
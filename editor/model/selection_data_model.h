@@ -149,6 +149,13 @@ public:
     //  selection. If an instance is given, only add that instance.
     void setPrimPath(const pxr::SdfPath &path, int instance = ALL_INSTANCES);
 
+    /// Clear the prim selection then add all (path, instance) pairs, with a
+    //  single selection changed notification.
+    void setPrimPaths(const std::vector<std::pair<pxr::SdfPath, int>> &paths);
+
+    /// Toggle all (path, instance) pairs, with a single selection changed notification.
+    void togglePrimPaths(const std::vector<std::pair<pxr::SdfPath, int>> &paths);
+
     /// Get the path currently in focus.
     pxr::SdfPath getFocusPrimPath();
 
@@ -0,0 +1,235 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "texture_budget.h"
+#include "viewer_edit.h"
+
+#include <pxr/base/work/detachedTask.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/imaging/hio/image.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/types.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <queue>
+
+namespace {
+const pxr::TfToken TextureMemoryInput("inputs:textureMemory");
+/// Textures aren't lowered below this size on their shorter side.
+constexpr int MinTextureSize = 64;
+
+/// Memory of a texture taking `fullBytes` with `level` mips dropped.
+size_t levelBytes(size_t fullBytes, int level) {
+    return fullBytes >> (2 * level);
+}
+}// namespace
+
+void TextureBudget::setStage(const pxr::UsdStageRefPtr &stage) {
+    _stage = stage;
+    _textures.clear();
+    _levels.clear();
+    // A collection still running for the previous stage is dropped when it finishes.
+    _collection.reset();
+    _dirty = true;
+    _viewProjection.reset();
+    _requestedBytes = 0;
+}
+
+void TextureBudget::invalidate() {
+    _dirty = true;
+}
+
+void TextureBudget::setBudget(size_t bytes) {
+    if (bytes == _budget) {
+        return;
+    }
+    _budget = bytes;
+    _viewProjection.reset();
+    if (_budget == 0) {
+        _clear();
+    }
+}
+
+std::vector<TextureBudget::Texture> TextureBudget::_collect(const pxr::UsdStageRefPtr &stage) {
+    // One texture per file, however many shaders read it.
+    std::map<std::string, Texture> files;
+    for (auto &usage : collectTextureUsage(stage)) {
+        // Prototype shaders can't be edited, and dome lights have no memory request.
+        if (usage.domeLight || stage->GetPrimAtPath(usage.primPath).IsInPrototype()) {
+            continue;
+        }
+        auto &texture = files[usage.filePath];
+        texture.filePath = usage.filePath;
+        texture.shaders.push_back(usage.primPath);
+        texture.bounds.insert(texture.bounds.end(), usage.bounds.begin(), usage.bounds.end());
+    }
+    std::vector<Texture> textures;
+    textures.reserve(files.size());
+    for (auto &[path, texture] : files) {
+        textures.push_back(std::move(texture));
+    }
+
+    // Only headers are read; every tile of a UDIM set adds its own memory.
+    pxr::WorkParallelForN(textures.size(), [&textures](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto &texture = textures[i];
+            texture.maxLevel = std::numeric_limits<int>::max();
+            for (const auto &tile : expandUdim(texture.filePath)) {
+                auto image = pxr::HioImage::OpenForReading(tile);
+                if (!image) {
+                    continue;
+                }
+                auto width = size_t(image->GetWidth());
+                auto height = size_t(image->GetHeight());
+                texture.bytesPerTexel = size_t(std::max(image->GetBytesPerPixel(), 1));
+                texture.fullBytes += width * height * texture.bytesPerTexel * 4 / 3;
+                int maxLevel = 0;
+                for (auto side = std::min(width, height); side / 2 >= size_t(MinTextureSize); side /= 2) {
+                    ++maxLevel;
+                }
+                texture.maxLevel = std::min(texture.maxLevel, maxLevel);
+            }
+            if (texture.fullBytes == 0) {
+                texture.maxLevel = 0;
+            }
+        }
+    });
+    return textures;
+}
+
+void TextureBudget::update(const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize) {
+    if (!_stage || _budget == 0) {
+        return;
+    }
+    if (_dirty && !_collection) {
+        // Traversal and header reads run on a worker thread, on a stage of its own.
+        _dirty = false;
+        _collection = std::make_shared<Collection>();
+        pxr::WorkRunDetachedTask([collection = _collection, snapshot = StageSnapshot(_stage)]() {
+            std::vector<Texture> textures;
+            if (auto copy = snapshot.open()) {
+                textures = _collect(copy);
+            }
+            std::lock_guard<std::mutex> lock(collection->mutex);
+            collection->textures = std::move(textures);
+            collection->done = true;
+        });
+    }
+    auto collected = false;
+    if (_collection) {
+        std::lock_guard<std::mutex> lock(_collection->mutex);
+        if (_collection->done) {
+            _textures = std::move(_collection->textures);
+            collected = true;
+        }
+    }
+    if (collected) {
+        _collection.reset();
+    } else if (_collection || (_viewProjection == viewProjection && _windowSize == windowSize)) {
+        return;
+    }
+    _viewProjection = viewProjection;
+    _windowSize = windowSize;
+
+    auto pixels = double(windowSize[0]) * double(windowSize[1]);
+    std::vector<int> levels(_textures.size(), 0);
+    size_t total = 0;
+    for (size_t i = 0; i < _textures.size(); ++i) {
+        const auto &texture = _textures[i];
+        // The level last authored, the same on each of the file's shaders.
+        auto authored = _levels.find(texture.shaders.front());
+        auto current = authored != _levels.end() ? authored->second : 0;
+        double area = 0.0;
+        for (const auto &bbox : texture.bounds) {
+            area += screenArea(bbox, viewProjection);
+        }
+        // About one texel per pixel covered, with its mip chain.
+        auto wanted = area * pixels * double(texture.bytesPerTexel) * 4.0 / 3.0;
+        auto &level = levels[i];
+        while (level < texture.maxLevel && double(levelBytes(texture.fullBytes, level + 1)) >= wanted) {
+            ++level;
+        }
+        // Going coarser waits until the footprint is well inside the lower level,
+        // so small camera moves don't reload a texture back and forth.
+        if (level > current && double(levelBytes(texture.fullBytes, level)) < 2.0 * wanted) {
+            level = std::max(current, level - 1);
+        }
+        total += levelBytes(texture.fullBytes, level);
+    }
+
+    // Over budget, the textures using the most memory give up a level first.
+    auto larger = [&](size_t a, size_t b) {
+        return levelBytes(_textures[a].fullBytes, levels[a]) < levelBytes(_textures[b].fullBytes, levels[b]);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(larger)> queue(larger);
+    for (size_t i = 0; i < _textures.size(); ++i) {
+        if (levels[i] < _textures[i].maxLevel) {
+            queue.push(i);
+        }
+    }
+    while (total > _budget && !queue.empty()) {
+        auto i = queue.top();
+        queue.pop();
+        total -= levelBytes(_textures[i].fullBytes, levels[i]) - levelBytes(_textures[i].fullBytes, levels[i] + 1);
+        if (++levels[i] < _textures[i].maxLevel) {
+            queue.push(i);
+        }
+    }
+    _requestedBytes = total;
+    _author(levels);
+}
+
+void TextureBudget::_author(const std::vector<int> &levels) {
+    // Sdf edits, so the whole update is a single change notice, which the data model skips.
+    auto layer = _stage->GetSessionLayer();
+    ViewerEdit viewerEdit;
+    pxr::SdfChangeBlock changeBlock;
+    auto setLevel = [&](const pxr::SdfPath &shader, int level, size_t bytes) {
+        auto &authored = _levels[shader];
+        if (authored == level) {
+            return;
+        }
+        authored = level;
+        auto path = shader.AppendProperty(TextureMemoryInput);
+        if (level == 0) {
+            auto primSpec = layer->GetPrimAtPath(shader);
+            if (auto spec = layer->GetAttributeAtPath(path); primSpec && spec) {
+                primSpec->RemoveProperty(spec);
+            }
+            return;
+        }
+        auto spec = layer->GetAttributeAtPath(path);
+        if (!spec) {
+            auto primSpec = pxr::SdfCreatePrimInLayer(layer, shader);
+            spec = pxr::SdfAttributeSpec::New(primSpec, TextureMemoryInput, pxr::SdfValueTypeNames->Float);
+        }
+        if (spec) {
+            spec->SetDefaultValue(pxr::VtValue(float(bytes)));
+        }
+    };
+    if (levels.empty()) {
+        for (auto &[shader, level] : _levels) {
+            setLevel(shader, 0, 0);
+        }
+        return;
+    }
+    for (size_t i = 0; i < _textures.size(); ++i) {
+        const auto &texture = _textures[i];
+        for (const auto &shader : texture.shaders) {
+            setLevel(shader, levels[i], levelBytes(texture.fullBytes, levels[i]));
+        }
+    }
+}
+
+void TextureBudget::_clear() {
+    if (_stage) {
+        _author({});
+    }
+    _requestedBytes = 0;
+}
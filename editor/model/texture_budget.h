@@ -0,0 +1,86 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec2i.h>
+#include <pxr/usd/usd/stage.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "texture_usage.h"
+
+/// Keeps the textures of a stage within a memory budget by requesting each
+/// one at the mip level its screen footprint needs. Textures covering few
+/// pixels are asked for at a coarser level, and when the requests still
+/// exceed the budget the ones using the most memory are lowered first.
+/// Requests are authored as `inputs:textureMemory` on the UsdUVTexture
+/// shaders, in the session layer, which Storm reloads the texture for.
+/// A file read by several shaders is one texture, requested alike on each.
+class TextureBudget {
+public:
+    void setStage(const pxr::UsdStageRefPtr &stage);
+
+    /// Collects the textures again on the next update; call when prims were added or removed.
+    void invalidate();
+
+    /// Bytes the stage textures may use, 0 for no limit. Without a limit
+    /// every request is cleared and textures load in full.
+    void setBudget(size_t bytes);
+    [[nodiscard]] size_t budget() const { return _budget; }
+
+    /// Chooses the mip level of each texture as seen through `viewProjection`
+    /// in a window of `windowSize` pixels, and authors the ones that changed.
+    /// Does nothing if the view, the budget and the textures are as last time.
+    /// Textures are collected, and their headers read, on a worker thread from
+    /// a copy of the stage; until that finishes the previous levels are kept.
+    /// Edits the stage, so it must not be read by other threads meanwhile.
+    void update(const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize);
+
+    /// Memory of the textures at the levels requested, as they'd load.
+    [[nodiscard]] size_t requestedBytes() const { return _requestedBytes; }
+
+private:
+    struct Texture {
+        /// Resolved file, or anchored UDIM set.
+        std::string filePath;
+        /// UsdUVTexture shaders reading the file, outside prototypes.
+        std::vector<pxr::SdfPath> shaders;
+        /// World bounds of the geometry seen with the file, over every shader.
+        std::vector<pxr::GfBBox3d> bounds;
+        /// Memory with the full mip chain at full resolution, summed over UDIM tiles.
+        size_t fullBytes{0};
+        size_t bytesPerTexel{4};
+        /// Levels that can be dropped before reaching the smallest size kept.
+        int maxLevel{0};
+    };
+
+    /// Textures being collected by a worker thread.
+    struct Collection {
+        std::mutex mutex;
+        std::vector<Texture> textures;
+        bool done{false};
+    };
+
+    static std::vector<Texture> _collect(const pxr::UsdStageRefPtr &stage);
+    void _author(const std::vector<int> &levels);
+    void _clear();
+
+    pxr::UsdStageRefPtr _stage;
+    std::vector<Texture> _textures;
+    /// Level authored on each shader; 0 loads the full texture.
+    std::unordered_map<pxr::SdfPath, int, pxr::SdfPath::Hash> _levels;
+    std::shared_ptr<Collection> _collection;
+    bool _dirty{true};
+    std::optional<pxr::GfMatrix4d> _viewProjection;
+    pxr::GfVec2i _windowSize{0};
+    size_t _budget{0};
+    size_t _requestedBytes{0};
+};
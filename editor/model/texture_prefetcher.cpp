@@ -0,0 +1,102 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "texture_prefetcher.h"
+
+#include "texture_usage.h"
+
+#include <pxr/base/work/detachedTask.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/ar/asset.h>
+#include <pxr/usd/ar/resolver.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+
+namespace {
+constexpr size_t ReadChunkSize = size_t(8) << 20;
+constexpr size_t MaxReaders = 8;
+}// namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+TexturePrefetcher::~TexturePrefetcher() {
+    cancel();
+}
+
+void TexturePrefetcher::cancel() {
+    if (_job) {
+        _job->cancelled = true;
+        _job.reset();
+    }
+}
+
+void TexturePrefetcher::start(const pxr::UsdStageRefPtr &stage, const pxr::GfMatrix4d &viewProjection) {
+    cancel();
+    if (!stage) {
+        return;
+    }
+    _job = std::make_shared<Job>();
+    // The traversal, like the reads, runs on a worker thread, on a stage of its own.
+    pxr::WorkRunDetachedTask([job = _job, snapshot = StageSnapshot(stage), viewProjection]() {
+        auto copy = snapshot.open();
+        if (copy && !job->cancelled) {
+            _collect(job, copy, viewProjection);
+        }
+        job->collected = true;
+    });
+}
+
+void TexturePrefetcher::_collect(const std::shared_ptr<Job> &job, const pxr::UsdStageRefPtr &stage,
+                                 const pxr::GfMatrix4d &viewProjection) {
+    std::map<std::string, double> importance;
+    for (const auto &usage : collectTextureUsage(stage)) {
+        auto &value = importance[usage.filePath];
+        if (usage.domeLight) {
+            value = std::numeric_limits<double>::infinity();
+        }
+        for (const auto &bbox : usage.bounds) {
+            value += screenArea(bbox, viewProjection);
+        }
+    }
+
+    auto &textures = job->textures;
+    for (const auto &[path, value] : importance) {
+        for (auto &tile : expandUdim(path)) {
+            textures.push_back({std::move(tile), value});
+        }
+    }
+    std::stable_sort(textures.begin(), textures.end(),
+                     [](const Texture &a, const Texture &b) { return a.importance > b.importance; });
+    job->count = textures.size();
+
+    // Each reader takes the next file in order, so the most important ones are read first.
+    auto readers = std::min({MaxReaders, size_t(pxr::WorkGetConcurrencyLimit()), textures.size()});
+    for (size_t i = 0; i < readers; ++i) {
+        pxr::WorkRunDetachedTask([job]() {
+            for (auto index = job->next++; index < job->textures.size() && !job->cancelled; index = job->next++) {
+                _read(*job, job->textures[index].path);
+                ++job->done;
+            }
+        });
+    }
+}
+
+void TexturePrefetcher::_read(Job &job, const std::string &path) {
+    auto asset = pxr::ArGetResolver().OpenAsset(pxr::ArResolvedPath(path));
+    if (!asset) {
+        return;
+    }
+    // Reading pulls the file into the system cache; the bytes themselves aren't kept.
+    std::vector<char> chunk(std::min(ReadChunkSize, asset->GetSize()));
+    for (size_t offset = 0; offset < asset->GetSize() && !job.cancelled;) {
+        auto read = asset->Read(chunk.data(), std::min(chunk.size(), asset->GetSize() - offset), offset);
+        if (read == 0) {
+            break;
+        }
+        offset += read;
+        job.bytes += read;
+    }
+}
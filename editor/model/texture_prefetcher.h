@@ -0,0 +1,65 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/usd/usd/stage.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Reads the textures a stage uses ahead of Storm, on worker threads, so
+/// the texture commit of the first frames decodes from memory instead of
+/// waiting on disk or network storage. Texture files are found on
+/// UsdUVTexture shaders and dome lights; UDIM sets are expanded to their
+/// tiles. Files are read most important first: dome lights, then by the
+/// screen area of the geometry bound to the materials using them.
+class TexturePrefetcher {
+public:
+    struct Texture {
+        std::string path;
+        /// Screen area fraction of the geometry using the texture, summed.
+        double importance{0.0};
+    };
+
+    ~TexturePrefetcher();
+
+    /// Starts collecting the textures of `stage` on a worker thread, from a copy of
+    /// it, ordered by importance seen through `viewProjection`, then reading them.
+    void start(const pxr::UsdStageRefPtr &stage, const pxr::GfMatrix4d &viewProjection);
+
+    /// Stops reading. Doesn't wait: files being read, or a collection under way,
+    /// finish in the background and are dropped.
+    void cancel();
+
+    [[nodiscard]] bool active() const {
+        return _job && !_job->cancelled && (!_job->collected || _job->done.load() < _job->count.load());
+    }
+    [[nodiscard]] size_t textureCount() const { return _job ? _job->count.load() : 0; }
+    [[nodiscard]] size_t readCount() const { return _job ? _job->done.load() : 0; }
+    [[nodiscard]] size_t bytesRead() const { return _job ? _job->bytes.load() : 0; }
+
+private:
+    /// Shared with the worker tasks, which keep it alive after a cancel.
+    struct Job {
+        /// Written by the collecting task only, before `collected` is set.
+        std::vector<Texture> textures;
+        std::atomic<size_t> count{0};
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::atomic<size_t> bytes{0};
+        std::atomic<bool> collected{false};
+        std::atomic<bool> cancelled{false};
+    };
+
+    static void _collect(const std::shared_ptr<Job> &job, const pxr::UsdStageRefPtr &stage,
+                         const pxr::GfMatrix4d &viewProjection);
+    static void _read(Job &job, const std::string &path);
+
+    std::shared_ptr<Job> _job;
+};
@@ -0,0 +1,190 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "texture_usage.h"
+
+#include <pxr/base/gf/range2d.h>
+#include <pxr/base/gf/vec4d.h>
+#include <pxr/usd/sdf/assetPath.h>
+#include <pxr/usd/sdf/layerUtils.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/gprim.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdLux/domeLight.h>
+#include <pxr/usd/usdShade/material.h>
+#include <pxr/usd/usdShade/materialBindingAPI.h>
+#include <pxr/usd/usdShade/shader.h>
+#include <filesystem>
+#include <set>
+#include <unordered_map>
+
+namespace {
+const pxr::TfToken UsdUVTextureId("UsdUVTexture");
+const pxr::TfToken FileInput("file");
+
+std::string resolvedPath(const pxr::UsdAttribute &attr) {
+    pxr::SdfAssetPath assetPath;
+    if (!attr || !attr.Get(&assetPath)) {
+        return {};
+    }
+    if (!assetPath.GetResolvedPath().empty()) {
+        return assetPath.GetResolvedPath();
+    }
+    // UDIM paths don't resolve as a whole; they are anchored like the layer anchors its
+    // other relative paths, so the tiles are looked up next to it rather than the working directory.
+    auto specs = attr.GetPropertyStack();
+    if (specs.empty() || assetPath.GetAssetPath().empty()) {
+        return assetPath.GetAssetPath();
+    }
+    return pxr::SdfComputeAssetPathRelativeToLayer(specs.front()->GetLayer(), assetPath.GetAssetPath());
+}
+}// namespace
+
+StageSnapshot::StageSnapshot(const pxr::UsdStageRefPtr &stage) {
+    if (!stage) {
+        return;
+    }
+    rootLayer = stage->GetRootLayer();
+    // Copies the sublayers too, so proxies and instancing layers are kept.
+    sessionLayer = pxr::SdfLayer::CreateAnonymous("snapshot");
+    sessionLayer->TransferContent(stage->GetSessionLayer());
+    resolverContext = stage->GetPathResolverContext();
+    loadRules = stage->GetLoadRules();
+    populationMask = stage->GetPopulationMask();
+}
+
+pxr::UsdStageRefPtr StageSnapshot::open() const {
+    if (!rootLayer) {
+        return {};
+    }
+    auto stage = pxr::UsdStage::OpenMasked(rootLayer, sessionLayer, resolverContext, populationMask,
+                                           pxr::UsdStage::LoadNone);
+    if (stage) {
+        stage->SetLoadRules(loadRules);
+    }
+    return stage;
+}
+
+std::vector<TextureUsage> collectTextureUsage(const pxr::UsdStageRefPtr &stage) {
+    std::vector<TextureUsage> textures;
+    if (!stage) {
+        return textures;
+    }
+
+    // Textures per material, found under the material prim.
+    std::unordered_map<pxr::SdfPath, std::vector<size_t>, pxr::SdfPath::Hash> materialTextures;
+    std::vector<pxr::UsdPrim> gprims;
+    std::vector<pxr::UsdPrim> instances;
+    auto visit = [&](const pxr::UsdPrim &root) {
+        for (const auto &prim : pxr::UsdPrimRange(root)) {
+            if (prim.IsInstance()) {
+                instances.push_back(prim);
+            } else if (prim.IsA<pxr::UsdGeomGprim>()) {
+                gprims.push_back(prim);
+            } else if (prim.IsA<pxr::UsdLuxDomeLight>()) {
+                auto path = resolvedPath(pxr::UsdLuxDomeLight(prim).GetTextureFileAttr());
+                if (!path.empty()) {
+                    textures.push_back({prim.GetPath(), path, true, {}});
+                }
+            } else if (pxr::UsdShadeShader shader{prim}) {
+                pxr::TfToken id;
+                if (!shader.GetShaderId(&id) || id != UsdUVTextureId) {
+                    continue;
+                }
+                auto path = resolvedPath(shader.GetInput(FileInput).GetAttr());
+                if (path.empty()) {
+                    continue;
+                }
+                for (auto parent = prim.GetParent(); parent; parent = parent.GetParent()) {
+                    if (parent.IsA<pxr::UsdShadeMaterial>()) {
+                        materialTextures[parent.GetPath()].push_back(textures.size());
+                        break;
+                    }
+                }
+                textures.push_back({prim.GetPath(), path, false, {}});
+            }
+        }
+    };
+    visit(stage->GetPseudoRoot());
+    std::unordered_map<pxr::SdfPath, std::vector<pxr::UsdPrim>, pxr::SdfPath::Hash> prototypeGprims;
+    for (const auto &prototype : stage->GetPrototypes()) {
+        auto first = gprims.size();
+        visit(prototype);
+        prototypeGprims[prototype.GetPath()].assign(gprims.begin() + long(first), gprims.end());
+        gprims.resize(first);
+    }
+
+    pxr::UsdGeomBBoxCache bboxCache(pxr::UsdTimeCode::EarliestTime(),
+                                    {pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->proxy}, true);
+    auto materials = pxr::UsdShadeMaterialBindingAPI::ComputeBoundMaterials(gprims);
+    for (size_t i = 0; i < gprims.size(); ++i) {
+        auto it = materials[i] ? materialTextures.find(materials[i].GetPath()) : materialTextures.end();
+        if (it != materialTextures.end()) {
+            auto bbox = bboxCache.ComputeWorldBound(gprims[i]);
+            for (auto texture : it->second) {
+                textures[texture].bounds.push_back(bbox);
+            }
+        }
+    }
+
+    // Each texture used inside a prototype is seen through every instance of it.
+    std::unordered_map<pxr::SdfPath, std::set<size_t>, pxr::SdfPath::Hash> prototypeTextures;
+    for (auto &[prototype, prims] : prototypeGprims) {
+        auto &used = prototypeTextures[prototype];
+        for (const auto &material : pxr::UsdShadeMaterialBindingAPI::ComputeBoundMaterials(prims)) {
+            auto it = material ? materialTextures.find(material.GetPath()) : materialTextures.end();
+            if (it != materialTextures.end()) {
+                used.insert(it->second.begin(), it->second.end());
+            }
+        }
+    }
+    for (const auto &instance : instances) {
+        auto it = prototypeTextures.find(instance.GetPrototype().GetPath());
+        if (it != prototypeTextures.end() && !it->second.empty()) {
+            auto bbox = bboxCache.ComputeWorldBound(instance);
+            for (auto texture : it->second) {
+                textures[texture].bounds.push_back(bbox);
+            }
+        }
+    }
+    return textures;
+}
+
+double screenArea(const pxr::GfBBox3d &bbox, const pxr::GfMatrix4d &viewProjection) {
+    const auto &range = bbox.GetRange();
+    if (range.IsEmpty()) {
+        return 0.0;
+    }
+    auto toClip = bbox.GetMatrix() * viewProjection;
+    pxr::GfRange2d ndc;
+    for (int i = 0; i < 8; ++i) {
+        auto corner = range.GetCorner(i);
+        auto clip = pxr::GfVec4d(corner[0], corner[1], corner[2], 1.0) * toClip;
+        if (clip[3] <= 0.0) {
+            return 1.0;
+        }
+        ndc.UnionWith(pxr::GfVec2d(clip[0] / clip[3], clip[1] / clip[3]));
+    }
+    ndc.IntersectWith(pxr::GfRange2d(pxr::GfVec2d(-1.0), pxr::GfVec2d(1.0)));
+    return ndc.IsEmpty() ? 0.0 : ndc.GetSize()[0] * ndc.GetSize()[1] * 0.25;
+}
+
+std::vector<std::string> expandUdim(const std::string &path) {
+    auto tag = path.find("<UDIM>");
+    if (tag == std::string::npos) {
+        return {path};
+    }
+    std::vector<std::string> tiles;
+    for (int tile = 1001; tile <= 1100; ++tile) {
+        auto tilePath = path.substr(0, tag) + std::to_string(tile) + path.substr(tag + 6);
+        std::error_code error;
+        if (std::filesystem::exists(tilePath, error)) {
+            tiles.push_back(std::move(tilePath));
+        }
+    }
+    return tiles;
+}
@@ -0,0 +1,53 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/bbox3d.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/usd/ar/resolverContext.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/stageLoadRules.h>
+#include <pxr/usd/usd/stagePopulationMask.h>
+#include <string>
+#include <vector>
+
+/// A texture file of a stage and the geometry it is seen on.
+struct TextureUsage {
+    /// The UsdUVTexture shader or dome light reading the file.
+    pxr::SdfPath primPath;
+    /// Resolved file path; for UDIM sets, the path anchored to the layer authoring it.
+    std::string filePath;
+    bool domeLight{false};
+    /// World bounds of the gprims bound to materials using the texture.
+    /// Geometry inside prototypes is represented by its instances' bounds.
+    std::vector<pxr::GfBBox3d> bounds;
+};
+
+/// What composing a stage again on a worker thread needs, taken on the main thread.
+/// The viewer keeps editing the session layer of the stage it draws, so the copy
+/// gets a snapshot of that layer instead of sharing it.
+struct StageSnapshot {
+    explicit StageSnapshot(const pxr::UsdStageRefPtr &stage);
+
+    /// Composes the copy, on any thread. Null if the snapshot was of no stage.
+    [[nodiscard]] pxr::UsdStageRefPtr open() const;
+
+    pxr::SdfLayerRefPtr rootLayer;
+    pxr::SdfLayerRefPtr sessionLayer;
+    pxr::ArResolverContext resolverContext;
+    pxr::UsdStageLoadRules loadRules;
+    pxr::UsdStagePopulationMask populationMask;
+};
+
+/// Collects the UsdUVTexture files and dome light textures of `stage`.
+std::vector<TextureUsage> collectTextureUsage(const pxr::UsdStageRefPtr &stage);
+
+/// Fraction of the screen covered by `bbox`, 1 if it reaches behind the camera.
+double screenArea(const pxr::GfBBox3d &bbox, const pxr::GfMatrix4d &viewProjection);
+
+/// The tiles of a UDIM set, or `path` itself.
+std::vector<std::string> expandUdim(const std::string &path);
@@ -66,6 +66,7 @@ ViewSettingsDataModel::ViewSettingsDataModel(RootDataModel &rootDataModel)
     _colorCorrectionMode = ColorCorrectionModes::SRGB;
     _ocioSettings = OCIOSettings();
     _pickMode = PickModes::PRIMS;
+    _regionSelectMode = RegionSelectModes::MARQUEE;
 
     // We need to store the trinary selHighlightMode state here,
     // because the stageView only deals in true/false (because it
@@ -94,6 +95,21 @@ ViewSettingsDataModel::ViewSettingsDataModel(RootDataModel &rootDataModel)
 
     _displayCameraOracles = false;
     _showHUD = true;
+    _enableDynamicResolution = true;
+    _targetInteractiveFps = 30.f;
+    _rolloverPrimInfo = false;
+    _playbackPrefetchFrames = 0;
+    _playbackMode = PlaybackModes::REALTIME;
+    _flipbook = false;
+    _flipbookMemoryBudget = 2.f;
+    _flipbookDiskSpill = true;
+    _shaderWarmup = false;
+    _textureMemoryBudget = 0.f;
+    _autoInstancing = false;
+    _meshMerging = false;
+    _lodScreenSize = 0.f;
+    _cardImpostors = false;
+    _refinementTriangleBudget = 0.f;
 }
 
 float ViewSettingsDataModel::defaultMaterialAmbient() const { return _defaultMaterialAmbient; }
@@ -224,6 +240,15 @@ void ViewSettingsDataModel::setPickMode(PickModes value) {
     _invisibleViewSetting();
 }
 
+RegionSelectModes ViewSettingsDataModel::regionSelectMode() {
+    return _regionSelectMode;
+}
+
+void ViewSettingsDataModel::setRegionSelectMode(RegionSelectModes value) {
+    _regionSelectMode = value;
+    _invisibleViewSetting();
+}
+
 bool ViewSettingsDataModel::showAABBox() const {
     return _showAABBox;
 }
@@ -350,6 +375,141 @@ void ViewSettingsDataModel::setShowHUD(bool value) {
     _visibleViewSetting();
 }
 
+bool ViewSettingsDataModel::enableDynamicResolution() const {
+    return _enableDynamicResolution;
+}
+
+void ViewSettingsDataModel::setEnableDynamicResolution(bool value) {
+    _enableDynamicResolution = value;
+    _invisibleViewSetting();
+}
+
+float ViewSettingsDataModel::targetInteractiveFps() const {
+    return _targetInteractiveFps;
+}
+
+void ViewSettingsDataModel::setTargetInteractiveFps(float value) {
+    _targetInteractiveFps = value;
+    _invisibleViewSetting();
+}
+
+bool ViewSettingsDataModel::rolloverPrimInfo() const {
+    return _rolloverPrimInfo;
+}
+
+void ViewSettingsDataModel::setRolloverPrimInfo(bool value) {
+    _rolloverPrimInfo = value;
+    _invisibleViewSetting();
+}
+
+int ViewSettingsDataModel::playbackPrefetchFrames() const {
+    return _playbackPrefetchFrames;
+}
+
+void ViewSettingsDataModel::setPlaybackPrefetchFrames(int value) {
+    _playbackPrefetchFrames = value;
+    _invisibleViewSetting();
+}
+
+PlaybackModes ViewSettingsDataModel::playbackMode() const {
+    return _playbackMode;
+}
+
+void ViewSettingsDataModel::setPlaybackMode(PlaybackModes value) {
+    _playbackMode = value;
+    _invisibleViewSetting();
+}
+
+bool ViewSettingsDataModel::flipbook() const {
+    return _flipbook;
+}
+
+void ViewSettingsDataModel::setFlipbook(bool value) {
+    _flipbook = value;
+    _invisibleViewSetting();
+}
+
+float ViewSettingsDataModel::flipbookMemoryBudget() const {
+    return _flipbookMemoryBudget;
+}
+
+void ViewSettingsDataModel::setFlipbookMemoryBudget(float value) {
+    _flipbookMemoryBudget = value;
+    _invisibleViewSetting();
+}
+
+bool ViewSettingsDataModel::flipbookDiskSpill() const {
+    return _flipbookDiskSpill;
+}
+
+void ViewSettingsDataModel::setFlipbookDiskSpill(bool value) {
+    _flipbookDiskSpill = value;
+    _invisibleViewSetting();
+}
+
+bool ViewSettingsDataModel::shaderWarmup() const {
+    return _shaderWarmup;
+}
+
+void ViewSettingsDataModel::setShaderWarmup(bool value) {
+    _shaderWarmup = value;
+    _invisibleViewSetting();
+}
+
+float ViewSettingsDataModel::textureMemoryBudget() const {
+    return _textureMemoryBudget;
+}
+
+void ViewSettingsDataModel::setTextureMemoryBudget(float value) {
+    _textureMemoryBudget = value;
+    _invisibleViewSetting();
+}
+
+bool ViewSettingsDataModel::autoInstancing() const {
+    return _autoInstancing;
+}
+
+void ViewSettingsDataModel::setAutoInstancing(bool value) {
+    _autoInstancing = value;
+    _invisibleViewSetting();
+}
+
+bool ViewSettingsDataModel::meshMerging() const {
+    return _meshMerging;
+}
+
+void ViewSettingsDataModel::setMeshMerging(bool value) {
+    _meshMerging = value;
+    _invisibleViewSetting();
+}
+
+float ViewSettingsDataModel::lodScreenSize() const {
+    return _lodScreenSize;
+}
+
+void ViewSettingsDataModel::setLodScreenSize(float value) {
+    _lodScreenSize = value;
+    _invisibleViewSetting();
+}
+
+bool ViewSettingsDataModel::cardImpostors() const {
+    return _cardImpostors;
+}
+
+void ViewSettingsDataModel::setCardImpostors(bool value) {
+    _cardImpostors = value;
+    _invisibleViewSetting();
+}
+
+float ViewSettingsDataModel::refinementTriangleBudget() const {
+    return _refinementTriangleBudget;
+}
+
+void ViewSettingsDataModel::setRefinementTriangleBudget(float value) {
+    _refinementTriangleBudget = value;
+    _invisibleViewSetting();
+}
+
 bool ViewSettingsDataModel::ambientLightOnly() const {
     return _ambientLightOnly;
 }
@@ -138,6 +138,10 @@ public:
     PickModes pickMode();
     void setPickMode(PickModes value);
 
+    Q_PROPERTY(RegionSelectModes regionSelectMode READ regionSelectMode WRITE setRegionSelectMode)
+    RegionSelectModes regionSelectMode();
+    void setRegionSelectMode(RegionSelectModes value);
+
     Q_PROPERTY(bool showAABBox READ showAABBox WRITE setShowAABBox)
     [[nodiscard]] bool showAABBox() const;
     void setShowAABBox(bool value);
@@ -194,6 +198,92 @@ public:
     [[nodiscard]] bool showHUD() const;
     void setShowHUD(bool value);
 
+    /// Lowers the render resolution while the camera is moved, to hold targetInteractiveFps.
+    Q_PROPERTY(bool enableDynamicResolution READ enableDynamicResolution WRITE setEnableDynamicResolution)
+    [[nodiscard]] bool enableDynamicResolution() const;
+    void setEnableDynamicResolution(bool value);
+
+    Q_PROPERTY(float targetInteractiveFps READ targetInteractiveFps WRITE setTargetInteractiveFps)
+    [[nodiscard]] float targetInteractiveFps() const;
+    void setTargetInteractiveFps(float value);
+
+    /// Reports the prim under the cursor while the mouse moves over the viewport.
+    Q_PROPERTY(bool rolloverPrimInfo READ rolloverPrimInfo WRITE setRolloverPrimInfo)
+    [[nodiscard]] bool rolloverPrimInfo() const;
+    void setRolloverPrimInfo(bool value);
+
+    /// Frames of the camera, transform, visibility and extent values the viewer
+    /// itself reads, resolved ahead of playback on worker threads; 0 disables
+    /// prefetching. Hydra reads its own values through UsdImaging and gets none
+    /// of them. Frames are whole time codes, so only every-frame playback and
+    /// the flipbook prefetch; realtime playback lands between them.
+    Q_PROPERTY(int playbackPrefetchFrames READ playbackPrefetchFrames WRITE setPlaybackPrefetchFrames)
+    [[nodiscard]] int playbackPrefetchFrames() const;
+    void setPlaybackPrefetchFrames(int value);
+
+    Q_PROPERTY(PlaybackModes playbackMode READ playbackMode WRITE setPlaybackMode)
+    [[nodiscard]] PlaybackModes playbackMode() const;
+    void setPlaybackMode(PlaybackModes value);
+
+    /// Renders the playback range once into a compressed cache, then plays it back from there.
+    Q_PROPERTY(bool flipbook READ flipbook WRITE setFlipbook)
+    [[nodiscard]] bool flipbook() const;
+    void setFlipbook(bool value);
+
+    /// Memory for compressed flipbook frames, in gigabytes.
+    Q_PROPERTY(float flipbookMemoryBudget READ flipbookMemoryBudget WRITE setFlipbookMemoryBudget)
+    [[nodiscard]] float flipbookMemoryBudget() const;
+    void setFlipbookMemoryBudget(float value);
+
+    /// Writes flipbook frames over the memory budget to the temporary directory.
+    Q_PROPERTY(bool flipbookDiskSpill READ flipbookDiskSpill WRITE setFlipbookDiskSpill)
+    [[nodiscard]] bool flipbookDiskSpill() const;
+    void setFlipbookDiskSpill(bool value);
+
+    /// Compiles the shaders of recently opened stages while the viewer is idle.
+    /// Only Metal's own on-disk compiler cache carries over to later sessions.
+    Q_PROPERTY(bool shaderWarmup READ shaderWarmup WRITE setShaderWarmup)
+    [[nodiscard]] bool shaderWarmup() const;
+    void setShaderWarmup(bool value);
+
+    /// Memory for the textures of the stage, in gigabytes, 0 for no limit.
+    /// Textures are requested at the mip level their screen footprint needs,
+    /// as the main viewport sees it; the split view draws at those levels too.
+    Q_PROPERTY(float textureMemoryBudget READ textureMemoryBudget WRITE setTextureMemoryBudget)
+    [[nodiscard]] float textureMemoryBudget() const;
+    void setTextureMemoryBudget(float value);
+
+    /// Marks duplicated assets instanceable when a stage is loaded.
+    Q_PROPERTY(bool autoInstancing READ autoInstancing WRITE setAutoInstancing)
+    [[nodiscard]] bool autoInstancing() const;
+    void setAutoInstancing(bool value);
+
+    /// Draws the static meshes of each model merged by material, rebuilding the engine when toggled.
+    Q_PROPERTY(bool meshMerging READ meshMerging WRITE setMeshMerging)
+    [[nodiscard]] bool meshMerging() const;
+    void setMeshMerging(bool value);
+
+    /// Models smaller than this many pixels on screen are drawn as their bounds,
+    /// or their proxy when they have one; 0 draws every model in full. Sizes
+    /// are measured in the main viewport and the split view follows them.
+    Q_PROPERTY(float lodScreenSize READ lodScreenSize WRITE setLodScreenSize)
+    [[nodiscard]] float lodScreenSize() const;
+    void setLodScreenSize(float value);
+
+    /// Bakes cards of the stage's models while the viewer is idle, cached on
+    /// disk, and draws small models as their cards instead of their bounds.
+    Q_PROPERTY(bool cardImpostors READ cardImpostors WRITE setCardImpostors)
+    [[nodiscard]] bool cardImpostors() const;
+    void setCardImpostors(bool value);
+
+    /// Chooses the refine level of each subdivision mesh from its size on
+    /// screen, up to the complexity setting, drawing at most this many
+    /// million triangles; 0 refines every mesh to the complexity setting.
+    /// Levels are chosen for the main viewport and the split view follows them.
+    Q_PROPERTY(float refinementTriangleBudget READ refinementTriangleBudget WRITE setRefinementTriangleBudget)
+    [[nodiscard]] float refinementTriangleBudget() const;
+    void setRefinementTriangleBudget(float value);
+
     Q_PROPERTY(bool ambientLightOnly READ ambientLightOnly WRITE setAmbientLightOnly)
     [[nodiscard]] bool ambientLightOnly() const;
     void setAmbientLightOnly(bool value);
@@ -245,6 +335,7 @@ private:
     ColorCorrectionModes _colorCorrectionMode;
     OCIOSettings _ocioSettings;
     PickModes _pickMode;
+    RegionSelectModes _regionSelectMode;
 
     // We need to store the trinary selHighlightMode state here,
     // because the stageView only deals in True/False (because it
@@ -273,6 +364,21 @@ private:
 
     bool _displayCameraOracles;
     bool _showHUD;
+    bool _enableDynamicResolution;
+    float _targetInteractiveFps;
+    bool _rolloverPrimInfo;
+    int _playbackPrefetchFrames;
+    PlaybackModes _playbackMode;
+    bool _flipbook;
+    float _flipbookMemoryBudget;
+    bool _flipbookDiskSpill;
+    bool _shaderWarmup;
+    float _textureMemoryBudget;
+    bool _autoInstancing;
+    bool _meshMerging;
+    float _lodScreenSize;
+    bool _cardImpostors;
+    float _refinementTriangleBudget;
 
     RefinementComplexities _complexity = RefinementComplexities::LOW;
     std::shared_ptr<FreeCamera> _freeCamera{};
@@ -0,0 +1,27 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+/// Marks the session layer edits the viewer makes for its own drawing, such
+/// as texture mip requests and card draw modes, while it is alive. The data
+/// model ignores the change notices sent meanwhile: they change nothing it
+/// caches, and come every few frames during playback. Create it before the
+/// SdfChangeBlock, so it is still alive when the block sends its notice.
+/// Main thread only.
+class ViewerEdit {
+public:
+    ViewerEdit() { ++_depth; }
+    ~ViewerEdit() { --_depth; }
+
+    ViewerEdit(const ViewerEdit &) = delete;
+    ViewerEdit &operator=(const ViewerEdit &) = delete;
+
+    static bool active() { return _depth > 0; }
+
+private:
+    static inline int _depth = 0;
+};
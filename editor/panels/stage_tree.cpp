@@ -97,6 +97,8 @@ PrimItemWidget *StageTreeWidget::populateItemTree(const pxr::UsdPrim &prim, QTre
     // FIXME: this will probably not work in all cases
     if (pxr::UsdGeomImageable(prim).GetVisibilityAttr()) {
         auto vis_button = new PrimVisButton();
+        vis_button->setVisibility(_model.attributeQueries().visibility(prim, _model.currentFrame()) !=
+                                  pxr::UsdGeomTokens->invisible);
         connect(vis_button, &QAbstractButton::clicked, this, [=](bool set_visibility_to) {
             toggleHierarchyVisibility(created_item, std::nullopt);
         });
@@ -47,10 +47,12 @@ void ViewSettingsWidget::_link_view_model() {
     _create_combo_box<RenderModes>(row++, "renderMode");
     _create_combo_box<ColorCorrectionModes>(row++, "colorCorrectionModes");
     _create_combo_box<PickModes>(row++, "pickMode");
+    _create_combo_box<RegionSelectModes>(row++, "regionSelectMode");
     _create_combo_box<CameraMaskModes>(row++, "cameraMaskModes");
     _create_combo_box<ClearColors>(row++, "clearColorText");
     _create_combo_box<HighlightColors>(row++, "highlightColorName");
     _create_combo_box<SelectionHighlightModes>(row++, "selHighlightMode");
+    _create_combo_box<PlaybackModes>(row++, "playbackMode");
 
     auto meta = _model.viewSettings().metaObject();
     for (int i = 0; i < meta->propertyCount(); ++i) {
@@ -0,0 +1,104 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "playback_log.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <fmt/format.h>
+
+namespace vox {
+void PlaybackLog::setEnabled(bool enabled) {
+    if (enabled && !_enabled) {
+        _rows.clear();
+    }
+    _enabled = enabled;
+}
+
+void PlaybackLog::beginFrame(double timeCode, double startTime, double endTime) {
+    auto now = Profiler::now();
+    _current = Row{};
+    _current.frame = _frames;
+    _current.timeCode = timeCode;
+    _current.intervalMs = _lastFrameNs >= 0 ? double(now - _lastFrameNs) * 1e-6 : 0.0;
+
+    if (_lastTimeCode && endTime >= startTime) {
+        auto frameCount = int64_t(std::floor(endTime - startTime)) + 1;
+        auto previous = int64_t(std::floor(*_lastTimeCode - startTime));
+        auto current = int64_t(std::floor(timeCode - startTime));
+        int64_t dropped = current >= previous ? current - previous - 1 : (frameCount - 1 - previous) + current;
+        _current.dropped = uint64_t(std::max<int64_t>(dropped, 0));
+    }
+    _dropped += _current.dropped;
+    _lastTimeCode = timeCode;
+
+    if (_firstFrameNs < 0) {
+        _firstFrameNs = now;
+    }
+    _lastFrameNs = now;
+    _frameBeginNs = now;
+}
+
+void PlaybackLog::endFrame(bool cached) {
+    if (_frameBeginNs < 0) {
+        return;
+    }
+    _current.cpuMs = double(Profiler::now() - _frameBeginNs) * 1e-6;
+    _current.cached = cached;
+    _frameBeginNs = -1;
+    ++_frames;
+    if (_enabled) {
+        _rows.push_back(_current);
+    }
+}
+
+void PlaybackLog::clear() {
+    _frames = 0;
+    _dropped = 0;
+    _lastTimeCode.reset();
+    _firstFrameNs = -1;
+    _lastFrameNs = -1;
+    _frameBeginNs = -1;
+    _rows.clear();
+}
+
+double PlaybackLog::achievedFps() const {
+    if (_frames < 2 || _lastFrameNs <= _firstFrameNs) {
+        return 0.0;
+    }
+    // Frame starts span one frame less than were shown.
+    return double(_frames - 1) / (double(_lastFrameNs - _firstFrameNs) * 1e-9);
+}
+
+bool PlaybackLog::writeCsv(const std::string &path) const {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::vector<double> cpu;
+    cpu.reserve(_rows.size());
+    for (const auto &row : _rows) {
+        cpu.push_back(row.cpuMs);
+    }
+    std::sort(cpu.begin(), cpu.end());
+    auto percentile = [&cpu](double p) {
+        return cpu.empty() ? 0.0 : cpu[std::min(cpu.size() - 1, size_t(p * double(cpu.size())))];
+    };
+    file << fmt::format("# frames {} dropped {} fps {:.2f}\n", _frames, _dropped, achievedFps());
+    file << fmt::format("# cpu ms p50 {:.3f} p95 {:.3f} p99 {:.3f} max {:.3f}\n",
+                        percentile(0.5), percentile(0.95), percentile(0.99), cpu.empty() ? 0.0 : cpu.back());
+
+    file << "frame,timeCode,dropped,intervalMs,cpuMs,cached\n";
+    for (const auto &row : _rows) {
+        file << fmt::format("{},{:.3f},{},{:.3f},{:.3f},{}\n", row.frame, row.timeCode, row.dropped,
+                            row.intervalMs, row.cpuMs, int(row.cached));
+    }
+    return file.good();
+}
+}// namespace vox
@@ -0,0 +1,67 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vox {
+/// Counts the frames shown and dropped during playback, and optionally logs
+/// the timing of each one. Logs are written as CSV with one row per frame
+/// in a fixed format, so runs of the same range from two builds line up
+/// row for row in a diff.
+class PlaybackLog {
+public:
+    struct Row {
+        uint64_t frame{0};
+        double timeCode{0.0};
+        /// Frames of the range skipped since the previous one.
+        uint64_t dropped{0};
+        /// Wall-clock time since the previous frame started.
+        double intervalMs{0.0};
+        /// Time the frame took on the CPU, from beginFrame() to endFrame().
+        double cpuMs{0.0};
+        /// Shown from the flipbook instead of rendered.
+        bool cached{false};
+    };
+
+    /// Rows are only kept while enabled; counters always run.
+    void setEnabled(bool enabled);
+    [[nodiscard]] bool enabled() const { return _enabled; }
+
+    /// Starts a frame showing `timeCode`. Frames of [startTime, endTime] passed
+    /// over since the previous frame, including across the loop, are dropped.
+    void beginFrame(double timeCode, double startTime, double endTime);
+
+    void endFrame(bool cached = false);
+
+    /// Resets the counters and drops the rows.
+    void clear();
+
+    [[nodiscard]] uint64_t frames() const { return _frames; }
+    [[nodiscard]] uint64_t dropped() const { return _dropped; }
+    /// Frames shown per second since the counters were cleared.
+    [[nodiscard]] double achievedFps() const;
+    [[nodiscard]] const std::vector<Row> &rows() const { return _rows; }
+
+    /// Writes a summary as comments, then the rows. Returns false if the file can't be written.
+    bool writeCsv(const std::string &path) const;
+
+private:
+    bool _enabled{false};
+    uint64_t _frames{0};
+    uint64_t _dropped{0};
+    std::optional<double> _lastTimeCode;
+    int64_t _firstFrameNs{-1};
+    int64_t _lastFrameNs{-1};
+    int64_t _frameBeginNs{-1};
+    Row _current;
+    std::vector<Row> _rows;
+};
+}// namespace vox
@@ -0,0 +1,91 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <fmt/format.h>
+
+namespace vox {
+std::atomic<bool> Profiler::_enabled{false};
+
+Profiler &Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setEnabled(bool enabled) noexcept {
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+int64_t Profiler::now() noexcept {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadBuffer &Profiler::_threadBuffer() {
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer) {
+        auto owned = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(_mutex);
+        owned->threadId = uint32_t(_buffers.size());
+        _buffers.push_back(owned);
+        buffer = owned.get();
+    }
+    return *buffer;
+}
+
+void Profiler::record(const char *name, int64_t beginNs, int64_t endNs) noexcept {
+    auto &buffer = _threadBuffer();
+    // Only the owning thread writes, so a relaxed load of our own head is enough.
+    auto head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % ThreadCapacity] = {name, beginNs, endNs};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::clear() noexcept {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &buffer : _buffers) {
+        buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string &path) const {
+    std::vector<std::pair<uint32_t, Event>> events;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto &buffer : _buffers) {
+            auto head = buffer->head.load(std::memory_order_acquire);
+            auto begin = std::max(buffer->tail.load(std::memory_order_relaxed),
+                                  head > ThreadCapacity ? head - ThreadCapacity : 0);
+            for (auto i = begin; i < head; ++i) {
+                events.emplace_back(buffer->threadId, buffer->events[i % ThreadCapacity]);
+            }
+        }
+    }
+    std::sort(events.begin(), events.end(), [](const auto &a, const auto &b) {
+        return a.second.beginNs < b.second.beginNs;
+    });
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    auto origin = events.empty() ? 0 : events.front().second.beginNs;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto &[threadId, event] = events[i];
+        file << fmt::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                            i == 0 ? "" : ",\n", event.name, threadId,
+                            double(event.beginNs - origin) * 1e-3, double(event.endNs - event.beginNs) * 1e-3);
+    }
+    file << "]}\n";
+    return file.good();
+}
+
+}// namespace vox
@@ -0,0 +1,90 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vox {
+/// Records named CPU time spans into per-thread ring buffers, and writes them
+/// out as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+class Profiler {
+public:
+    struct Event {
+        const char *name{};
+        int64_t beginNs{};
+        int64_t endNs{};
+    };
+
+    /// Number of events each thread keeps; older events are overwritten.
+    static constexpr size_t ThreadCapacity = 1 << 14;
+
+    static Profiler &instance();
+
+    [[nodiscard]] static bool enabled() noexcept { return _enabled.load(std::memory_order_relaxed); }
+
+    void setEnabled(bool enabled) noexcept;
+
+    /// Monotonic clock in nanoseconds.
+    [[nodiscard]] static int64_t now() noexcept;
+
+    /// Appends an event to the calling thread's buffer. `name` must outlive the profiler.
+    void record(const char *name, int64_t beginNs, int64_t endNs) noexcept;
+
+    /// Drops every recorded event.
+    void clear() noexcept;
+
+    /// Writes all recorded events as a Chrome trace. Returns false if the file can't be written.
+    bool writeChromeTrace(const std::string &path) const;
+
+private:
+    struct ThreadBuffer {
+        uint32_t threadId{};
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+        std::array<Event, ThreadCapacity> events{};
+    };
+
+    ThreadBuffer &_threadBuffer();
+
+    static std::atomic<bool> _enabled;
+
+    // Guards registration of thread buffers only; recording is lock-free.
+    mutable std::mutex _mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> _buffers;
+};
+
+/// Records the lifetime of the scope while the profiler is enabled.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char *name) noexcept
+        : _name{name}, _beginNs{Profiler::enabled() ? Profiler::now() : -1} {}
+
+    ~ScopedTimer() {
+        if (_beginNs >= 0) {
+            Profiler::instance().record(_name, _beginNs, Profiler::now());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    const char *_name;
+    int64_t _beginNs;
+};
+
+}// namespace vox
+
+#define VOX_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VOX_PROFILE_CONCAT(a, b) VOX_PROFILE_CONCAT_IMPL(a, b)
+#define VOX_PROFILE_SCOPE(name) vox::ScopedTimer VOX_PROFILE_CONCAT(_voxScopedTimer, __LINE__)(name)
@@ -0,0 +1,325 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "adaptive_refinement.h"
+#include "mesh_merging.h"
+
+#include <pxr/base/gf/bbox3d.h>
+#include <pxr/base/gf/vec4d.h>
+#include <pxr/imaging/hd/extentSchema.h>
+#include <pxr/imaging/hd/instancedBySchema.h>
+#include <pxr/imaging/hd/legacyDisplayStyleSchema.h>
+#include <pxr/imaging/hd/meshSchema.h>
+#include <pxr/imaging/hd/meshTopologySchema.h>
+#include <pxr/imaging/hd/overlayContainerDataSource.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/xformSchema.h>
+#include <pxr/imaging/pxOsd/tokens.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace vox {
+namespace {
+/// Faces are refined until their edges span about this many pixels.
+constexpr double TargetEdgePixels = 8.0;
+/// Levels go down once faces are this much under the target.
+constexpr double Hysteresis = 1.25;
+/// Finest level Storm refines to.
+constexpr int MaxRefineLevel = 8;
+
+template<typename T>
+T typedValue(const typename pxr::HdTypedSampledDataSource<T>::Handle &dataSource, const T &fallback) {
+    return dataSource ? dataSource->GetTypedValue(0.f) : fallback;
+}
+
+/// The display style overlaid on a mesh, one per level.
+const pxr::HdContainerDataSourceHandle &displayStyle(int level) {
+    static const auto styles = []() {
+        std::array<pxr::HdContainerDataSourceHandle, MaxRefineLevel + 1> result;
+        for (int i = 0; i <= MaxRefineLevel; ++i) {
+            result[i] = pxr::HdRetainedContainerDataSource::New(
+                pxr::HdLegacyDisplayStyleSchema::GetSchemaToken(),
+                pxr::HdLegacyDisplayStyleSchema::Builder()
+                    .SetRefineLevel(pxr::HdRetainedTypedSampledDataSource<int>::New(i))
+                    .Build());
+        }
+        return result;
+    }();
+    return styles[std::clamp(level, 0, MaxRefineLevel)];
+}
+
+/// Faces drawn at `level`: the control faces at 0, then a quad per corner, split in four at each level.
+double faceCount(size_t faces, size_t corners, int level) {
+    return level == 0 ? double(faces) : double(corners) * std::pow(4.0, level - 1);
+}
+
+double triangleCount(size_t faces, size_t corners, int level) {
+    return level == 0 ? double(corners - std::min(corners, 2 * faces)) : 2.0 * faceCount(faces, corners, level);
+}
+
+/// Larger side of the window rectangle covered by `range`: infinite when it
+/// reaches behind the camera, 0 when it is out of view.
+double visibleSize(const pxr::GfRange3d &range, const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize) {
+    if (range.IsEmpty()) {
+        return 0.0;
+    }
+    pxr::GfVec2d min(std::numeric_limits<double>::max()), max(-std::numeric_limits<double>::max());
+    int behind = 0;
+    for (int i = 0; i < 8; ++i) {
+        auto corner = range.GetCorner(i);
+        auto clip = pxr::GfVec4d(corner[0], corner[1], corner[2], 1.0) * viewProjection;
+        if (clip[3] <= 1e-6) {
+            ++behind;
+            continue;
+        }
+        pxr::GfVec2d ndc(clip[0] / clip[3], clip[1] / clip[3]);
+        min = pxr::GfCompMin(min, ndc);
+        max = pxr::GfCompMax(max, ndc);
+    }
+    if (behind > 0) {
+        return behind == 8 ? 0.0 : std::numeric_limits<double>::infinity();
+    }
+    if (max[0] < -1.0 || min[0] > 1.0 || max[1] < -1.0 || min[1] > 1.0) {
+        return 0.0;
+    }
+    return std::max((max[0] - min[0]) * 0.5 * windowSize[0], (max[1] - min[1]) * 0.5 * windowSize[1]);
+}
+
+/// Coarsest level at which faces of a mesh `pixels` wide span at most `edgePixels`.
+int levelFor(double pixels, size_t faces, size_t corners, double edgePixels, int maxLevel) {
+    int level = 0;
+    while (level < maxLevel && pixels / std::sqrt(faceCount(faces, corners, level)) > edgePixels) {
+        ++level;
+    }
+    return level;
+}
+}// namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+AdaptiveRefinementSceneIndexRefPtr AdaptiveRefinementSceneIndex::New(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                                                     const MeshMergingSceneIndex *merging) {
+    return pxr::TfCreateRefPtr(new AdaptiveRefinementSceneIndex(inputScene, merging));
+}
+
+AdaptiveRefinementSceneIndex::AdaptiveRefinementSceneIndex(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                                           const MeshMergingSceneIndex *merging)
+    : pxr::HdSingleInputFilteringSceneIndexBase(inputScene), _merging{merging} {
+}
+
+pxr::HdSceneIndexPrim AdaptiveRefinementSceneIndex::GetPrim(const pxr::SdfPath &primPath) const {
+    auto prim = _GetInputSceneIndex()->GetPrim(primPath);
+    // The map is only written by update() and notices, never during sync.
+    if (!_enabled || !prim.dataSource) {
+        return prim;
+    }
+    auto it = _meshes.find(primPath);
+    if (it == _meshes.end() || !it->second.level) {
+        return prim;
+    }
+    return {prim.primType, pxr::HdOverlayContainerDataSource::New(displayStyle(*it->second.level), prim.dataSource)};
+}
+
+pxr::SdfPathVector AdaptiveRefinementSceneIndex::GetChildPrimPaths(const pxr::SdfPath &primPath) const {
+    return _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+}
+
+void AdaptiveRefinementSceneIndex::update(const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize,
+                                          int maxLevel, size_t triangleBudget) {
+    if (triangleBudget == 0) {
+        if (_enabled) {
+            _reset();
+        }
+        return;
+    }
+    maxLevel = std::clamp(maxLevel, 0, MaxRefineLevel);
+    if (!_enabled) {
+        // Meshes are found once the budget is set, then kept up with from notices.
+        _enabled = true;
+        for (const auto &path : pxr::HdSceneIndexPrimView(_GetInputSceneIndex())) {
+            _track(path);
+        }
+    }
+    auto stale = std::any_of(_meshes.begin(), _meshes.end(), [](const auto &entry) { return entry.second.stale; });
+    if (!stale && _viewProjection == viewProjection && windowSize == _windowSize && maxLevel == _maxLevel &&
+        triangleBudget == _triangleBudget) {
+        return;
+    }
+    _viewProjection = viewProjection;
+    _windowSize = windowSize;
+    _maxLevel = maxLevel;
+    _triangleBudget = triangleBudget;
+
+    struct Choice {
+        const pxr::SdfPath *path;
+        Mesh *mesh;
+        double pixels;
+        int level;
+    };
+    std::vector<Choice> choices;
+    choices.reserve(_meshes.size());
+    double total = 0.0;
+    const auto &input = _GetInputSceneIndex();
+    for (auto &[path, mesh] : _meshes) {
+        if (mesh.stale) {
+            // Xforms are flattened upstream, so the extent goes to world space with the prim's own matrix.
+            auto dataSource = input->GetPrim(path).dataSource;
+            auto extent = pxr::HdExtentSchema::GetFromParent(dataSource);
+            auto matrix = typedValue<pxr::GfMatrix4d>(pxr::HdXformSchema::GetFromParent(dataSource).GetMatrix(),
+                                                      pxr::GfMatrix4d(1.0));
+            pxr::GfRange3d range;
+            if (extent.GetMin() && extent.GetMax()) {
+                range = pxr::GfRange3d(extent.GetMin()->GetTypedValue(0.f), extent.GetMax()->GetTypedValue(0.f));
+            }
+            mesh.range = range.IsEmpty() ? range : pxr::GfBBox3d(range, matrix).ComputeAlignedRange();
+            mesh.stale = false;
+        }
+        auto pixels = visibleSize(mesh.range, viewProjection, windowSize);
+        auto level = levelFor(pixels, mesh.faces, mesh.corners, TargetEdgePixels, maxLevel);
+        if (mesh.level && *mesh.level > level) {
+            auto kept = levelFor(pixels, mesh.faces, mesh.corners, TargetEdgePixels / Hysteresis, maxLevel);
+            level = std::max(level, std::min(kept, *mesh.level));
+        }
+        total += triangleCount(mesh.faces, mesh.corners, level);
+        choices.push_back({&path, &mesh, pixels, level});
+    }
+
+    // Over budget, the meshes whose faces are smallest on screen give up a level first.
+    auto edgePixels = [&choices](size_t i) {
+        const auto &choice = choices[i];
+        return choice.pixels / std::sqrt(faceCount(choice.mesh->faces, choice.mesh->corners, choice.level));
+    };
+    auto coarsest = [&edgePixels](size_t a, size_t b) { return edgePixels(a) > edgePixels(b); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(coarsest)> lowered(coarsest);
+    for (size_t i = 0; i < choices.size(); ++i) {
+        if (choices[i].level > 0) {
+            lowered.push(i);
+        }
+    }
+    while (total > double(triangleBudget) && !lowered.empty()) {
+        auto i = lowered.top();
+        lowered.pop();
+        auto &choice = choices[i];
+        total -= triangleCount(choice.mesh->faces, choice.mesh->corners, choice.level) -
+                 triangleCount(choice.mesh->faces, choice.mesh->corners, choice.level - 1);
+        if (--choice.level > 0) {
+            lowered.push(i);
+        }
+    }
+
+    pxr::HdSceneIndexObserver::DirtiedPrimEntries dirtied;
+    _refinedCount = 0;
+    for (const auto &choice : choices) {
+        _refinedCount += choice.level > 0;
+        if (choice.mesh->level != choice.level) {
+            choice.mesh->level = choice.level;
+            dirtied.push_back({*choice.path, pxr::HdLegacyDisplayStyleSchema::GetDefaultLocator()});
+        }
+    }
+    _triangleCount = size_t(std::max(total, 0.0));
+    if (!dirtied.empty()) {
+        _SendPrimsDirtied(dirtied);
+    }
+}
+
+void AdaptiveRefinementSceneIndex::_track(const pxr::SdfPath &primPath) {
+    auto prim = _GetInputSceneIndex()->GetPrim(primPath);
+    auto tracked = false;
+    size_t faces = 0, corners = 0;
+    if (prim.primType == pxr::HdPrimTypeTokens->mesh && !(_merging && _merging->isMerged(primPath))) {
+        auto mesh = pxr::HdMeshSchema::GetFromParent(prim.dataSource);
+        auto scheme = typedValue<pxr::TfToken>(mesh.GetSubdivisionScheme(), pxr::TfToken());
+        auto counts = mesh.GetTopology().GetFaceVertexCounts();
+        // Instanced meshes share one prototype, which has no single size on screen; they keep the render settings.
+        auto instanced = pxr::HdInstancedBySchema::GetFromParent(prim.dataSource).GetPaths();
+        if (!scheme.IsEmpty() && scheme != pxr::PxOsdOpenSubdivTokens->none && counts &&
+            (!instanced || instanced->GetTypedValue(0.f).empty())) {
+            for (auto count : counts->GetTypedValue(0.f)) {
+                corners += size_t(std::max(count, 0));
+                ++faces;
+            }
+            tracked = faces > 0;
+        }
+    }
+    if (!tracked) {
+        _meshes.erase(primPath);
+        return;
+    }
+    auto &mesh = _meshes[primPath];
+    mesh.faces = faces;
+    mesh.corners = corners;
+    mesh.stale = true;
+}
+
+void AdaptiveRefinementSceneIndex::_reset() {
+    pxr::HdSceneIndexObserver::DirtiedPrimEntries dirtied;
+    for (const auto &[path, mesh] : _meshes) {
+        if (mesh.level) {
+            dirtied.push_back({path, pxr::HdLegacyDisplayStyleSchema::GetDefaultLocator()});
+        }
+    }
+    _meshes.clear();
+    _enabled = false;
+    _refinedCount = 0;
+    _triangleCount = 0;
+    _viewProjection.reset();
+    if (!dirtied.empty()) {
+        _SendPrimsDirtied(dirtied);
+    }
+}
+
+void AdaptiveRefinementSceneIndex::_PrimsAdded(const pxr::HdSceneIndexBase &,
+                                               const pxr::HdSceneIndexObserver::AddedPrimEntries &entries) {
+    if (_enabled) {
+        for (const auto &entry : entries) {
+            if (entry.primType == pxr::HdPrimTypeTokens->mesh || _meshes.count(entry.primPath)) {
+                _track(entry.primPath);
+            }
+        }
+    }
+    _SendPrimsAdded(entries);
+}
+
+void AdaptiveRefinementSceneIndex::_PrimsRemoved(const pxr::HdSceneIndexBase &,
+                                                 const pxr::HdSceneIndexObserver::RemovedPrimEntries &entries) {
+    if (_enabled && !_meshes.empty()) {
+        for (const auto &entry : entries) {
+            if (entry.primPath.IsAbsoluteRootPath()) {
+                _meshes.clear();
+                break;
+            }
+            for (auto it = _meshes.begin(); it != _meshes.end();) {
+                it = it->first.HasPrefix(entry.primPath) ? _meshes.erase(it) : std::next(it);
+            }
+        }
+    }
+    _SendPrimsRemoved(entries);
+}
+
+void AdaptiveRefinementSceneIndex::_PrimsDirtied(const pxr::HdSceneIndexBase &,
+                                                 const pxr::HdSceneIndexObserver::DirtiedPrimEntries &entries) {
+    if (_enabled && !_meshes.empty()) {
+        for (const auto &entry : entries) {
+            auto it = _meshes.find(entry.primPath);
+            if (it == _meshes.end()) {
+                continue;
+            }
+            if (entry.dirtyLocators.Intersects(pxr::HdMeshSchema::GetDefaultLocator()) ||
+                entry.dirtyLocators.Intersects(pxr::HdInstancedBySchema::GetDefaultLocator())) {
+                _track(entry.primPath);
+            } else if (entry.dirtyLocators.Intersects(pxr::HdXformSchema::GetDefaultLocator()) ||
+                       entry.dirtyLocators.Intersects(pxr::HdExtentSchema::GetDefaultLocator())) {
+                it->second.stale = true;
+            }
+        }
+    }
+    _SendPrimsDirtied(entries);
+}
+}// namespace vox
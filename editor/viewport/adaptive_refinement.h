@@ -0,0 +1,96 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/gf/vec2i.h>
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/usd/sdf/path.h>
+#include <optional>
+#include <unordered_map>
+
+namespace vox {
+class MeshMergingSceneIndex;
+class AdaptiveRefinementSceneIndex;
+using AdaptiveRefinementSceneIndexRefPtr = pxr::TfRefPtr<AdaptiveRefinementSceneIndex>;
+
+/// Scene index filter choosing the refine level of each subdivision mesh
+/// from its size on screen, instead of one level for the whole stage. A mesh
+/// is refined until its faces span a few pixels, up to a maximum level, and
+/// meshes outside the view stay coarse. When the refined meshes would draw
+/// more triangles than the budget, the ones refined the finest relative to
+/// their size are lowered first. Levels go down only once a mesh is a
+/// quarter smaller than the size that raised them, so they don't flicker.
+///
+/// It sits after mesh merging, which leaves the meshes it merged without a
+/// type; the merged meshes themselves are skipped and keep the level of the
+/// render settings, since a batch spread over a model has no single size.
+class AdaptiveRefinementSceneIndex : public pxr::HdSingleInputFilteringSceneIndexBase {
+public:
+    /// `merging`, if any, is upstream of `inputScene`; its merged meshes are left alone.
+    static AdaptiveRefinementSceneIndexRefPtr New(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                                  const MeshMergingSceneIndex *merging = nullptr);
+
+    pxr::HdSceneIndexPrim GetPrim(const pxr::SdfPath &primPath) const override;
+
+    pxr::SdfPathVector GetChildPrimPaths(const pxr::SdfPath &primPath) const override;
+
+    /// Chooses the levels of the meshes seen through `viewProjection` in a
+    /// window of `windowSize`, at most `maxLevel` and drawing about
+    /// `triangleBudget` triangles. A budget of 0 leaves every mesh at the
+    /// level of the render settings.
+    void update(const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize, int maxLevel,
+                size_t triangleBudget);
+
+    /// Subdivision meshes considered, those refined past level 0, and the triangles they draw.
+    [[nodiscard]] size_t meshCount() const { return _enabled ? _meshes.size() : 0; }
+    [[nodiscard]] size_t refinedCount() const { return _refinedCount; }
+    [[nodiscard]] size_t triangleCount() const { return _triangleCount; }
+
+protected:
+    AdaptiveRefinementSceneIndex(const pxr::HdSceneIndexBaseRefPtr &inputScene, const MeshMergingSceneIndex *merging);
+
+    void _PrimsAdded(const pxr::HdSceneIndexBase &sender,
+                     const pxr::HdSceneIndexObserver::AddedPrimEntries &entries) override;
+
+    void _PrimsRemoved(const pxr::HdSceneIndexBase &sender,
+                       const pxr::HdSceneIndexObserver::RemovedPrimEntries &entries) override;
+
+    void _PrimsDirtied(const pxr::HdSceneIndexBase &sender,
+                       const pxr::HdSceneIndexObserver::DirtiedPrimEntries &entries) override;
+
+private:
+    struct Mesh {
+        pxr::GfRange3d range;
+        /// Faces of the control mesh, and their corners; each corner makes a quad at level 1.
+        size_t faces{0};
+        size_t corners{0};
+        /// Level drawn, none until one is chosen.
+        std::optional<int> level;
+        /// Bounds or topology changed since they were read.
+        bool stale{true};
+    };
+
+    /// Starts tracking `primPath` if it is a subdivision mesh, or stops.
+    void _track(const pxr::SdfPath &primPath);
+    /// Drops every level chosen, so the meshes go back to the render settings.
+    void _reset();
+
+    /// Kept alive by the input scene.
+    const MeshMergingSceneIndex *_merging;
+    bool _enabled{false};
+    std::unordered_map<pxr::SdfPath, Mesh, pxr::SdfPath::Hash> _meshes;
+    size_t _refinedCount{0};
+    size_t _triangleCount{0};
+    // What the last update was computed for.
+    std::optional<pxr::GfMatrix4d> _viewProjection;
+    pxr::GfVec2i _windowSize{0};
+    int _maxLevel{0};
+    size_t _triangleBudget{0};
+};
+}// namespace vox
@@ -0,0 +1,540 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "card_baker.h"
+#include "frame_capture.h"
+#include "../profiler.h"
+#include "../model/viewer_edit.h"
+
+#include <pxr/base/arch/hash.h>
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/matrix4f.h>
+#include <pxr/base/gf/quatf.h>
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec4f.h>
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/base/tf/stringUtils.h>
+#include <pxr/base/work/detachedTask.h>
+#include <pxr/imaging/cameraUtil/framing.h>
+#include <pxr/imaging/glf/simpleLight.h>
+#include <pxr/imaging/glf/simpleMaterial.h>
+#include <pxr/imaging/hd/aov.h>
+#include <pxr/imaging/hd/driver.h>
+#include <pxr/imaging/hgi/blitCmds.h>
+#include <pxr/imaging/hgi/blitCmdsOps.h>
+#include <pxr/imaging/hgi/tokens.h>
+#include <pxr/imaging/hio/image.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usd/tokens.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/modelAPI.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+#include <QStandardPaths>
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <optional>
+
+namespace vox {
+namespace {
+/// Resolution of each card; cards are only drawn for models a few dozen pixels wide.
+constexpr int CardSize = 128;
+/// Bumped when the way cards are rendered changes, so older cache entries are ignored.
+constexpr uint64_t CardVersion = 1;
+
+struct Face {
+    const char *name;
+    int axis;
+    double sign;
+};
+/// UsdGeomModelAPI's card faces, each looked at from its side of the box.
+constexpr std::array<Face, 6> Faces = {{{"XPos", 0, 1.0}, {"XNeg", 0, -1.0}, {"YPos", 1, 1.0},
+                                        {"YNeg", 1, -1.0}, {"ZPos", 2, 1.0}, {"ZNeg", 2, -1.0}}};
+
+const pxr::TfToken &cardTextureName(size_t face) {
+    static const std::array<pxr::TfToken, 6> names = {
+        pxr::UsdGeomTokens->modelCardTextureXPos, pxr::UsdGeomTokens->modelCardTextureXNeg,
+        pxr::UsdGeomTokens->modelCardTextureYPos, pxr::UsdGeomTokens->modelCardTextureYNeg,
+        pxr::UsdGeomTokens->modelCardTextureZPos, pxr::UsdGeomTokens->modelCardTextureZNeg};
+    return names[face];
+}
+
+std::string facePath(const std::string &base, size_t face) {
+    return fmt::format("{}_{}.png", base, Faces[face].name);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Hashes that stay the same from one session to the next, unlike TfHash of tokens and paths.
+void hashBytes(uint64_t &hash, const void *data, size_t size) {
+    hash = pxr::ArchHash64(static_cast<const char *>(data), size, hash);
+}
+
+void hashString(uint64_t &hash, const std::string &value) {
+    hashBytes(hash, value.data(), value.size());
+}
+
+/// Texture files are hashed by path, size and modification time.
+void hashAsset(uint64_t &hash, const pxr::SdfAssetPath &asset) {
+    hashString(hash, asset.GetAssetPath());
+    std::error_code error;
+    std::filesystem::path path(asset.GetResolvedPath());
+    if (auto size = std::filesystem::file_size(path, error); !error) {
+        auto time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        hashBytes(hash, &size, sizeof(size));
+        hashBytes(hash, &time, sizeof(time));
+    }
+}
+
+template<typename T>
+bool hashArray(uint64_t &hash, const pxr::VtValue &value) {
+    if (!value.IsHolding<pxr::VtArray<T>>()) {
+        return false;
+    }
+    const auto &array = value.UncheckedGet<pxr::VtArray<T>>();
+    hashBytes(hash, array.cdata(), array.size() * sizeof(T));
+    return true;
+}
+
+void hashValue(uint64_t &hash, const pxr::VtValue &value) {
+    // Geometry is hashed as raw bytes; everything else, which is small, as text.
+    if (hashArray<pxr::GfVec3f>(hash, value) || hashArray<pxr::GfVec2f>(hash, value) ||
+        hashArray<pxr::GfVec4f>(hash, value) || hashArray<float>(hash, value) || hashArray<int>(hash, value) ||
+        hashArray<pxr::GfVec3d>(hash, value) || hashArray<double>(hash, value) ||
+        hashArray<pxr::GfQuatf>(hash, value) || hashArray<pxr::GfMatrix4d>(hash, value)) {
+        return;
+    }
+    if (value.IsHolding<pxr::SdfAssetPath>()) {
+        hashAsset(hash, value.UncheckedGet<pxr::SdfAssetPath>());
+        return;
+    }
+    hashString(hash, pxr::TfStringify(value));
+}
+
+/// Properties authored on a model with cards.
+bool isCardOpinion(const pxr::TfToken &name) {
+    static const std::set<pxr::TfToken> names = {
+        pxr::UsdGeomTokens->modelCardTextureXPos, pxr::UsdGeomTokens->modelCardTextureXNeg,
+        pxr::UsdGeomTokens->modelCardTextureYPos, pxr::UsdGeomTokens->modelCardTextureYNeg,
+        pxr::UsdGeomTokens->modelCardTextureZPos, pxr::UsdGeomTokens->modelCardTextureZNeg,
+        pxr::UsdGeomTokens->modelCardGeometry, pxr::UsdGeomTokens->modelDrawMode,
+        pxr::UsdGeomTokens->modelApplyDrawMode, pxr::UsdGeomTokens->extentsHint};
+    return names.count(name) > 0;
+}
+
+/// Hashes the composed content below `root`, with paths relative to `relativeTo`. Targets
+/// outside of it, such as materials, are collected to be hashed once. False if the content is animated.
+bool hashSubtree(uint64_t &hash, const pxr::UsdPrim &root, const pxr::SdfPath &relativeTo,
+                 std::set<pxr::SdfPath> *outside) {
+    for (const auto &prim : pxr::UsdPrimRange(root, pxr::UsdTraverseInstanceProxies())) {
+        hashString(hash, prim.GetPath().MakeRelativePath(relativeTo).GetString());
+        hashString(hash, prim.GetTypeName().GetString());
+        for (const auto &attr : prim.GetAttributes()) {
+            const auto &name = attr.GetName();
+            if (prim == root && (pxr::TfStringStartsWith(name.GetString(), "xformOp") || isCardOpinion(name))) {
+                // Placement doesn't change the cards, and the card opinions are ours.
+                continue;
+            }
+            if (attr.GetNumTimeSamples() > 1) {
+                return false;
+            }
+            pxr::SdfPathVector sources;
+            attr.GetConnections(&sources);
+            for (const auto &source : sources) {
+                hashString(hash, source.MakeRelativePath(relativeTo).GetString());
+                if (outside && !source.HasPrefix(relativeTo)) {
+                    outside->insert(source.GetPrimPath());
+                }
+            }
+            pxr::VtValue value;
+            if (attr.Get(&value, pxr::UsdTimeCode::EarliestTime())) {
+                hashString(hash, name.GetString());
+                hashValue(hash, value);
+            }
+        }
+        for (const auto &rel : prim.GetRelationships()) {
+            pxr::SdfPathVector targets;
+            rel.GetTargets(&targets);
+            hashString(hash, rel.GetName().GetString());
+            for (const auto &target : targets) {
+                hashString(hash, target.MakeRelativePath(relativeTo).GetString());
+                if (outside && !target.HasPrefix(relativeTo)) {
+                    outside->insert(target.GetPrimPath());
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/// Content address of the cards of `prim`, none if it is animated.
+std::optional<uint64_t> cardKey(const pxr::UsdPrim &prim) {
+    uint64_t hash = CardVersion;
+    hashBytes(hash, &CardSize, sizeof(CardSize));
+    std::set<pxr::SdfPath> outside;
+    if (!hashSubtree(hash, prim, prim.GetPath(), &outside)) {
+        return std::nullopt;
+    }
+    for (const auto &path : outside) {
+        // Only what the model's own targets point at; their targets in turn are taken as they are.
+        auto target = prim.GetStage()->GetPrimAtPath(path);
+        if (target && !hashSubtree(hash, target, path, nullptr)) {
+            return std::nullopt;
+        }
+    }
+    return hash;
+}
+
+/// Synchronous GPU to CPU copy of `texture`.
+AovImage readTexture(pxr::Hgi *hgi, const pxr::HgiTextureHandle &texture) {
+    AovImage image;
+    if (!texture) {
+        return image;
+    }
+    const auto &desc = texture->GetDescriptor();
+    image.format = desc.format;
+    image.dimensions = desc.dimensions;
+    auto byteSize = image.texelSize() * size_t(desc.dimensions[0]) * size_t(desc.dimensions[1]);
+    image.data = std::make_shared<ReadbackBufferPool::Buffer>(byteSize);
+
+    auto blitCmds = hgi->CreateBlitCmds();
+    pxr::HgiTextureGpuToCpuOp copyOp;
+    copyOp.gpuSourceTexture = texture;
+    copyOp.sourceTexelOffset = pxr::GfVec3i(0);
+    copyOp.mipLevel = 0;
+    copyOp.cpuDestinationBuffer = image.data->data();
+    copyOp.destinationByteOffset = 0;
+    copyOp.destinationBufferByteSize = byteSize;
+    blitCmds->CopyTextureGpuToCpu(copyOp);
+    hgi->SubmitCmds(blitCmds.get(), pxr::HgiSubmitWaitTypeWaitUntilCompleted);
+    return image;
+}
+
+bool writeCard(const AovImage &image, const std::string &path) {
+    std::vector<uint8_t> pixels(size_t(image.dimensions[0]) * size_t(image.dimensions[1]) * 4);
+    convertToRGBA8(image, pixels.data(), true);
+    // AOVs are stored bottom row first.
+    pxr::HioImage::StorageSpec spec;
+    spec.width = image.dimensions[0];
+    spec.height = image.dimensions[1];
+    spec.format = pxr::HioFormatUNorm8Vec4srgb;
+    spec.flipped = true;
+    spec.data = pixels.data();
+    auto file = pxr::HioImage::OpenForWriting(path);
+    return file && file->Write(spec);
+}
+
+template<typename T>
+void setAttribute(const pxr::SdfPrimSpecHandle &primSpec, const pxr::TfToken &name,
+                  const pxr::SdfValueTypeName &typeName, const T &value) {
+    auto spec = primSpec->GetLayer()->GetAttributeAtPath(primSpec->GetPath().AppendProperty(name));
+    if (!spec) {
+        spec = pxr::SdfAttributeSpec::New(primSpec, name, typeName);
+    }
+    if (spec) {
+        spec->SetDefaultValue(pxr::VtValue(value));
+    }
+}
+}// namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+CardBaker::CardBaker(RenderContext &context)
+    : _context{context}, _writes{std::make_shared<Writes>()} {
+    auto cache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString();
+    _cacheDirectory = ((cache.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(cache)) / "cards").string();
+}
+
+void CardBaker::setStage(const pxr::UsdStageRefPtr &stage) {
+    if (stage == _stage) {
+        return;
+    }
+    _clear();
+    _stage = stage;
+    auto enabled = _enabled;
+    _enabled = false;
+    setEnabled(enabled);
+}
+
+void CardBaker::setEnabled(bool enabled) {
+    if (enabled == _enabled) {
+        return;
+    }
+    _enabled = enabled;
+    if (!enabled) {
+        _clear();
+        return;
+    }
+    if (!_stage) {
+        return;
+    }
+    // Components outside of instances, as the LOD sees them; models with a draw mode of their own are left alone.
+    auto range = pxr::UsdPrimRange::Stage(_stage);
+    for (auto iter = range.begin(); iter != range.end(); ++iter) {
+        const auto &prim = *iter;
+        if (prim.IsInstance()) {
+            iter.PruneChildren();
+            continue;
+        }
+        if (!prim.IsComponent()) {
+            continue;
+        }
+        iter.PruneChildren();
+        if (!pxr::UsdGeomModelAPI(prim).GetModelDrawModeAttr().HasAuthoredValue()) {
+            _queue.push_back(prim.GetPath());
+        }
+    }
+    _modelCount = _queue.size();
+}
+
+void CardBaker::step(const pxr::UsdImagingGLRenderParams &params) {
+    if (!_enabled || !_stage) {
+        return;
+    }
+    if (_queue.empty()) {
+        return;
+    }
+    auto path = _queue.front();
+    _queue.pop_front();
+    auto prim = _stage->GetPrimAtPath(path);
+    if (!prim) {
+        return;
+    }
+    auto key = cardKey(prim);
+    if (!key) {
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(_cacheDirectory, error);
+    auto base = (std::filesystem::path(_cacheDirectory) / fmt::format("{:016x}", *key)).string();
+    auto cached = true;
+    for (size_t face = 0; face < Faces.size() && cached; ++face) {
+        cached = std::filesystem::exists(facePath(base, face));
+    }
+    if (cached) {
+        ++_cacheHits;
+        std::lock_guard<std::mutex> lock(_writes->mutex);
+        _writes->done.emplace_back(path, base);
+        return;
+    }
+    _bake(prim, base, params);
+}
+
+void CardBaker::_bake(const pxr::UsdPrim &prim, const std::string &base, const pxr::UsdImagingGLRenderParams &params) {
+    VOX_PROFILE_SCOPE("cardBake");
+    auto time = pxr::UsdTimeCode::EarliestTime();
+    pxr::UsdGeomBBoxCache bboxCache(time, {pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->render});
+    auto bounds = bboxCache.ComputeUntransformedBound(prim).ComputeAlignedRange();
+    if (bounds.IsEmpty()) {
+        return;
+    }
+    // Same engine as the views, without their filters. Rooted at the model, so its first
+    // render populates the model alone rather than the whole stage.
+    pxr::HdDriver driver{pxr::HgiTokens->renderDriver, pxr::VtValue(_context.hgi())};
+    auto engine = std::make_unique<Engine>(prim.GetPath(), pxr::SdfPathVector(), pxr::SdfPathVector(),
+                                           pxr::SdfPath::AbsoluteRootPath(), driver);
+    engine->SetEnablePresentation(false);
+    engine->SetRendererAov(pxr::HdAovTokens->color);
+    engine->SetRenderBufferSize(pxr::GfVec2i(CardSize));
+    engine->SetFraming(pxr::CameraUtilFraming(pxr::GfRect2i(pxr::GfVec2i(0), CardSize, CardSize)));
+
+    auto renderParams = params;
+    renderParams.frame = time;
+    renderParams.drawMode = pxr::UsdImagingGLDrawMode::DRAW_SHADED_SMOOTH;
+    renderParams.showProxy = false;
+    renderParams.showRender = true;
+    renderParams.showGuides = false;
+    renderParams.highlight = false;
+    renderParams.enableIdRender = false;
+    renderParams.bboxes = {};
+    renderParams.clearColor = pxr::GfVec4f(0.f);
+    renderParams.cullStyle = pxr::UsdImagingGLCullStyle::CULL_STYLE_NOTHING;
+
+    auto localToWorld = pxr::UsdGeomXformCache(time).GetLocalToWorldTransform(prim);
+    auto worldToLocal = localToWorld.GetInverse();
+    auto center = bounds.GetMidpoint();
+    auto size = bounds.GetSize();
+    auto padding = std::max({size[0], size[1], size[2]}) * 0.01;
+
+    auto *hgi = _context.hgi();
+    std::vector<AovImage> images;
+    for (const auto &face : Faces) {
+        // X and Y cards are upright along Z, Z cards along Y.
+        auto up = face.axis == 2 ? 1 : 2;
+        auto across = face.axis == 0 ? 1 : 0;
+        pxr::GfVec3d direction(0.0), upVector(0.0);
+        direction[face.axis] = face.sign;
+        upVector[up] = 1.0;
+        auto distance = size[face.axis] + padding;
+        auto eye = center + direction * distance;
+
+        pxr::GfFrustum frustum;
+        frustum.SetProjectionType(pxr::GfFrustum::Orthographic);
+        auto halfWidth = std::max(size[across] * 0.5, padding), halfHeight = std::max(size[up] * 0.5, padding);
+        frustum.SetWindow(pxr::GfRange2d(pxr::GfVec2d(-halfWidth, -halfHeight), pxr::GfVec2d(halfWidth, halfHeight)));
+        frustum.SetNearFar(pxr::GfRange1d(distance - size[face.axis] * 0.5 - padding, distance + size[face.axis] * 0.5 + padding));
+        auto view = worldToLocal * pxr::GfMatrix4d().SetLookAt(eye, center, upVector);
+        engine->SetCameraState(view, frustum.ComputeProjectionMatrix());
+
+        // A light at the camera, like the viewport's default.
+        auto worldEye = localToWorld.Transform(eye);
+        pxr::GlfSimpleLight light;
+        light.SetAmbient({0, 0, 0, 0});
+        light.SetPosition({float(worldEye[0]), float(worldEye[1]), float(worldEye[2]), 1.f});
+        pxr::GlfSimpleMaterial material;
+        material.SetAmbient(pxr::GfVec4f(0.2f, 0.2f, 0.2f, 1.f));
+        material.SetSpecular(pxr::GfVec4f(0.1f, 0.1f, 0.1f, 1.f));
+        engine->SetLightingState({light}, material, pxr::GfVec4f(0.1f, 0.1f, 0.1f, 1.f));
+
+        hgi->StartFrame();
+        engine->Render(prim, renderParams);
+        images.push_back(readTexture(hgi, engine->GetAovTexture(pxr::HdAovTokens->color)));
+        hgi->EndFrame();
+    }
+    _context.retire(std::move(engine));
+
+    // Encoding runs on a worker thread; the cards are authored once every face is on disk.
+    pxr::WorkRunDetachedTask([writes = _writes, path = prim.GetPath(), base, images = std::move(images)]() {
+        for (size_t face = 0; face < images.size(); ++face) {
+            if (!images[face].isValid() || !writeCard(images[face], facePath(base, face))) {
+                TF_WARN("Failed to write card '%s'", facePath(base, face).c_str());
+                return;
+            }
+        }
+        std::lock_guard<std::mutex> lock(writes->mutex);
+        writes->done.emplace_back(path, base);
+    });
+}
+
+void CardBaker::sync(ScreenSizeLodSceneIndex *lod) {
+    std::vector<std::pair<pxr::SdfPath, std::string>> done;
+    {
+        std::lock_guard<std::mutex> lock(_writes->mutex);
+        done.swap(_writes->done);
+    }
+    if (!done.empty() && _enabled && _stage) {
+        _author(done);
+    }
+
+    if (!lod) {
+        _lod = nullptr;
+        return;
+    }
+    // The cards only grow while enabled, so their count tells whether the LOD has them all.
+    auto refresh = lod != _lod || _authored.size() != _lodCardCount;
+    if (refresh) {
+        lod->setCardModels(_authored);
+        _lod = lod;
+        _lodCardCount = _authored.size();
+    }
+    if (refresh || lod->generation() != _lodGeneration) {
+        _lodGeneration = lod->generation();
+        std::set<pxr::SdfPath> drawn;
+        for (const auto &path : _authored) {
+            if (lod->drawsCards(path)) {
+                drawn.insert(path);
+            }
+        }
+        _setDrawn(drawn);
+    }
+}
+
+void CardBaker::_author(const std::vector<std::pair<pxr::SdfPath, std::string>> &models) {
+    auto layer = _stage->GetSessionLayer();
+    // Cards change how models are drawn, not what the data model caches: the extent hint is
+    // the model's own bound, so the data model skips these like the draw mode switches.
+    ViewerEdit viewerEdit;
+    pxr::SdfChangeBlock changeBlock;
+    for (const auto &[path, base] : models) {
+        auto prim = _stage->GetPrimAtPath(path);
+        if (!prim) {
+            continue;
+        }
+        // The extent the cards were rendered for, so UsdImaging lays them out the same.
+        pxr::UsdGeomBBoxCache bboxCache(pxr::UsdTimeCode::EarliestTime(), {pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->render});
+        auto bounds = bboxCache.ComputeUntransformedBound(prim).ComputeAlignedRange();
+        auto primSpec = pxr::SdfCreatePrimInLayer(layer, path);
+        if (!primSpec || bounds.IsEmpty()) {
+            continue;
+        }
+        auto schemas = primSpec->GetInfo(pxr::UsdTokens->apiSchemas).GetWithDefault<pxr::SdfTokenListOp>();
+        auto prepended = schemas.GetPrependedItems();
+        if (std::find(prepended.begin(), prepended.end(), pxr::TfToken("GeomModelAPI")) == prepended.end()) {
+            prepended.emplace_back("GeomModelAPI");
+            schemas.SetPrependedItems(prepended);
+            primSpec->SetInfo(pxr::UsdTokens->apiSchemas, pxr::VtValue(schemas));
+        }
+        for (size_t face = 0; face < Faces.size(); ++face) {
+            setAttribute(primSpec, cardTextureName(face), pxr::SdfValueTypeNames->Asset, pxr::SdfAssetPath(facePath(base, face)));
+        }
+        setAttribute(primSpec, pxr::UsdGeomTokens->modelCardGeometry, pxr::SdfValueTypeNames->Token, pxr::UsdGeomTokens->box);
+        setAttribute(primSpec, pxr::UsdGeomTokens->extentsHint, pxr::SdfValueTypeNames->Float3Array,
+                     pxr::VtVec3fArray{pxr::GfVec3f(bounds.GetMin()), pxr::GfVec3f(bounds.GetMax())});
+        setAttribute(primSpec, pxr::UsdGeomTokens->modelApplyDrawMode, pxr::SdfValueTypeNames->Bool, true);
+        // Authored once here, so switching to cards later only changes a value.
+        setAttribute(primSpec, pxr::UsdGeomTokens->modelDrawMode, pxr::SdfValueTypeNames->Token, pxr::UsdGeomTokens->inherited);
+        _authored.insert(path);
+    }
+}
+
+void CardBaker::_setDrawn(const std::set<pxr::SdfPath> &drawn) {
+    if (drawn == _drawn) {
+        return;
+    }
+    auto layer = _stage->GetSessionLayer();
+    // Switched as models get small or large, so the data model skips it.
+    ViewerEdit viewerEdit;
+    pxr::SdfChangeBlock changeBlock;
+    for (const auto &path : _authored) {
+        auto wasDrawn = _drawn.count(path) > 0, isDrawn = drawn.count(path) > 0;
+        if (wasDrawn == isDrawn) {
+            continue;
+        }
+        if (auto spec = layer->GetAttributeAtPath(path.AppendProperty(pxr::UsdGeomTokens->modelDrawMode))) {
+            spec->SetDefaultValue(pxr::VtValue(isDrawn ? pxr::UsdGeomTokens->cards : pxr::UsdGeomTokens->inherited));
+        }
+    }
+    _drawn = drawn;
+}
+
+void CardBaker::_clear() {
+    if (_stage && !_authored.empty()) {
+        auto layer = _stage->GetSessionLayer();
+        ViewerEdit viewerEdit;
+        pxr::SdfChangeBlock changeBlock;
+        for (const auto &path : _authored) {
+            auto primSpec = layer->GetPrimAtPath(path);
+            if (!primSpec) {
+                continue;
+            }
+            std::vector<pxr::SdfPropertySpecHandle> properties;
+            for (const auto &property : primSpec->GetProperties()) {
+                if (isCardOpinion(property->GetNameToken())) {
+                    properties.push_back(property);
+                }
+            }
+            for (const auto &property : properties) {
+                primSpec->RemoveProperty(property);
+            }
+            auto schemas = primSpec->GetInfo(pxr::UsdTokens->apiSchemas).GetWithDefault<pxr::SdfTokenListOp>();
+            auto prepended = schemas.GetPrependedItems();
+            prepended.erase(std::remove(prepended.begin(), prepended.end(), pxr::TfToken("GeomModelAPI")), prepended.end());
+            schemas.SetPrependedItems(prepended);
+            primSpec->SetInfo(pxr::UsdTokens->apiSchemas, pxr::VtValue(schemas));
+        }
+    }
+    _authored.clear();
+    _drawn.clear();
+    _queue.clear();
+    _modelCount = 0;
+    _cacheHits = 0;
+    // Writes still running for the old models are dropped when they finish.
+    _writes = std::make_shared<Writes>();
+    _lod = nullptr;
+}
+}// namespace vox
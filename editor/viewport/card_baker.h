@@ -0,0 +1,86 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usdImaging/usdImagingGL/renderParams.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "render_context.h"
+
+namespace vox {
+/// Bakes the six box cards of each component of the stage while the viewer
+/// is idle, so small models can be drawn as cards by the screen-size LOD.
+/// Cards are rendered orthographically on the main thread, one model per
+/// idle pass, by an engine rooted at that model on the shared Hgi, so only
+/// the model is synced. They are encoded on a worker thread into an on-disk
+/// cache named by
+/// a hash of the model's composed content. Models seen before, in this
+/// session or an earlier one, only cost the hash.
+///
+/// Card textures are authored on the session layer, with the draw mode left
+/// inherited; it is switched to cards for the models the LOD finds small.
+/// All of it is a viewer edit, which the data model ignores.
+class CardBaker {
+public:
+    explicit CardBaker(RenderContext &context);
+
+    void setStage(const pxr::UsdStageRefPtr &stage);
+
+    /// Queues the components of the stage, or removes every card opinion.
+    void setEnabled(bool enabled);
+
+    [[nodiscard]] bool active() const { return _enabled && !_queue.empty(); }
+
+    /// Bakes or finds in the cache the cards of at most one queued model.
+    /// Call from the event loop while the user isn't interacting.
+    void step(const pxr::UsdImagingGLRenderParams &params);
+
+    /// Authors the cards written since the last call, tells `lod` which
+    /// models have cards, and switches the draw mode of those it made small.
+    void sync(ScreenSizeLodSceneIndex *lod);
+
+    /// Models queued so far, with cards, and found in the cache.
+    [[nodiscard]] size_t modelCount() const { return _modelCount; }
+    [[nodiscard]] size_t cardCount() const { return _authored.size(); }
+    [[nodiscard]] size_t cacheHits() const { return _cacheHits; }
+
+private:
+    /// Cards written by worker threads, waiting to be authored.
+    struct Writes {
+        std::mutex mutex;
+        std::vector<std::pair<pxr::SdfPath, std::string>> done;
+    };
+
+    void _bake(const pxr::UsdPrim &prim, const std::string &base, const pxr::UsdImagingGLRenderParams &params);
+    /// Authors the cards of `models`, each given with the file name its textures start with.
+    void _author(const std::vector<std::pair<pxr::SdfPath, std::string>> &models);
+    void _setDrawn(const std::set<pxr::SdfPath> &drawn);
+    /// Removes every opinion authored, and drops the queue.
+    void _clear();
+
+    RenderContext &_context;
+    pxr::UsdStageRefPtr _stage;
+    bool _enabled{false};
+    std::string _cacheDirectory;
+    std::deque<pxr::SdfPath> _queue;
+    std::shared_ptr<Writes> _writes;
+    std::set<pxr::SdfPath> _authored;
+    std::set<pxr::SdfPath> _drawn;
+    size_t _modelCount{0};
+    size_t _cacheHits{0};
+    // What the LOD was last told and seen at.
+    const ScreenSizeLodSceneIndex *_lod{nullptr};
+    size_t _lodCardCount{0};
+    uint64_t _lodGeneration{0};
+};
+}// namespace vox
@@ -0,0 +1,124 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "depth_probe.h"
+
+#include <pxr/base/work/loops.h>
+#include <pxr/imaging/hd/aov.h>
+#include <simd/simd.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace vox {
+namespace {
+struct RowMin {
+    float depth{1.f};
+    int row{-1};
+};
+
+/// Minimum of `count` packed floats, 16 lanes at a time.
+float minDepth(const float *depths, size_t count) {
+    simd_float16 lanes = 1.f;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        simd_float16 values;
+        std::memcpy(&values, depths + i, sizeof(values));
+        lanes = simd_min(lanes, values);
+    }
+    auto result = simd_reduce_min(lanes);
+    for (; i < count; ++i) {
+        result = std::min(result, depths[i]);
+    }
+    return result;
+}
+
+/// Minimum over `count` texels whose depth is the first float of each `stride` floats.
+float minDepthStrided(const float *depths, size_t count, size_t stride) {
+    auto result = 1.f;
+    for (size_t i = 0; i < count; ++i) {
+        result = std::min(result, depths[i * stride]);
+    }
+    return result;
+}
+}// namespace
+
+DepthProbe::DepthProbe(AovReadback &readback)
+    : _readback{readback} {
+}
+
+void DepthProbe::request(pxr::Hgi *hgi, uint64_t frameIndex, const AovView &view, const pxr::HgiTextureHandle &depth) {
+    if (_pending || !depth) {
+        return;
+    }
+    _pending = true;
+    auto generation = _generation;
+    _readback.request(hgi, frameIndex, view.time, {{pxr::HdAovTokens->depth, depth}},
+                      [this, view, generation](std::shared_ptr<const AovFrame> frame) {
+                          if (generation != _generation) {
+                              return;
+                          }
+                          _pending = false;
+                          _frame = std::move(frame);
+                          _view = view;
+                      });
+}
+
+void DepthProbe::invalidate() {
+    ++_generation;
+    _pending = false;
+    _frame.reset();
+    _view.reset();
+}
+
+std::optional<pxr::GfVec3d> DepthProbe::closestPoint(float windowFraction) const {
+    auto depth = _frame ? _frame->find(pxr::HdAovTokens->depth) : nullptr;
+    if (!depth || !depth->isValid() ||
+        (depth->format != pxr::HgiFormatFloat32 && depth->format != pxr::HgiFormatFloat32UInt8)) {
+        return std::nullopt;
+    }
+
+    auto width = size_t(depth->dimensions[0]);
+    auto height = size_t(depth->dimensions[1]);
+    windowFraction = std::clamp(windowFraction, 0.f, 1.f);
+    auto windowWidth = std::max<size_t>(1, size_t(width * windowFraction));
+    auto windowHeight = std::max<size_t>(1, size_t(height * windowFraction));
+    auto x0 = (width - windowWidth) / 2;
+    auto y0 = (height - windowHeight) / 2;
+    auto stride = depth->texelSize() / sizeof(float);
+    const auto *depths = reinterpret_cast<const float *>(depth->data->data());
+
+    // Reduce rows in parallel, then find the texel in the closest row.
+    std::mutex mutex;
+    RowMin closest;
+    pxr::WorkParallelForN(windowHeight, [&](size_t begin, size_t end) {
+        RowMin local;
+        for (size_t row = y0 + begin; row < y0 + end; ++row) {
+            const auto *rowDepths = depths + (row * width + x0) * stride;
+            auto rowMin = stride == 1 ? minDepth(rowDepths, windowWidth) : minDepthStrided(rowDepths, windowWidth, stride);
+            if (rowMin < local.depth) {
+                local = {rowMin, int(row)};
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (local.depth < closest.depth || (local.depth == closest.depth && local.row >= 0 && local.row < closest.row)) {
+            closest = local;
+        }
+    });
+    // Cleared depth is 1, nothing was drawn there.
+    if (closest.row < 0 || closest.depth >= 1.f) {
+        return std::nullopt;
+    }
+
+    const auto *rowDepths = depths + (size_t(closest.row) * width + x0) * stride;
+    size_t column = 0;
+    while (column < windowWidth && rowDepths[column * stride] != closest.depth) {
+        ++column;
+    }
+    return _view->unproject(double(x0 + column), double(closest.row), closest.depth, depth->dimensions);
+}
+
+}// namespace vox
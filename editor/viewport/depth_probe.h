@@ -0,0 +1,45 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "frame_capture.h"
+
+#include <optional>
+
+namespace vox {
+/// Finds the closest visible point from depth AOV readbacks of rendered
+/// frames, so clipping planes can follow the scene without pick renders.
+class DepthProbe {
+public:
+    explicit DepthProbe(AovReadback &readback);
+
+    /// Queues a readback of the depth AOV of the frame being encoded, unless one is in flight.
+    void request(pxr::Hgi *hgi, uint64_t frameIndex, const AovView &view, const pxr::HgiTextureHandle &depth);
+
+    [[nodiscard]] bool isPending() const { return _pending; }
+
+    /// View of the last depth frame, if any.
+    [[nodiscard]] const std::optional<AovView> &view() const { return _view; }
+
+    /// Frame index of the last depth frame, 0 if none.
+    [[nodiscard]] uint64_t frameIndex() const { return _frame ? _frame->frameIndex : 0; }
+
+    /// Drops the last depth frame; call when the scene changes.
+    void invalidate();
+
+    /// Closest point drawn in the central `windowFraction` of the last depth
+    /// frame, or nullopt if only background is there.
+    [[nodiscard]] std::optional<pxr::GfVec3d> closestPoint(float windowFraction = 0.5f) const;
+
+private:
+    AovReadback &_readback;
+    std::shared_ptr<const AovFrame> _frame;
+    std::optional<AovView> _view;
+    bool _pending{false};
+    uint64_t _generation{0};
+};
+}// namespace vox
@@ -0,0 +1,60 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "dynamic_resolution.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace vox {
+namespace {
+// Frame times within this ratio of the target leave the scale alone, so the
+// resolution doesn't oscillate on noisy frames.
+constexpr double DeadBand = 0.1;
+// Scales the resolution moves between. Every change resizes the render
+// buffers, so it steps through a few sizes instead of following each frame.
+constexpr std::array<float, 6> Steps = {1.f, 0.85f, 0.7f, 0.5f, 0.35f, DynamicResolution::MinScale};
+}// namespace
+
+float DynamicResolution::update(double frameTime, bool interacting) {
+    if (!interacting || frameTime <= 0.0) {
+        _step = 0;
+        return scale();
+    }
+
+    auto ratio = _targetFrameTime / frameTime;
+    // Frame cost is roughly proportional to the pixel count, i.e. to scale squared.
+    auto ideal = scale() * float(std::sqrt(ratio));
+    if (ratio < 1.0 - DeadBand) {
+        // Down to the largest step that fits, at least one.
+        auto step = _step + 1;
+        while (step + 1 < Steps.size() && Steps[step] > ideal) {
+            ++step;
+        }
+        _step = std::min(step, Steps.size() - 1);
+    } else if (ratio > 1.0 + DeadBand && _step > 0 && Steps[_step - 1] <= ideal) {
+        // Up one step at a time, only when the larger one is expected to fit.
+        --_step;
+    }
+    return scale();
+}
+
+float DynamicResolution::scale() const {
+    return Steps[_step];
+}
+
+pxr::GfVec2i DynamicResolution::scaled(const pxr::GfVec2i &size) const {
+    return {std::max(1, int(std::lround(size[0] * scale()))),
+            std::max(1, int(std::lround(size[1] * scale())))};
+}
+
+pxr::GfVec4i DynamicResolution::scaled(const pxr::GfVec4i &viewport) const {
+    return {int(std::lround(viewport[0] * scale())),
+            int(std::lround(viewport[1] * scale())),
+            std::max(1, int(std::lround(viewport[2] * scale()))),
+            std::max(1, int(std::lround(viewport[3] * scale())))};
+}
+}// namespace vox
@@ -0,0 +1,42 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/vec2i.h>
+#include <pxr/base/gf/vec4i.h>
+#include <cstddef>
+
+namespace vox {
+/// Picks the render resolution scale that keeps interactive frames near a
+/// target frame time, out of a few fixed steps. The scale only drops while
+/// the camera is being moved and snaps back to full resolution as soon as
+/// the interaction ends.
+class DynamicResolution {
+public:
+    static constexpr float MinScale = 0.25f;
+
+    /// Feeds the duration of the last frame and returns the scale for the next one.
+    float update(double frameTime, bool interacting);
+
+    void setTargetFrameTime(double seconds) { _targetFrameTime = seconds; }
+    [[nodiscard]] double targetFrameTime() const { return _targetFrameTime; }
+
+    [[nodiscard]] float scale() const;
+
+    void reset() { _step = 0; }
+
+    /// Scales a full resolution render buffer size, never below one pixel.
+    [[nodiscard]] pxr::GfVec2i scaled(const pxr::GfVec2i &size) const;
+
+    /// Scales a full resolution viewport (x, y, width, height).
+    [[nodiscard]] pxr::GfVec4i scaled(const pxr::GfVec4i &viewport) const;
+
+private:
+    double _targetFrameTime{1.0 / 30.0};
+    size_t _step{0};
+};
+}// namespace vox
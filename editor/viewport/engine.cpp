@@ -0,0 +1,27 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "engine.h"
+
+#include <pxr/imaging/hd/aov.h>
+#include <pxr/imaging/hdx/taskController.h>
+
+namespace vox {
+void Engine::setIdRenderOutputs(bool enabled) {
+    if (!_taskController || enabled == _idRenderOutputs) {
+        return;
+    }
+    pxr::TfTokenVector outputs = {pxr::HdAovTokens->color, pxr::HdAovTokens->depth};
+    if (enabled) {
+        outputs.push_back(pxr::HdAovTokens->primId);
+        outputs.push_back(pxr::HdAovTokens->instanceId);
+    }
+    _taskController->SetRenderOutputs(outputs);
+    _taskController->SetViewportRenderOutput(pxr::HdAovTokens->color);
+    _idRenderOutputs = enabled;
+}
+
+}// namespace vox
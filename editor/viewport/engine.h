@@ -0,0 +1,26 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/usdImaging/usdImagingGL/engine.h>
+
+namespace vox {
+/// UsdImagingGLEngine with the extra render outputs the viewport reads back.
+class Engine : public pxr::UsdImagingGLEngine {
+public:
+    using pxr::UsdImagingGLEngine::UsdImagingGLEngine;
+
+    /// Also renders the primId and instanceId AOVs next to color, so picks can be
+    /// answered from the last frame. Color stays the presented output.
+    void setIdRenderOutputs(bool enabled);
+
+    [[nodiscard]] bool idRenderOutputs() const { return _idRenderOutputs; }
+
+private:
+    bool _idRenderOutputs{false};
+};
+}// namespace vox
@@ -0,0 +1,318 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "flipbook.h"
+
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/base/work/detachedTask.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/imaging/hd/aov.h>
+#include <compression.h>
+#include <fmt/format.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace vox {
+namespace {
+/// Rows compressed together; bands are compressed and decoded in parallel.
+constexpr size_t BandRows = 64;
+}// namespace
+
+void Flipbook::State::clear() {
+    for (const auto &frame : frames) {
+        if (frame && !frame->spillPath.empty()) {
+            std::error_code error;
+            std::filesystem::remove(frame->spillPath, error);
+        }
+    }
+    std::fill(frames.begin(), frames.end(), nullptr);
+    pending.clear();
+    memoryBytes = 0;
+    diskBytes = 0;
+    rawBytes = 0;
+    full = false;
+    ++generation;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+Flipbook::Flipbook(AovReadback &readback)
+    : _readback{readback}, _state{std::make_shared<State>()} {
+}
+
+Flipbook::~Flipbook() {
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->clear();
+    }
+    for (auto *texture : _textures) {
+        if (texture) {
+            texture->release();
+        }
+    }
+}
+
+void Flipbook::setRange(double startTime, double endTime) {
+    auto count = endTime >= startTime ? size_t(std::floor(endTime - startTime)) + 1 : 0;
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    if (_state->startTime == startTime && _state->frames.size() == count) {
+        return;
+    }
+    _state->clear();
+    _state->startTime = startTime;
+    _state->frames.assign(count, nullptr);
+}
+
+void Flipbook::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    if (_state->memoryBudget != bytes) {
+        _state->memoryBudget = bytes;
+        _state->full = false;
+    }
+}
+
+void Flipbook::setSpillDirectory(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    if (_state->spillDirectory != directory) {
+        _state->spillDirectory = directory;
+        _state->full = false;
+    }
+}
+
+void Flipbook::invalidate() {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    _state->clear();
+}
+
+std::optional<size_t> Flipbook::_index(pxr::UsdTimeCode time) const {
+    if (time.IsDefault()) {
+        return std::nullopt;
+    }
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    auto offset = time.GetValue() - _state->startTime;
+    if (offset < 0.0 || offset != std::floor(offset) || offset >= double(_state->frames.size())) {
+        return std::nullopt;
+    }
+    return size_t(offset);
+}
+
+std::optional<double> Flipbook::nextMissing() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    if (_state->full) {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < _state->frames.size(); ++i) {
+        if (!_state->frames[i] && !_state->pending.count(i)) {
+            return _state->startTime + double(i);
+        }
+    }
+    return std::nullopt;
+}
+
+bool Flipbook::isComplete() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    if (_state->frames.empty()) {
+        return false;
+    }
+    if (_state->full) {
+        return true;
+    }
+    return std::all_of(_state->frames.begin(), _state->frames.end(),
+                       [](const auto &frame) { return frame != nullptr; });
+}
+
+void Flipbook::record(pxr::Hgi *hgi, uint64_t frameIndex, const AovView &view, const pxr::HgiTextureHandle &color) {
+    auto index = _index(view.time);
+    if (!index || !color) {
+        return;
+    }
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        if (_state->full || _state->frames[*index] || !_state->pending.insert(*index).second) {
+            return;
+        }
+        generation = _state->generation;
+    }
+
+    auto state = _state;
+    auto i = *index;
+    _readback.request(hgi, frameIndex, view.time, {{pxr::HdAovTokens->color, color}},
+                      [state, i, generation, view](std::shared_ptr<const AovFrame> frame) {
+                          pxr::WorkRunDetachedTask([state, i, generation, view, frame]() {
+                              if (auto *color = frame->find(pxr::HdAovTokens->color); color && color->isValid()) {
+                                  _store(state, i, generation, view, *color);
+                              } else {
+                                  std::lock_guard<std::mutex> lock(state->mutex);
+                                  state->pending.erase(i);
+                              }
+                          });
+                      });
+}
+
+void Flipbook::_store(const std::shared_ptr<State> &state, size_t index, uint64_t generation,
+                      const AovView &view, const AovImage &color) {
+    auto width = size_t(color.dimensions[0]);
+    auto height = size_t(color.dimensions[1]);
+    std::vector<uint8_t> rgba(width * height * 4);
+    // The swapchain shows the AOV as is, so the 8-bit copy isn't sRGB encoded either.
+    convertToRGBA8(color, rgba.data(), false);
+
+    auto frame = std::make_shared<Frame>();
+    frame->view = view;
+    frame->size = pxr::GfVec2i(int(width), int(height));
+    auto bandCount = (height + BandRows - 1) / BandRows;
+    frame->bands.resize(bandCount);
+    frame->rawSizes.resize(bandCount);
+    frame->compressedSizes.resize(bandCount);
+    pxr::WorkParallelForN(bandCount, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto rows = std::min(BandRows, height - i * BandRows);
+            auto rawSize = rows * width * 4;
+            const auto *src = rgba.data() + i * BandRows * width * 4;
+            auto &band = frame->bands[i];
+            band.resize(rawSize + rawSize / 255 + 64);
+            auto size = compression_encode_buffer(band.data(), band.size(), src, rawSize, nullptr, COMPRESSION_LZ4);
+            if (size == 0 || size >= rawSize) {
+                band.assign(src, src + rawSize);
+            } else {
+                band.resize(size);
+                band.shrink_to_fit();
+            }
+            frame->rawSizes[i] = rawSize;
+            frame->compressedSizes[i] = band.size();
+        }
+    });
+    for (auto size : frame->compressedSizes) {
+        frame->compressedBytes += size;
+    }
+
+    std::string spillDirectory;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->generation != generation) {
+            return;
+        }
+        if (state->memoryBytes + frame->compressedBytes <= state->memoryBudget) {
+            state->memoryBytes += frame->compressedBytes;
+            state->rawBytes += width * height * 4;
+            state->frames[index] = std::move(frame);
+            state->pending.erase(index);
+            return;
+        }
+        if (state->spillDirectory.empty()) {
+            state->full = true;
+            state->pending.erase(index);
+            return;
+        }
+        spillDirectory = state->spillDirectory;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(spillDirectory, error);
+    frame->spillPath = fmt::format("{}/flipbook-{}-{}-{}.lz4", spillDirectory, getpid(), generation, index);
+    std::ofstream out(frame->spillPath, std::ios::binary | std::ios::trunc);
+    for (const auto &band : frame->bands) {
+        out.write(reinterpret_cast<const char *>(band.data()), std::streamsize(band.size()));
+    }
+    out.close();
+    frame->bands.clear();
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->pending.erase(index);
+    if (!out || state->generation != generation) {
+        if (!out) {
+            TF_WARN("Could not write flipbook frame to %s", frame->spillPath.c_str());
+            state->full = true;
+        }
+        std::filesystem::remove(frame->spillPath, error);
+        return;
+    }
+    state->diskBytes += frame->compressedBytes;
+    state->rawBytes += width * height * 4;
+    state->frames[index] = std::move(frame);
+}
+
+MTL::Texture *Flipbook::texture(MTL::Device *device, const AovView &view, uint64_t frameIndex) {
+    auto index = _index(view.time);
+    if (!index) {
+        return nullptr;
+    }
+    std::shared_ptr<const Frame> frame;
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        frame = _state->frames[*index];
+    }
+    if (!frame) {
+        return nullptr;
+    }
+    if (!frame->view.sameFraming(view)) {
+        invalidate();
+        return nullptr;
+    }
+
+    std::vector<uint8_t> spilled;
+    if (!frame->spillPath.empty()) {
+        spilled.resize(frame->compressedBytes);
+        std::ifstream in(frame->spillPath, std::ios::binary);
+        in.read(reinterpret_cast<char *>(spilled.data()), std::streamsize(spilled.size()));
+        if (!in) {
+            TF_WARN("Could not read flipbook frame from %s", frame->spillPath.c_str());
+            return nullptr;
+        }
+    }
+
+    auto width = size_t(frame->size[0]);
+    auto height = size_t(frame->size[1]);
+    _decoded.resize(width * height * 4);
+    auto bandCount = frame->rawSizes.size();
+    std::vector<const uint8_t *> sources(bandCount);
+    for (size_t i = 0, offset = 0; i < bandCount; offset += frame->compressedSizes[i++]) {
+        sources[i] = spilled.empty() ? frame->bands[i].data() : spilled.data() + offset;
+    }
+    pxr::WorkParallelForN(bandCount, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto *dst = _decoded.data() + i * BandRows * width * 4;
+            if (frame->compressedSizes[i] == frame->rawSizes[i]) {
+                std::memcpy(dst, sources[i], frame->rawSizes[i]);
+            } else {
+                compression_decode_buffer(dst, frame->rawSizes[i], sources[i], frame->compressedSizes[i],
+                                          nullptr, COMPRESSION_LZ4);
+            }
+        }
+    });
+
+    // As many textures as frames in flight, so the GPU never reads one being overwritten.
+    auto &texture = _textures[frameIndex % _textures.size()];
+    if (!texture || texture->width() != width || texture->height() != height) {
+        if (texture) {
+            texture->release();
+        }
+        auto *desc = MTL::TextureDescriptor::texture2DDescriptor(MTL::PixelFormatRGBA8Unorm, width, height, false);
+        desc->setUsage(MTL::TextureUsageShaderRead);
+        desc->setStorageMode(device->hasUnifiedMemory() ? MTL::StorageModeShared : MTL::StorageModeManaged);
+        texture = device->newTexture(desc);
+    }
+    texture->replaceRegion(MTL::Region::Make2D(0, 0, width, height), 0, _decoded.data(), width * 4);
+    return texture;
+}
+
+Flipbook::Stats Flipbook::stats() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    Stats stats;
+    stats.frameCount = _state->frames.size();
+    stats.cachedFrames = size_t(std::count_if(_state->frames.begin(), _state->frames.end(),
+                                              [](const auto &frame) { return frame != nullptr; }));
+    stats.memoryBytes = _state->memoryBytes;
+    stats.diskBytes = _state->diskBytes;
+    stats.rawBytes = _state->rawBytes;
+    return stats;
+}
+
+}// namespace vox
@@ -0,0 +1,110 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "frame_capture.h"
+#include "third_party/metal-cpp/Metal/Metal.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace vox {
+/// Rendered frames of the playback range, kept as compressed 8-bit images so
+/// shots too heavy for realtime can be played back at their timecode rate.
+/// Frames are compressed with LZ4 on worker threads, in row bands that are
+/// decoded in parallel. Past the memory budget frames are spilled to disk, or
+/// recording stops if there is no spill directory.
+class Flipbook {
+public:
+    struct Stats {
+        size_t frameCount{0};
+        size_t cachedFrames{0};
+        size_t memoryBytes{0};
+        size_t diskBytes{0};
+        size_t rawBytes{0};
+    };
+
+    explicit Flipbook(AovReadback &readback);
+    ~Flipbook();
+
+    /// Whole time codes from `startTime` to `endTime` are cached. Changing the range drops every frame.
+    void setRange(double startTime, double endTime);
+
+    void setMemoryBudget(size_t bytes);
+
+    /// Directory frames over the memory budget are written to, empty to disable spilling.
+    void setSpillDirectory(const std::string &directory);
+
+    /// Drops every frame; call when the scene or the render settings change.
+    void invalidate();
+
+    /// Earliest time code of the range still to be rendered, none while the
+    /// rest is being compressed or once the cache is full.
+    [[nodiscard]] std::optional<double> nextMissing() const;
+
+    /// True once every frame is cached, or no more fit.
+    [[nodiscard]] bool isComplete() const;
+
+    /// Reads back the color AOV rendered for `view` and adds it to the cache.
+    void record(pxr::Hgi *hgi, uint64_t frameIndex, const AovView &view, const pxr::HgiTextureHandle &color);
+
+    /// Texture holding the cached frame for `view.time`, null if it isn't cached.
+    /// A frame rendered with another camera or window drops the whole cache.
+    /// Uploads rotate over a few textures so frames in flight aren't overwritten.
+    MTL::Texture *texture(MTL::Device *device, const AovView &view, uint64_t frameIndex);
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct Frame {
+        AovView view;
+        pxr::GfVec2i size{0};
+        /// Compressed row bands, empty once spilled.
+        std::vector<std::vector<uint8_t>> bands;
+        std::vector<size_t> rawSizes;
+        /// Bands that didn't compress are stored as is, with their raw size.
+        std::vector<size_t> compressedSizes;
+        size_t compressedBytes{0};
+        /// Set when the bands were written to disk instead of kept in memory.
+        std::string spillPath;
+    };
+
+    /// Shared with the compression tasks, which may outlive the flipbook.
+    struct State {
+        mutable std::mutex mutex;
+        uint64_t generation{0};
+        double startTime{0.0};
+        std::vector<std::shared_ptr<const Frame>> frames;
+        std::set<size_t> pending;
+        size_t memoryBudget{size_t(2) << 30};
+        size_t memoryBytes{0};
+        size_t diskBytes{0};
+        size_t rawBytes{0};
+        std::string spillDirectory;
+        bool full{false};
+
+        /// Drops the frames and their spill files; requires the mutex.
+        void clear();
+    };
+
+    /// Compresses a read back frame and stores it, spilling it if over budget. Runs on a worker thread.
+    static void _store(const std::shared_ptr<State> &state, size_t index, uint64_t generation,
+                       const AovView &view, const AovImage &color);
+
+    std::optional<size_t> _index(pxr::UsdTimeCode time) const;
+
+    AovReadback &_readback;
+    std::shared_ptr<State> _state;
+    std::vector<uint8_t> _decoded;
+    std::array<MTL::Texture *, 3> _textures{};
+};
+}// namespace vox
@@ -0,0 +1,379 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "frame_capture.h"
+
+#include <pxr/base/gf/half.h>
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/base/work/detachedTask.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/imaging/hd/aov.h>
+#include <pxr/imaging/hgi/blitCmds.h>
+#include <pxr/imaging/hgi/blitCmdsOps.h>
+#include <pxr/imaging/hio/image.h>
+#include <fmt/format.h>
+#include <simd/simd.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace vox {
+namespace {
+constexpr size_t SrgbTableSize = 4096;
+using SrgbTable = std::array<uint8_t, SrgbTableSize>;
+
+/// Linear to sRGB transfer function, quantized to 8 bits.
+const SrgbTable &srgbTable() {
+    static const SrgbTable table = [] {
+        SrgbTable t{};
+        for (size_t i = 0; i < SrgbTableSize; ++i) {
+            auto linear = float(i) / float(SrgbTableSize - 1);
+            auto encoded = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+            t[i] = uint8_t(std::lround(encoded * 255.f));
+        }
+        return t;
+    }();
+    return table;
+}
+
+inline void storePixel(simd_float4 pixel, uint8_t *out, const SrgbTable &lut, bool linearToSrgb) {
+    const simd_float4 zero = {0.f, 0.f, 0.f, 0.f};
+    const simd_float4 one = {1.f, 1.f, 1.f, 1.f};
+    pixel = simd_min(simd_max(pixel, zero), one);
+
+    simd_uchar4 quantized = simd_uchar(pixel * 255.f + 0.5f);
+    if (linearToSrgb) {
+        // Alpha stays linear.
+        simd_int4 index = simd_int(pixel * float(SrgbTableSize - 1) + 0.5f);
+        quantized.x = lut[index.x];
+        quantized.y = lut[index.y];
+        quantized.z = lut[index.z];
+    }
+    std::memcpy(out, &quantized, 4);
+}
+
+/// Sequence frames are named after their time code; subframes keep their fraction.
+std::string sequencePath(const std::string &directory, pxr::UsdTimeCode timeCode) {
+    auto frame = timeCode.IsDefault() ? 0.0 : timeCode.GetValue();
+    if (frame == std::round(frame)) {
+        return fmt::format("{}/frame.{:04d}.png", directory, int(frame));
+    }
+    return fmt::format("{}/frame.{:08.3f}.png", directory, frame);
+}
+
+void writeFrame(const AovFrame &frame, const std::string &path, bool includeDepth) {
+    auto color = frame.find(pxr::HdAovTokens->color);
+    if (!color || !color->isValid()) {
+        TF_WARN("No color AOV available for frame capture '%s'", path.c_str());
+        return;
+    }
+
+    auto width = color->dimensions[0];
+    auto height = color->dimensions[1];
+    std::vector<uint8_t> pixels(size_t(width) * size_t(height) * 4);
+    if (!convertToRGBA8(*color, pixels.data(), false)) {
+        return;
+    }
+
+    // AOVs are stored bottom row first.
+    pxr::HioImage::StorageSpec spec;
+    spec.width = width;
+    spec.height = height;
+    spec.format = pxr::HioFormatUNorm8Vec4srgb;
+    spec.flipped = true;
+    spec.data = pixels.data();
+    auto image = pxr::HioImage::OpenForWriting(path);
+    if (!image || !image->Write(spec)) {
+        TF_WARN("Failed to write frame capture '%s'", path.c_str());
+    }
+
+    auto depth = includeDepth ? frame.find(pxr::HdAovTokens->depth) : nullptr;
+    if (depth && depth->isValid() && depth->format == pxr::HgiFormatFloat32) {
+        auto depthPath = path.substr(0, path.find_last_of('.')) + ".depth.exr";
+        pxr::HioImage::StorageSpec depthSpec;
+        depthSpec.width = depth->dimensions[0];
+        depthSpec.height = depth->dimensions[1];
+        depthSpec.format = pxr::HioFormatFloat32;
+        depthSpec.flipped = true;
+        depthSpec.data = depth->data->data();
+        auto depthImage = pxr::HioImage::OpenForWriting(depthPath);
+        if (!depthImage || !depthImage->Write(depthSpec)) {
+            TF_WARN("Failed to write depth capture '%s'", depthPath.c_str());
+        }
+    }
+}
+/// Keeps the `region` texels at the origin of `image`, if it is smaller. Rows move
+/// down in place, each to an offset no greater than where it was read from.
+void crop(AovImage &image, const pxr::GfVec2i &region) {
+    if (!image.isValid() || region[0] <= 0 || region[1] <= 0 ||
+        (region[0] >= image.dimensions[0] && region[1] >= image.dimensions[1])) {
+        return;
+    }
+    auto width = size_t(std::min(region[0], image.dimensions[0]));
+    auto height = size_t(std::min(region[1], image.dimensions[1]));
+    auto rowBytes = width * image.texelSize();
+    auto stride = size_t(image.dimensions[0]) * image.texelSize();
+    auto *data = image.data->data();
+    for (size_t row = 1; row < height; ++row) {
+        std::memmove(data + row * rowBytes, data + row * stride, rowBytes);
+    }
+    image.data->resize(height * rowBytes);
+    image.dimensions = pxr::GfVec3i(int(width), int(height), image.dimensions[2]);
+}
+}// namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+ReadbackBufferPool::ReadbackBufferPool(size_t maxFreeBuffers)
+    : _state{std::make_shared<State>()} {
+    _state->maxFree = maxFreeBuffers;
+}
+
+ReadbackBufferPool::BufferPtr ReadbackBufferPool::acquire(size_t size) {
+    std::unique_ptr<Buffer> buffer;
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        // Prefer the smallest free buffer that already has enough capacity.
+        auto best = _state->free.end();
+        for (auto it = _state->free.begin(); it != _state->free.end(); ++it) {
+            if ((*it)->capacity() >= size && (best == _state->free.end() || (*it)->capacity() < (*best)->capacity())) {
+                best = it;
+            }
+        }
+        if (best == _state->free.end() && !_state->free.empty()) {
+            best = _state->free.begin();
+        }
+        if (best != _state->free.end()) {
+            buffer = std::move(*best);
+            _state->free.erase(best);
+        }
+    }
+    if (!buffer) {
+        buffer = std::make_unique<Buffer>();
+    }
+    buffer->resize(size);
+
+    std::weak_ptr<State> weakState = _state;
+    return {buffer.release(), [weakState](Buffer *released) {
+                if (auto state = weakState.lock()) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (state->free.size() < state->maxFree) {
+                        state->free.emplace_back(released);
+                        return;
+                    }
+                }
+                delete released;
+            }};
+}
+
+size_t AovImage::texelSize() const {
+    return pxr::HgiGetDataSizeOfFormat(format);
+}
+
+const AovImage *AovFrame::find(const pxr::TfToken &name) const {
+    auto iter = aovs.find(name);
+    return iter == aovs.end() ? nullptr : &iter->second;
+}
+
+bool AovView::operator==(const AovView &other) const {
+    return viewMatrix == other.viewMatrix && projectionMatrix == other.projectionMatrix &&
+           time == other.time && windowSize == other.windowSize && viewport == other.viewport;
+}
+
+bool AovView::sameFraming(const AovView &other) const {
+    if (viewMatrix != other.viewMatrix || windowSize != other.windowSize || viewport != other.viewport) {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            auto depthTerm = j == 2 && (i == 2 || i == 3);
+            if (!depthTerm && projectionMatrix[i][j] != other.projectionMatrix[i][j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+pxr::GfVec3d AovView::unproject(double x, double y, float depth, const pxr::GfVec3i &dimensions) const {
+    // AOVs may be rendered below window resolution. Same convention as Hydra's
+    // pick task: [0, 1] depth to [-1, 1] NDC.
+    auto windowX = (x + 0.5) / dimensions[0] * windowSize[0];
+    auto windowY = (y + 0.5) / dimensions[1] * windowSize[1];
+    pxr::GfVec3d ndc((windowX - viewport[0]) / std::max(1, viewport[2]) * 2.0 - 1.0,
+                     (windowY - viewport[1]) / std::max(1, viewport[3]) * 2.0 - 1.0,
+                     depth * 2.0 - 1.0);
+    return (viewMatrix * projectionMatrix).GetInverse().Transform(ndc);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AovReadback::request(pxr::Hgi *hgi, uint64_t frameIndex, pxr::UsdTimeCode timeCode,
+                          const AovTextures &textures, Callback callback) {
+    auto frame = std::make_shared<AovFrame>();
+    frame->frameIndex = frameIndex;
+    frame->timeCode = timeCode;
+
+    pxr::HgiBlitCmdsUniquePtr blitCmds;
+    for (const auto &[name, texture] : textures) {
+        if (!texture) {
+            continue;
+        }
+        const auto &desc = texture->GetDescriptor();
+        AovImage image;
+        image.format = desc.format;
+        image.dimensions = desc.dimensions;
+        auto byteSize = image.texelSize() * size_t(desc.dimensions[0]) * size_t(desc.dimensions[1]);
+        if (byteSize == 0) {
+            continue;
+        }
+        image.data = _pool.acquire(byteSize);
+
+        if (!blitCmds) {
+            blitCmds = hgi->CreateBlitCmds();
+            blitCmds->PushDebugGroup("AovReadback");
+        }
+        pxr::HgiTextureGpuToCpuOp copyOp;
+        copyOp.gpuSourceTexture = texture;
+        copyOp.sourceTexelOffset = pxr::GfVec3i(0);
+        copyOp.mipLevel = 0;
+        copyOp.cpuDestinationBuffer = image.data->data();
+        copyOp.destinationByteOffset = 0;
+        copyOp.destinationBufferByteSize = byteSize;
+        blitCmds->CopyTextureGpuToCpu(copyOp);
+
+        frame->aovs.emplace(name, std::move(image));
+    }
+
+    if (blitCmds) {
+        blitCmds->PopDebugGroup();
+        hgi->SubmitCmds(blitCmds.get(), pxr::HgiSubmitWaitTypeNoWait);
+    }
+    _pending.push_back({std::move(frame), std::move(callback), _region});
+}
+
+void AovReadback::poll(uint64_t completedFrameIndex) {
+    while (!_pending.empty() && _pending.front().frame->frameIndex <= completedFrameIndex) {
+        auto pending = std::move(_pending.front());
+        _pending.pop_front();
+        for (auto &[name, image] : pending.frame->aovs) {
+            crop(image, pending.region);
+        }
+        if (pending.callback) {
+            pending.callback(std::move(pending.frame));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool convertToRGBA8(const AovImage &image, uint8_t *dst, bool linearToSrgb) {
+    if (!image.isValid()) {
+        return false;
+    }
+    switch (image.format) {
+        case pxr::HgiFormatUNorm8Vec4:
+        case pxr::HgiFormatUNorm8Vec4srgb:
+        case pxr::HgiFormatFloat16Vec4:
+        case pxr::HgiFormatFloat32Vec4:
+            break;
+        default:
+            TF_CODING_ERROR("Unsupported AOV format %d for 8-bit conversion", int(image.format));
+            return false;
+    }
+    auto width = size_t(image.dimensions[0]);
+    auto height = size_t(image.dimensions[1]);
+    const auto *src = image.data->data();
+    const auto &lut = srgbTable();
+
+    pxr::WorkParallelForN(height, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            auto out = dst + row * width * 4;
+            switch (image.format) {
+                case pxr::HgiFormatUNorm8Vec4:
+                case pxr::HgiFormatUNorm8Vec4srgb:
+                    std::memcpy(out, src + row * width * 4, width * 4);
+                    break;
+                case pxr::HgiFormatFloat16Vec4: {
+                    auto in = reinterpret_cast<const pxr::GfHalf *>(src) + row * width * 4;
+                    for (size_t x = 0; x < width; ++x, in += 4, out += 4) {
+                        simd_float4 pixel = {float(in[0]), float(in[1]), float(in[2]), float(in[3])};
+                        storePixel(pixel, out, lut, linearToSrgb);
+                    }
+                    break;
+                }
+                case pxr::HgiFormatFloat32Vec4: {
+                    auto in = reinterpret_cast<const simd_float4 *>(src) + row * width;
+                    for (size_t x = 0; x < width; ++x, out += 4) {
+                        storePixel(in[x], out, lut, linearToSrgb);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    });
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+FrameCapture::FrameCapture(AovReadback &readback)
+    : _readback{readback},
+      _encodesInFlight{std::make_shared<std::atomic<int>>(0)} {
+}
+
+void FrameCapture::grab(const std::string &path, bool includeDepth) {
+    _requests.push_back({path, includeDepth});
+}
+
+void FrameCapture::grabSequence(const std::string &directory, int frameCount) {
+    if (frameCount > 0) {
+        _sequence = Sequence{directory, frameCount, {}};
+    }
+}
+
+bool FrameCapture::wantsFrame(pxr::UsdTimeCode timeCode) const {
+    return !_requests.empty() || (_sequence && !_sequence->captured.count(timeCode));
+}
+
+void FrameCapture::readback(pxr::Hgi *hgi, uint64_t frameIndex, pxr::UsdTimeCode timeCode,
+                            const pxr::HgiTextureHandle &color, const pxr::HgiTextureHandle &depth) {
+    // A grab and a sequence frame can share one readback.
+    std::vector<Request> requests;
+    if (!_requests.empty()) {
+        requests.push_back(std::move(_requests.front()));
+        _requests.pop_front();
+    }
+    if (_sequence && _sequence->captured.insert(timeCode).second) {
+        requests.push_back({sequencePath(_sequence->directory, timeCode), false});
+        if (--_sequence->remaining == 0) {
+            _sequence.reset();
+        }
+    }
+    if (requests.empty()) {
+        return;
+    }
+
+    AovReadback::AovTextures textures = {{pxr::HdAovTokens->color, color}};
+    auto includeDepth = std::any_of(requests.begin(), requests.end(),
+                                    [](const Request &request) { return request.includeDepth; });
+    if (includeDepth) {
+        textures.emplace_back(pxr::HdAovTokens->depth, depth);
+    }
+
+    auto encodesInFlight = _encodesInFlight;
+    encodesInFlight->fetch_add(1);
+    _readback.request(hgi, frameIndex, timeCode, textures,
+                      [requests, encodesInFlight](std::shared_ptr<const AovFrame> frame) {
+                          pxr::WorkRunDetachedTask([requests, encodesInFlight, frame]() {
+                              for (const auto &request : requests) {
+                                  writeFrame(*frame, request.path, request.includeDepth);
+                              }
+                              encodesInFlight->fetch_sub(1);
+                          });
+                      });
+}
+
+}// namespace vox
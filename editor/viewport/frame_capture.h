@@ -0,0 +1,174 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec2i.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3i.h>
+#include <pxr/base/gf/vec4i.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/imaging/hgi/hgi.h>
+#include <pxr/imaging/hgi/texture.h>
+#include <pxr/usd/usd/timeCode.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vox {
+/// Pool of reusable CPU buffers that GPU readbacks are copied into.
+class ReadbackBufferPool {
+public:
+    using Buffer = std::vector<uint8_t>;
+    using BufferPtr = std::shared_ptr<Buffer>;
+
+    explicit ReadbackBufferPool(size_t maxFreeBuffers = 8);
+
+    /// Returns a buffer of `size` bytes. The buffer goes back to the pool
+    /// once the last reference to it is dropped, on whichever thread that is.
+    BufferPtr acquire(size_t size);
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Buffer>> free;
+        size_t maxFree;
+    };
+    std::shared_ptr<State> _state;
+};
+
+/// CPU copy of one AOV of a rendered frame.
+struct AovImage {
+    pxr::HgiFormat format{pxr::HgiFormatInvalid};
+    pxr::GfVec3i dimensions{0};
+    ReadbackBufferPool::BufferPtr data;
+
+    [[nodiscard]] bool isValid() const {
+        return data && dimensions[0] > 0 && dimensions[1] > 0;
+    }
+
+    [[nodiscard]] size_t texelSize() const;
+};
+
+/// AOVs read back from one frame.
+struct AovFrame {
+    uint64_t frameIndex{0};
+    pxr::UsdTimeCode timeCode{};
+    std::unordered_map<pxr::TfToken, AovImage, pxr::TfToken::HashFunctor> aovs;
+
+    [[nodiscard]] const AovImage *find(const pxr::TfToken &name) const;
+};
+
+/// Camera and window an AOV frame was rendered with, to map its texels back to the scene.
+struct AovView {
+    pxr::GfMatrix4d viewMatrix{1.0};
+    pxr::GfMatrix4d projectionMatrix{1.0};
+    pxr::UsdTimeCode time{};
+    pxr::GfVec2i windowSize{0};
+    /// Image area within the window, y up, the projection maps to.
+    pxr::GfVec4i viewport{0};
+
+    bool operator==(const AovView &other) const;
+    bool operator!=(const AovView &other) const { return !(*this == other); }
+
+    /// Same camera and window, ignoring the clipping planes, which auto clipping moves between frames.
+    [[nodiscard]] bool sameFraming(const AovView &other) const;
+
+    /// World position of texel (x, y) of an AOV of `dimensions` at [0, 1] depth.
+    [[nodiscard]] pxr::GfVec3d unproject(double x, double y, float depth, const pxr::GfVec3i &dimensions) const;
+};
+
+/// Copies AOV textures to the CPU without waiting on the GPU. Copies are
+/// encoded into the current frame; the frame is handed to its callback once
+/// the GPU reports that frame as completed.
+class AovReadback {
+public:
+    using AovTextures = std::vector<std::pair<pxr::TfToken, pxr::HgiTextureHandle>>;
+    using Callback = std::function<void(std::shared_ptr<const AovFrame>)>;
+
+    /// Encodes GPU to CPU copies of `textures`. Invalid handles are skipped.
+    void request(pxr::Hgi *hgi, uint64_t frameIndex, pxr::UsdTimeCode timeCode,
+                 const AovTextures &textures, Callback callback);
+
+    /// Runs the callbacks of every request whose frame the GPU has finished.
+    void poll(uint64_t completedFrameIndex);
+
+    [[nodiscard]] bool hasPending() const { return !_pending.empty(); }
+
+    /// Texels at the origin of the AOVs the frames being requested were rendered
+    /// into, when they are larger; images are cropped to it before callbacks see them.
+    void setRegion(const pxr::GfVec2i &region) { _region = region; }
+    [[nodiscard]] const pxr::GfVec2i &region() const { return _region; }
+
+private:
+    struct Pending {
+        std::shared_ptr<AovFrame> frame;
+        Callback callback;
+        pxr::GfVec2i region;
+    };
+    ReadbackBufferPool _pool;
+    std::deque<Pending> _pending;
+    pxr::GfVec2i _region{0};
+};
+
+/// Converts a color AOV to 8-bit RGBA, optionally encoding linear values to sRGB.
+/// Rows are converted in parallel. Returns false if the format can't be converted.
+bool convertToRGBA8(const AovImage &image, uint8_t *dst, bool linearToSrgb);
+
+/// Writes screenshots and image sequences from read back frames. Conversion
+/// and encoding run on worker threads so captures never stall the frame loop.
+/// Frames are written as the viewport shows them: the color AOV has already
+/// been through the color correction, if any.
+class FrameCapture {
+public:
+    explicit FrameCapture(AovReadback &readback);
+
+    /// Writes the next rendered frame to `path`. If `includeDepth` is set, the
+    /// depth AOV is written next to it as an OpenEXR file.
+    void grab(const std::string &path, bool includeDepth = false);
+
+    /// Writes the next `frameCount` distinct time codes rendered into `directory`,
+    /// each named after its frame. Redraws of a time code already written are skipped.
+    void grabSequence(const std::string &directory, int frameCount);
+
+    /// True if the frame being rendered at `timeCode` has to be read back.
+    [[nodiscard]] bool wantsFrame(pxr::UsdTimeCode timeCode) const;
+
+    /// Number of frames still being converted or encoded.
+    [[nodiscard]] int encodesInFlight() const { return _encodesInFlight->load(); }
+
+    /// Schedules the readback of the frame being rendered, if any capture asked for it.
+    void readback(pxr::Hgi *hgi, uint64_t frameIndex, pxr::UsdTimeCode timeCode,
+                  const pxr::HgiTextureHandle &color, const pxr::HgiTextureHandle &depth);
+
+private:
+    struct Request {
+        std::string path;
+        bool includeDepth;
+    };
+
+    struct Sequence {
+        std::string directory;
+        int remaining{0};
+        /// Time codes already written.
+        std::set<pxr::UsdTimeCode> captured;
+    };
+
+    AovReadback &_readback;
+    std::deque<Request> _requests;
+    std::optional<Sequence> _sequence;
+    std::shared_ptr<std::atomic<int>> _encodesInFlight;
+};
+
+}// namespace vox
@@ -0,0 +1,164 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "id_buffer.h"
+
+#include <pxr/imaging/hd/aov.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+
+namespace vox {
+namespace {
+/// Reads texel (x, y) of a 32-bit AOV; depth-stencil formats keep depth in the first 4 bytes.
+template<typename T>
+T readTexel(const AovImage &image, int x, int y) {
+    T value;
+    auto offset = (size_t(y) * size_t(image.dimensions[0]) + size_t(x)) * image.texelSize();
+    std::memcpy(&value, image.data->data() + offset, sizeof(T));
+    return value;
+}
+}// namespace
+
+IdBuffer::IdBuffer(AovReadback &readback)
+    : _readback{readback} {
+}
+
+bool IdBuffer::request(pxr::Hgi *hgi, uint64_t frameIndex, const View &view, pxr::UsdImagingGLEngine &engine) {
+    auto primId = engine.GetAovTexture(pxr::HdAovTokens->primId);
+    auto instanceId = engine.GetAovTexture(pxr::HdAovTokens->instanceId);
+    if (!primId || !instanceId) {
+        return false;
+    }
+    if (_pending) {
+        return true;
+    }
+
+    AovReadback::AovTextures textures = {{pxr::HdAovTokens->primId, primId},
+                                         {pxr::HdAovTokens->instanceId, instanceId},
+                                         {pxr::HdAovTokens->depth, engine.GetAovTexture(pxr::HdAovTokens->depth)}};
+    _pending = true;
+    auto generation = _generation;
+    _readback.request(hgi, frameIndex, view.time, textures,
+                      [this, view, generation](std::shared_ptr<const AovFrame> frame) {
+                          if (generation != _generation) {
+                              return;
+                          }
+                          _pending = false;
+                          _frame = std::move(frame);
+                          _frameView = view;
+                      });
+    return true;
+}
+
+bool IdBuffer::isCurrent(const View &view) const {
+    return _frame && _frameView == view;
+}
+
+void IdBuffer::invalidate() {
+    ++_generation;
+    _pending = false;
+    _frame.reset();
+    _resolved.clear();
+}
+
+IdBuffer::Hit IdBuffer::lookup(pxr::UsdImagingGLEngine &engine, double x, double y) {
+    static const Hit miss;
+    auto primIds = _frame ? _frame->find(pxr::HdAovTokens->primId) : nullptr;
+    auto instanceIds = _frame ? _frame->find(pxr::HdAovTokens->instanceId) : nullptr;
+    if (!primIds || !primIds->isValid() || !instanceIds || !instanceIds->isValid() ||
+        _frameView.windowSize[0] <= 0 || _frameView.windowSize[1] <= 0) {
+        return miss;
+    }
+
+    // The AOVs may be rendered below window resolution, and are stored bottom row first.
+    auto width = primIds->dimensions[0];
+    auto height = primIds->dimensions[1];
+    auto u = x / _frameView.windowSize[0];
+    auto v = 1.0 - y / _frameView.windowSize[1];
+    if (u < 0.0 || u >= 1.0 || v < 0.0 || v >= 1.0) {
+        return miss;
+    }
+    auto px = std::clamp(int(u * width), 0, width - 1);
+    auto py = std::clamp(int(v * height), 0, height - 1);
+
+    auto primId = readTexel<int32_t>(*primIds, px, py);
+    if (primId < 0) {
+        return miss;
+    }
+    auto hit = _resolve(engine, primId, readTexel<int32_t>(*instanceIds, px, py));
+
+    auto depth = _frame->find(pxr::HdAovTokens->depth);
+    if (depth && depth->isValid() && depth->dimensions == primIds->dimensions &&
+        (depth->format == pxr::HgiFormatFloat32 || depth->format == pxr::HgiFormatFloat32UInt8)) {
+        hit.point = _frameView.unproject(px, py, readTexel<float>(*depth, px, py), primIds->dimensions);
+    }
+    return hit;
+}
+
+std::vector<IdBuffer::Hit> IdBuffer::collect(pxr::UsdImagingGLEngine &engine, const pxr::GfRange2d &windowRect,
+                                             const std::function<bool(const pxr::GfVec2d &)> &contains) {
+    std::vector<Hit> hits;
+    auto primIds = _frame ? _frame->find(pxr::HdAovTokens->primId) : nullptr;
+    auto instanceIds = _frame ? _frame->find(pxr::HdAovTokens->instanceId) : nullptr;
+    if (!primIds || !primIds->isValid() || !instanceIds || !instanceIds->isValid() ||
+        _frameView.windowSize[0] <= 0 || _frameView.windowSize[1] <= 0) {
+        return hits;
+    }
+
+    auto width = primIds->dimensions[0];
+    auto height = primIds->dimensions[1];
+    auto scaleX = double(width) / _frameView.windowSize[0];
+    auto scaleY = double(height) / _frameView.windowSize[1];
+    auto x0 = std::clamp(int(windowRect.GetMin()[0] * scaleX), 0, width);
+    auto x1 = std::clamp(int(std::ceil(windowRect.GetMax()[0] * scaleX)), 0, width);
+    // Rows are stored bottom first.
+    auto y0 = std::clamp(int(height - std::ceil(windowRect.GetMax()[1] * scaleY)), 0, height);
+    auto y1 = std::clamp(int(height - windowRect.GetMin()[1] * scaleY), 0, height);
+
+    std::unordered_set<uint64_t> seen;
+    for (auto py = y0; py < y1; ++py) {
+        for (auto px = x0; px < x1; ++px) {
+            auto primId = readTexel<int32_t>(*primIds, px, py);
+            if (primId < 0) {
+                continue;
+            }
+            if (contains && !contains(pxr::GfVec2d((px + 0.5) / scaleX, (height - py - 0.5) / scaleY))) {
+                continue;
+            }
+            auto instanceId = readTexel<int32_t>(*instanceIds, px, py);
+            if (seen.insert((uint64_t(uint32_t(primId)) << 32) | uint32_t(instanceId)).second) {
+                auto hit = _resolve(engine, primId, instanceId);
+                if (!hit.primPath.IsEmpty()) {
+                    hits.push_back(std::move(hit));
+                }
+            }
+        }
+    }
+    return hits;
+}
+
+const IdBuffer::Hit &IdBuffer::_resolve(pxr::UsdImagingGLEngine &engine, int primId, int instanceId) {
+    auto key = (uint64_t(uint32_t(primId)) << 32) | uint32_t(instanceId);
+    auto iter = _resolved.find(key);
+    if (iter != _resolved.end()) {
+        return iter->second;
+    }
+
+    Hit hit;
+    auto rprimPath = engine.GetRprimPathFromPrimId(primId);
+    if (!rprimPath.IsEmpty()) {
+        hit.primPath = engine.GetScenePrimPath(rprimPath, instanceId, &hit.instancerContext);
+        if (!hit.instancerContext.empty()) {
+            hit.instancerPath = hit.instancerContext.back().first;
+            hit.instanceIndex = hit.instancerContext.back().second;
+        }
+    }
+    return _resolved.emplace(key, std::move(hit)).first->second;
+}
+
+}// namespace vox
@@ -0,0 +1,69 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include "frame_capture.h"
+
+#include <pxr/imaging/hd/types.h>
+#include <pxr/usdImaging/usdImagingGL/engine.h>
+#include <pxr/base/gf/range2d.h>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+
+namespace vox {
+/// CPU copy of the primId/instanceId AOVs of a rendered frame, so rollover
+/// picks are a pixel lookup instead of another render. Resolved ids are cached
+/// until the scene changes.
+class IdBuffer {
+public:
+    /// What the buffer was rendered from; a buffer is only used for the same view.
+    using View = AovView;
+
+    struct Hit {
+        pxr::SdfPath primPath;
+        pxr::SdfPath instancerPath;
+        int instanceIndex{-1};
+        pxr::HdInstancerContext instancerContext;
+        pxr::GfVec3d point{-1.0, -1.0, -1.0};
+    };
+
+    explicit IdBuffer(AovReadback &readback);
+
+    /// Queues a readback of the id AOVs of the frame being encoded, unless one is
+    /// already in flight. Returns false if the engine doesn't provide the AOVs.
+    bool request(pxr::Hgi *hgi, uint64_t frameIndex, const View &view, pxr::UsdImagingGLEngine &engine);
+
+    [[nodiscard]] bool isPending() const { return _pending; }
+
+    /// True if the buffer holds ids rendered for `view`.
+    [[nodiscard]] bool isCurrent(const View &view) const;
+
+    /// Drops the buffer and the resolved ids; call when the scene changes.
+    void invalidate();
+
+    /// Looks up window pixel (x, y), origin at the top left. The hit has an empty
+    /// path over the background.
+    Hit lookup(pxr::UsdImagingGLEngine &engine, double x, double y);
+
+    /// One hit per distinct id inside `windowRect`, origin at the top left. With
+    /// `contains`, only pixels whose window position passes it are considered.
+    std::vector<Hit> collect(pxr::UsdImagingGLEngine &engine, const pxr::GfRange2d &windowRect,
+                             const std::function<bool(const pxr::GfVec2d &)> &contains = {});
+
+private:
+    const Hit &_resolve(pxr::UsdImagingGLEngine &engine, int primId, int instanceId);
+
+    AovReadback &_readback;
+    std::shared_ptr<const AovFrame> _frame;
+    View _frameView;
+    bool _pending{false};
+    // Bumped by invalidate(), so readbacks of older frames are discarded.
+    uint64_t _generation{0};
+    std::unordered_map<uint64_t, Hit> _resolved;
+};
+}// namespace vox
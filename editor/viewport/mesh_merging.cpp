@@ -0,0 +1,764 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "mesh_merging.h"
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/imaging/hd/extentSchema.h>
+#include <pxr/imaging/hd/instancedBySchema.h>
+#include <pxr/imaging/hd/legacyDisplayStyleSchema.h>
+#include <pxr/imaging/hd/materialBindingsSchema.h>
+#include <pxr/imaging/hd/materialBindingSchema.h>
+#include <pxr/imaging/hd/meshSchema.h>
+#include <pxr/imaging/hd/meshTopologySchema.h>
+#include <pxr/imaging/hd/primvarsSchema.h>
+#include <pxr/imaging/hd/purposeSchema.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/visibilitySchema.h>
+#include <pxr/imaging/hd/xformSchema.h>
+#include <pxr/imaging/pxOsd/tokens.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <limits>
+
+namespace vox {
+namespace {
+/// Vertices per merged mesh, so an edit never rebuilds more than this.
+constexpr size_t MaxBatchVertices = size_t(1) << 18;
+/// Storm's color for meshes without displayColor.
+const pxr::GfVec3f FallbackDisplayColor(0.18f);
+const pxr::TfToken StToken("st");
+
+bool isVarying(const pxr::HdSampledDataSourceHandle &dataSource) {
+    std::vector<pxr::HdSampledDataSource::Time> times;
+    return dataSource && dataSource->GetContributingSampleTimesForInterval(-1.f, 1.f, &times);
+}
+
+template<typename T>
+T typedValue(const typename pxr::HdTypedSampledDataSource<T>::Handle &dataSource, const T &fallback) {
+    return dataSource ? dataSource->GetTypedValue(0.f) : fallback;
+}
+
+/// Value of a display primvar per vertex: constant values are repeated.
+template<typename T>
+bool expandPrimvar(const pxr::HdPrimvarSchema &primvar, size_t vertexCount, std::vector<T> *out) {
+    auto valueSource = primvar.GetFlattenedPrimvarValue();
+    if (!valueSource) {
+        return false;
+    }
+    auto value = valueSource->GetValue(0.f);
+    if (!value.IsHolding<pxr::VtArray<T>>()) {
+        return false;
+    }
+    const auto &array = value.UncheckedGet<pxr::VtArray<T>>();
+    auto interpolation = typedValue<pxr::TfToken>(primvar.GetInterpolation(), pxr::TfToken());
+    if (interpolation == pxr::HdPrimvarSchemaTokens->constant && !array.empty()) {
+        out->insert(out->end(), vertexCount, array[0]);
+        return true;
+    }
+    if (array.size() != vertexCount) {
+        return false;
+    }
+    out->insert(out->end(), array.begin(), array.end());
+    return true;
+}
+
+/// Value of a primvar per face-vertex, in the order `_rebuild` lays out the faces.
+template<typename T>
+bool expandFaceVarying(const pxr::HdPrimvarSchema &primvar, const pxr::VtIntArray &counts,
+                       const pxr::VtIntArray &indices, bool flip, std::vector<T> *out) {
+    auto valueSource = primvar.GetFlattenedPrimvarValue();
+    auto value = valueSource ? valueSource->GetValue(0.f) : pxr::VtValue();
+    if (!value.IsHolding<pxr::VtArray<T>>()) {
+        return false;
+    }
+    const auto &array = value.UncheckedGet<pxr::VtArray<T>>();
+    auto interpolation = typedValue<pxr::TfToken>(primvar.GetInterpolation(), pxr::TfToken());
+    auto start = out->size();
+    size_t offset = 0;
+    for (size_t face = 0; face < counts.size(); ++face) {
+        auto count = size_t(counts[face]);
+        if (offset + count > indices.size()) {
+            break;
+        }
+        for (size_t k = 0; k < count; ++k) {
+            auto faceVertex = offset + (flip ? count - 1 - k : k);
+            size_t element;
+            if (interpolation == pxr::HdPrimvarSchemaTokens->constant) {
+                element = 0;
+            } else if (interpolation == pxr::HdPrimvarSchemaTokens->uniform) {
+                element = face;
+            } else if (interpolation == pxr::HdPrimvarSchemaTokens->faceVarying) {
+                element = faceVertex;
+            } else {
+                element = size_t(indices[faceVertex]);
+            }
+            if (element >= array.size()) {
+                out->resize(start);
+                return false;
+            }
+            out->push_back(array[element]);
+        }
+        offset += count;
+    }
+    return true;
+}
+
+/// True if `interpolation` has a value per point, so merging can keep it per vertex.
+bool isPerVertex(const pxr::TfToken &interpolation) {
+    return interpolation == pxr::HdPrimvarSchemaTokens->constant ||
+           interpolation == pxr::HdPrimvarSchemaTokens->vertex ||
+           interpolation == pxr::HdPrimvarSchemaTokens->varying;
+}
+
+/// Where a change of a merged mesh shows on its batch, for the locators the batch reads.
+pxr::HdDataSourceLocatorSet batchLocators(const pxr::HdDataSourceLocatorSet &dirtyLocators) {
+    // Points and normals are baked with the transform, and the extent is recomputed from them.
+    static const pxr::HdDataSourceLocatorSet geometry{pxr::HdMeshSchema::GetDefaultLocator(),
+                                                      pxr::HdPrimvarsSchema::GetDefaultLocator(),
+                                                      pxr::HdXformSchema::GetDefaultLocator()};
+    pxr::HdDataSourceLocatorSet locators;
+    if (dirtyLocators.Intersects(geometry)) {
+        locators.insert(pxr::HdMeshSchema::GetDefaultLocator());
+        locators.insert(pxr::HdPrimvarsSchema::GetDefaultLocator());
+        locators.insert(pxr::HdExtentSchema::GetDefaultLocator());
+    }
+    for (const auto &locator : {pxr::HdMaterialBindingsSchema::GetDefaultLocator(), pxr::HdPurposeSchema::GetDefaultLocator(),
+                                pxr::HdLegacyDisplayStyleSchema::GetDefaultLocator()}) {
+        if (dirtyLocators.Intersects(locator)) {
+            locators.insert(locator);
+        }
+    }
+    return locators;
+}
+
+/// What merging reads from a mesh; other changes leave it and its batch alone.
+const pxr::HdDataSourceLocatorSet &mergedLocators() {
+    static const pxr::HdDataSourceLocatorSet locators{
+        pxr::HdMeshSchema::GetDefaultLocator(), pxr::HdPrimvarsSchema::GetDefaultLocator(),
+        pxr::HdXformSchema::GetDefaultLocator(), pxr::HdVisibilitySchema::GetDefaultLocator(),
+        pxr::HdMaterialBindingsSchema::GetDefaultLocator(), pxr::HdPurposeSchema::GetDefaultLocator(),
+        pxr::HdLegacyDisplayStyleSchema::GetDefaultLocator(), pxr::HdInstancedBySchema::GetDefaultLocator()};
+    return locators;
+}
+
+pxr::HdContainerDataSourceHandle buildPrimvar(const pxr::HdSampledDataSourceHandle &value,
+                                              const pxr::TfToken &interpolation, const pxr::TfToken &role) {
+    return pxr::HdPrimvarSchema::Builder()
+        .SetPrimvarValue(value)
+        .SetInterpolation(pxr::HdPrimvarSchema::BuildInterpolationDataSource(interpolation))
+        .SetRole(pxr::HdPrimvarSchema::BuildRoleDataSource(role))
+        .Build();
+}
+
+/// Squared distance from `p` to triangle (a, b, c).
+double distanceSquared(const pxr::GfVec3d &p, const pxr::GfVec3d &a, const pxr::GfVec3d &b, const pxr::GfVec3d &c) {
+    auto ab = b - a, ac = c - a, ap = p - a;
+    auto d1 = pxr::GfDot(ab, ap), d2 = pxr::GfDot(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0) {
+        return ap.GetLengthSq();
+    }
+    auto bp = p - b;
+    auto d3 = pxr::GfDot(ab, bp), d4 = pxr::GfDot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3) {
+        return bp.GetLengthSq();
+    }
+    auto vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+        return (p - (a + ab * (d1 / (d1 - d3)))).GetLengthSq();
+    }
+    auto cp = p - c;
+    auto d5 = pxr::GfDot(ab, cp), d6 = pxr::GfDot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6) {
+        return cp.GetLengthSq();
+    }
+    auto vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+        return (p - (a + ac * (d2 / (d2 - d6)))).GetLengthSq();
+    }
+    auto va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+        return (p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))).GetLengthSq();
+    }
+    auto denom = 1.0 / (va + vb + vc);
+    return (p - (a + ab * (vb * denom) + ac * (vc * denom))).GetLengthSq();
+}
+}// namespace
+
+bool MeshMergingSceneIndex::Key::operator==(const Key &other) const {
+    return root == other.root && material == other.material && purpose == other.purpose &&
+           subdivisionScheme == other.subdivisionScheme && refineLevel == other.refineLevel &&
+           doubleSided == other.doubleSided && primvars == other.primvars;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MeshMergingSceneIndexRefPtr MeshMergingSceneIndex::New(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                                       std::set<pxr::SdfPath> batchRoots) {
+    return pxr::TfCreateRefPtr(new MeshMergingSceneIndex(inputScene, std::move(batchRoots)));
+}
+
+MeshMergingSceneIndex::MeshMergingSceneIndex(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                             std::set<pxr::SdfPath> batchRoots)
+    : pxr::HdSingleInputFilteringSceneIndexBase(inputScene), _batchRoots{std::move(batchRoots)} {
+}
+
+pxr::HdSceneIndexPrim MeshMergingSceneIndex::GetPrim(const pxr::SdfPath &primPath) const {
+    // The maps are only written while notices are processed, never during sync.
+    if (_batchIndices.count(primPath)) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (const auto *batch = _built(primPath)) {
+            return {pxr::HdPrimTypeTokens->mesh, batch->dataSource};
+        }
+    }
+    if (_sourceBatches.count(primPath)) {
+        return {pxr::TfToken(), nullptr};
+    }
+    return _GetInputSceneIndex()->GetPrim(primPath);
+}
+
+pxr::SdfPathVector MeshMergingSceneIndex::GetChildPrimPaths(const pxr::SdfPath &primPath) const {
+    auto children = _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+    if (auto it = _rootBatches.find(primPath); it != _rootBatches.end()) {
+        for (auto index : it->second) {
+            children.push_back(_batches[index].path);
+        }
+    }
+    return children;
+}
+
+bool MeshMergingSceneIndex::isMerged(const pxr::SdfPath &primPath) const {
+    return _batchIndices.count(primPath) > 0;
+}
+
+pxr::SdfPath MeshMergingSceneIndex::sourcePrim(const pxr::SdfPath &primPath, const pxr::GfVec3d &point) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto *batch = _built(primPath);
+    if (!batch || batch->sources.empty()) {
+        return primPath;
+    }
+    // Sources whose bounds hold the point are tested against their faces, the closest face wins.
+    // Without any, the source with the closest bounds is taken.
+    size_t best = 0;
+    auto bestDistance = std::numeric_limits<double>::infinity();
+    auto closestBounds = std::numeric_limits<double>::infinity();
+    bool contained = false;
+    for (size_t i = 0; i < batch->sources.size(); ++i) {
+        auto bounds = batch->bounds[i];
+        if (bounds.IsEmpty()) {
+            continue;
+        }
+        auto margin = std::max(bounds.GetSize().GetLength(), 1e-6) * 1e-3;
+        bounds.SetMin(bounds.GetMin() - pxr::GfVec3d(margin));
+        bounds.SetMax(bounds.GetMax() + pxr::GfVec3d(margin));
+        if (!bounds.Contains(point)) {
+            auto distance = (bounds.GetMidpoint() - point).GetLengthSq();
+            if (!contained && distance < closestBounds) {
+                closestBounds = distance;
+                best = i;
+            }
+            continue;
+        }
+        contained = true;
+        auto index = batch->firstIndex[i];
+        for (auto face = batch->firstFace[i]; face < batch->firstFace[i + 1]; ++face) {
+            auto count = size_t(batch->faceVertexCounts[face]);
+            pxr::GfVec3d first(batch->points[size_t(batch->faceVertexIndices[index])]);
+            for (size_t k = 1; k + 1 < count; ++k) {
+                pxr::GfVec3d b(batch->points[size_t(batch->faceVertexIndices[index + k])]);
+                pxr::GfVec3d c(batch->points[size_t(batch->faceVertexIndices[index + k + 1])]);
+                auto distance = distanceSquared(point, first, b, c);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = i;
+                }
+            }
+            index += count;
+        }
+    }
+    return batch->sources[best];
+}
+
+std::vector<std::pair<pxr::SdfPath, pxr::GfRange3d>> MeshMergingSceneIndex::sourcePrims(const pxr::SdfPath &primPath) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::pair<pxr::SdfPath, pxr::GfRange3d>> sources;
+    if (const auto *batch = _built(primPath)) {
+        for (size_t i = 0; i < batch->sources.size(); ++i) {
+            sources.emplace_back(batch->sources[i], batch->bounds[i]);
+        }
+    }
+    return sources;
+}
+
+size_t MeshMergingSceneIndex::mergedMeshCount() const {
+    return _sourceBatches.size();
+}
+
+size_t MeshMergingSceneIndex::batchCount() const {
+    return _batchIndices.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+pxr::SdfPath MeshMergingSceneIndex::_batchRoot(const pxr::SdfPath &primPath) const {
+    for (auto path = primPath.GetParentPath(); !path.IsEmpty() && !path.IsAbsoluteRootPath(); path = path.GetParentPath()) {
+        if (_batchRoots.count(path)) {
+            return path;
+        }
+    }
+    auto prefixes = primPath.GetPrefixes();
+    return prefixes.size() > 1 ? prefixes.front() : primPath.GetParentPath();
+}
+
+std::optional<MeshMergingSceneIndex::Membership> MeshMergingSceneIndex::_membership(const pxr::SdfPath &primPath) const {
+    const auto &input = _GetInputSceneIndex();
+    auto prim = input->GetPrim(primPath);
+    if (prim.primType != pxr::HdPrimTypeTokens->mesh || !prim.dataSource) {
+        return std::nullopt;
+    }
+    // Instanced meshes are already batched, and subsets need faces kept apart.
+    if (pxr::HdInstancedBySchema::GetFromParent(prim.dataSource).IsDefined() ||
+        !input->GetChildPrimPaths(primPath).empty()) {
+        return std::nullopt;
+    }
+
+    auto mesh = pxr::HdMeshSchema::GetFromParent(prim.dataSource);
+    auto topology = mesh.GetTopology();
+    if (!topology.GetFaceVertexCounts() || !topology.GetFaceVertexIndices() ||
+        isVarying(topology.GetFaceVertexCounts()) || isVarying(topology.GetFaceVertexIndices())) {
+        return std::nullopt;
+    }
+
+    Membership membership;
+    auto primvars = pxr::HdPrimvarsSchema::GetFromParent(prim.dataSource);
+    for (const auto &name : primvars.GetPrimvarNames()) {
+        auto primvar = primvars.GetPrimvar(name);
+        auto value = primvar.GetFlattenedPrimvarValue();
+        if (isVarying(value)) {
+            return std::nullopt;
+        }
+        if (name == pxr::HdTokens->points) {
+            auto points = value ? value->GetValue(0.f) : pxr::VtValue();
+            if (!points.IsHolding<pxr::VtVec3fArray>()) {
+                return std::nullopt;
+            }
+            membership.vertexCount = points.UncheckedGet<pxr::VtVec3fArray>().size();
+            continue;
+        }
+        auto interpolation = typedValue<pxr::TfToken>(primvar.GetInterpolation(), pxr::TfToken());
+        auto valueType = value ? value->GetValue(0.f) : pxr::VtValue();
+        // Normals and st may be faceVarying; the batch then has them per face-vertex.
+        if (name == pxr::HdTokens->normals && valueType.IsHolding<pxr::VtVec3fArray>()) {
+            membership.key.primvars.push_back(name);
+            continue;
+        }
+        if (name == StToken && valueType.IsHolding<pxr::VtVec2fArray>()) {
+            membership.key.primvars.push_back(name);
+            continue;
+        }
+        if ((name != pxr::HdTokens->displayColor && name != pxr::HdTokens->displayOpacity) || !isPerVertex(interpolation)) {
+            return std::nullopt;
+        }
+    }
+    std::sort(membership.key.primvars.begin(), membership.key.primvars.end());
+    if (membership.vertexCount == 0) {
+        return std::nullopt;
+    }
+
+    auto matrix = pxr::HdXformSchema::GetFromParent(prim.dataSource).GetMatrix();
+    auto visibility = pxr::HdVisibilitySchema::GetFromParent(prim.dataSource).GetVisibility();
+    if (isVarying(matrix) || isVarying(visibility) || !typedValue<bool>(visibility, true)) {
+        return std::nullopt;
+    }
+
+    auto binding = pxr::HdMaterialBindingsSchema::GetFromParent(prim.dataSource).GetMaterialBinding();
+    membership.key.root = _batchRoot(primPath);
+    membership.key.material = typedValue<pxr::SdfPath>(binding.GetPath(), pxr::SdfPath());
+    membership.key.purpose = typedValue<pxr::TfToken>(pxr::HdPurposeSchema::GetFromParent(prim.dataSource).GetPurpose(),
+                                                      pxr::HdTokens->geometry);
+    membership.key.subdivisionScheme = typedValue<pxr::TfToken>(mesh.GetSubdivisionScheme(), pxr::PxOsdOpenSubdivTokens->none);
+    membership.key.doubleSided = typedValue<bool>(mesh.GetDoubleSided(), false);
+    membership.key.refineLevel = typedValue<int>(
+        pxr::HdLegacyDisplayStyleSchema::GetFromParent(prim.dataSource).GetRefineLevel(), 0);
+    return membership;
+}
+
+void MeshMergingSceneIndex::_assign(const pxr::SdfPath &primPath, const std::optional<Membership> &membership,
+                                    Changes &changes, const pxr::HdDataSourceLocatorSet &dirtyLocators) {
+    if (auto it = _sourceBatches.find(primPath); it != _sourceBatches.end()) {
+        auto &batch = _batches[it->second];
+        auto stays = membership && batch.key == membership->key &&
+                     batch.vertexCount - _sourceVertexCounts[primPath] + membership->vertexCount <= MaxBatchVertices;
+        if (stays) {
+            // Its points may have changed count.
+            _sourceVertexCounts[primPath] = membership->vertexCount;
+            _countVertices(batch);
+            auto locators = batchLocators(dirtyLocators);
+            if (!locators.IsEmpty()) {
+                batch.dirty = true;
+                changes.dirtied.push_back({batch.path, locators});
+            }
+            return;
+        }
+        _unassign(primPath, changes);
+        if (!membership) {
+            changes.added.push_back({primPath, pxr::HdPrimTypeTokens->mesh});
+        }
+    }
+    if (!membership) {
+        return;
+    }
+
+    const auto &key = membership->key;
+    auto &rootBatches = _rootBatches[key.root];
+    auto found = std::find_if(rootBatches.begin(), rootBatches.end(), [&](size_t index) {
+        const auto &batch = _batches[index];
+        return batch.key == key && batch.vertexCount + membership->vertexCount <= MaxBatchVertices;
+    });
+    size_t index;
+    if (found != rootBatches.end()) {
+        index = *found;
+        changes.dirtied.push_back({_batches[index].path, pxr::HdDataSourceLocatorSet::UniversalSet()});
+    } else {
+        index = _batches.size();
+        Batch batch;
+        batch.key = key;
+        batch.path = key.root.AppendChild(pxr::TfToken(fmt::format("__merged_{}", _rootNameCounters[key.root]++)));
+        _batches.push_back(std::move(batch));
+        _batchIndices[_batches[index].path] = index;
+        rootBatches.push_back(index);
+        changes.added.push_back({_batches[index].path, pxr::HdPrimTypeTokens->mesh});
+    }
+    auto &batch = _batches[index];
+    batch.sources.push_back(primPath);
+    _sourceVertexCounts[primPath] = membership->vertexCount;
+    _countVertices(batch);
+    batch.dirty = true;
+    _sourceBatches[primPath] = index;
+}
+
+void MeshMergingSceneIndex::_unassign(const pxr::SdfPath &primPath, Changes &changes) {
+    auto it = _sourceBatches.find(primPath);
+    if (it == _sourceBatches.end()) {
+        return;
+    }
+    auto index = it->second;
+    _sourceBatches.erase(it);
+    _sourceVertexCounts.erase(primPath);
+    auto &batch = _batches[index];
+    batch.sources.erase(std::remove(batch.sources.begin(), batch.sources.end(), primPath), batch.sources.end());
+    _countVertices(batch);
+    batch.dirty = true;
+    if (!batch.sources.empty()) {
+        changes.dirtied.push_back({batch.path, pxr::HdDataSourceLocatorSet::UniversalSet()});
+        return;
+    }
+    changes.removed.push_back({batch.path});
+    _batchIndices.erase(batch.path);
+    auto &rootBatches = _rootBatches[batch.key.root];
+    rootBatches.erase(std::remove(rootBatches.begin(), rootBatches.end(), index), rootBatches.end());
+    if (rootBatches.empty()) {
+        _rootBatches.erase(batch.key.root);
+    }
+    // The slot stays so other indices hold; it is only emptied.
+    batch = Batch{};
+}
+
+void MeshMergingSceneIndex::_countVertices(Batch &batch) const {
+    batch.vertexCount = 0;
+    for (const auto &source : batch.sources) {
+        if (auto it = _sourceVertexCounts.find(source); it != _sourceVertexCounts.end()) {
+            batch.vertexCount += it->second;
+        }
+    }
+}
+
+const MeshMergingSceneIndex::Batch *MeshMergingSceneIndex::_built(const pxr::SdfPath &primPath) const {
+    auto it = _batchIndices.find(primPath);
+    if (it == _batchIndices.end()) {
+        return nullptr;
+    }
+    auto &batch = _batches[it->second];
+    if (batch.dirty) {
+        _rebuild(batch);
+    }
+    return &batch;
+}
+
+void MeshMergingSceneIndex::_rebuild(Batch &batch) const {
+    const auto &input = _GetInputSceneIndex();
+    std::vector<pxr::GfVec3f> points, colors, normals;
+    std::vector<pxr::GfVec2f> sts;
+    std::vector<float> opacities;
+    std::vector<int> faceVertexCounts, faceVertexIndices, holeIndices;
+    bool hasColors = false, hasOpacities = false;
+    pxr::HdContainerDataSourceHandle materialBindings, purpose, displayStyle;
+    pxr::GfRange3d extent;
+    batch.firstFace.clear();
+    batch.firstIndex.clear();
+    batch.bounds.clear();
+
+    // Normals and st stay per vertex unless a source has them per face or face-vertex.
+    auto hasNormals = std::count(batch.key.primvars.begin(), batch.key.primvars.end(), pxr::HdTokens->normals) > 0;
+    auto hasSts = std::count(batch.key.primvars.begin(), batch.key.primvars.end(), StToken) > 0;
+    bool faceVaryingNormals = false, faceVaryingSts = false;
+    for (const auto &source : batch.sources) {
+        auto prim = input->GetPrim(source);
+        auto primvars = pxr::HdPrimvarsSchema::GetFromParent(prim.dataSource);
+        faceVaryingNormals |= hasNormals && !isPerVertex(typedValue<pxr::TfToken>(
+                                                  primvars.GetPrimvar(pxr::HdTokens->normals).GetInterpolation(), pxr::TfToken()));
+        faceVaryingSts |= hasSts && !isPerVertex(typedValue<pxr::TfToken>(
+                                          primvars.GetPrimvar(StToken).GetInterpolation(), pxr::TfToken()));
+    }
+
+    for (const auto &source : batch.sources) {
+        batch.firstFace.push_back(faceVertexCounts.size());
+        batch.firstIndex.push_back(faceVertexIndices.size());
+        batch.bounds.emplace_back();
+        auto prim = input->GetPrim(source);
+        if (!prim.dataSource) {
+            continue;
+        }
+        auto topology = pxr::HdMeshSchema::GetFromParent(prim.dataSource).GetTopology();
+        auto counts = typedValue<pxr::VtIntArray>(topology.GetFaceVertexCounts(), {});
+        auto indices = typedValue<pxr::VtIntArray>(topology.GetFaceVertexIndices(), {});
+        auto holes = typedValue<pxr::VtIntArray>(topology.GetHoleIndices(), {});
+        auto primvars = pxr::HdPrimvarsSchema::GetFromParent(prim.dataSource);
+        auto pointsValue = primvars.GetPrimvar(pxr::HdTokens->points).GetFlattenedPrimvarValue();
+        auto sourcePoints = pointsValue ? pointsValue->GetValue(0.f) : pxr::VtValue();
+        if (!sourcePoints.IsHolding<pxr::VtVec3fArray>()) {
+            continue;
+        }
+        const auto &localPoints = sourcePoints.UncheckedGet<pxr::VtVec3fArray>();
+        auto matrix = typedValue<pxr::GfMatrix4d>(pxr::HdXformSchema::GetFromParent(prim.dataSource).GetMatrix(),
+                                                  pxr::GfMatrix4d(1.0));
+        if (!materialBindings) {
+            materialBindings = pxr::HdMaterialBindingsSchema::GetFromParent(prim.dataSource).GetContainer();
+            purpose = pxr::HdPurposeSchema::GetFromParent(prim.dataSource).GetContainer();
+            displayStyle = pxr::HdLegacyDisplayStyleSchema::GetFromParent(prim.dataSource).GetContainer();
+        }
+
+        auto firstVertex = int(points.size());
+        auto &bounds = batch.bounds.back();
+        for (const auto &point : localPoints) {
+            auto world = matrix.Transform(pxr::GfVec3d(point));
+            bounds.UnionWith(world);
+            points.emplace_back(world);
+        }
+        extent.UnionWith(bounds);
+
+        // Baking a mirroring transform or a left-handed orientation flips the winding.
+        auto leftHanded = typedValue<pxr::TfToken>(topology.GetOrientation(), pxr::HdMeshTopologySchemaTokens->rightHanded) ==
+                          pxr::HdMeshTopologySchemaTokens->leftHanded;
+        auto flip = leftHanded != (matrix.GetDeterminant() < 0.0);
+        auto firstFace = int(faceVertexCounts.size());
+        size_t offset = 0;
+        for (auto count : counts) {
+            if (offset + size_t(count) > indices.size()) {
+                break;
+            }
+            faceVertexCounts.push_back(count);
+            for (int k = 0; k < count; ++k) {
+                auto vertex = indices[offset + size_t(flip ? count - 1 - k : k)];
+                faceVertexIndices.push_back(firstVertex + vertex);
+            }
+            offset += size_t(count);
+        }
+        for (auto hole : holes) {
+            holeIndices.push_back(firstFace + hole);
+        }
+
+        auto vertexCount = localPoints.size();
+        auto faceVertexCount = faceVertexIndices.size() - batch.firstIndex.back();
+        if (hasNormals) {
+            auto first = normals.size();
+            auto expanded = faceVaryingNormals
+                                ? expandFaceVarying(primvars.GetPrimvar(pxr::HdTokens->normals), counts, indices, flip, &normals)
+                                : expandPrimvar(primvars.GetPrimvar(pxr::HdTokens->normals), vertexCount, &normals);
+            if (!expanded) {
+                normals.resize(first + (faceVaryingNormals ? faceVertexCount : vertexCount), pxr::GfVec3f(0.f));
+            }
+            // Normals go through the inverse transpose, which keeps them perpendicular under scaling.
+            auto normalMatrix = matrix.GetInverse().GetTranspose();
+            for (auto i = first; i < normals.size(); ++i) {
+                normals[i] = pxr::GfVec3f(normalMatrix.TransformDir(pxr::GfVec3d(normals[i])).GetNormalized());
+            }
+        }
+        if (hasSts) {
+            auto first = sts.size();
+            auto expanded = faceVaryingSts ? expandFaceVarying(primvars.GetPrimvar(StToken), counts, indices, flip, &sts)
+                                           : expandPrimvar(primvars.GetPrimvar(StToken), vertexCount, &sts);
+            if (!expanded) {
+                sts.resize(first + (faceVaryingSts ? faceVertexCount : vertexCount), pxr::GfVec2f(0.f));
+            }
+        }
+        colors.resize(points.size() - vertexCount, FallbackDisplayColor);
+        if (expandPrimvar(primvars.GetPrimvar(pxr::HdTokens->displayColor), vertexCount, &colors)) {
+            hasColors = true;
+        } else {
+            colors.resize(points.size(), FallbackDisplayColor);
+        }
+        opacities.resize(points.size() - vertexCount, 1.f);
+        if (expandPrimvar(primvars.GetPrimvar(pxr::HdTokens->displayOpacity), vertexCount, &opacities)) {
+            hasOpacities = true;
+        } else {
+            opacities.resize(points.size(), 1.f);
+        }
+    }
+    batch.firstFace.push_back(faceVertexCounts.size());
+    batch.firstIndex.push_back(faceVertexIndices.size());
+
+    batch.points.assign(points.begin(), points.end());
+    batch.faceVertexCounts.assign(faceVertexCounts.begin(), faceVertexCounts.end());
+    batch.faceVertexIndices.assign(faceVertexIndices.begin(), faceVertexIndices.end());
+
+    std::vector<pxr::TfToken> primvarNames = {pxr::HdTokens->points};
+    std::vector<pxr::HdDataSourceBaseHandle> primvarValues = {
+        buildPrimvar(pxr::HdRetainedTypedSampledDataSource<pxr::VtVec3fArray>::New(batch.points),
+                     pxr::HdPrimvarSchemaTokens->vertex, pxr::HdPrimvarSchemaTokens->point)};
+    if (hasColors) {
+        primvarNames.push_back(pxr::HdTokens->displayColor);
+        primvarValues.push_back(buildPrimvar(
+            pxr::HdRetainedTypedSampledDataSource<pxr::VtVec3fArray>::New(pxr::VtVec3fArray(colors.begin(), colors.end())),
+            pxr::HdPrimvarSchemaTokens->vertex, pxr::HdPrimvarSchemaTokens->color));
+    }
+    if (hasNormals) {
+        primvarNames.push_back(pxr::HdTokens->normals);
+        primvarValues.push_back(buildPrimvar(
+            pxr::HdRetainedTypedSampledDataSource<pxr::VtVec3fArray>::New(pxr::VtVec3fArray(normals.begin(), normals.end())),
+            faceVaryingNormals ? pxr::HdPrimvarSchemaTokens->faceVarying : pxr::HdPrimvarSchemaTokens->vertex,
+            pxr::HdPrimvarSchemaTokens->normal));
+    }
+    if (hasSts) {
+        primvarNames.push_back(StToken);
+        primvarValues.push_back(buildPrimvar(
+            pxr::HdRetainedTypedSampledDataSource<pxr::VtVec2fArray>::New(pxr::VtVec2fArray(sts.begin(), sts.end())),
+            faceVaryingSts ? pxr::HdPrimvarSchemaTokens->faceVarying : pxr::HdPrimvarSchemaTokens->vertex,
+            pxr::HdPrimvarSchemaTokens->textureCoordinate));
+    }
+    if (hasOpacities) {
+        primvarNames.push_back(pxr::HdTokens->displayOpacity);
+        primvarValues.push_back(buildPrimvar(
+            pxr::HdRetainedTypedSampledDataSource<pxr::VtFloatArray>::New(pxr::VtFloatArray(opacities.begin(), opacities.end())),
+            pxr::HdPrimvarSchemaTokens->vertex, pxr::TfToken()));
+    }
+
+    auto topology = pxr::HdMeshTopologySchema::Builder()
+                        .SetFaceVertexCounts(pxr::HdRetainedTypedSampledDataSource<pxr::VtIntArray>::New(batch.faceVertexCounts))
+                        .SetFaceVertexIndices(pxr::HdRetainedTypedSampledDataSource<pxr::VtIntArray>::New(batch.faceVertexIndices))
+                        .SetHoleIndices(pxr::HdRetainedTypedSampledDataSource<pxr::VtIntArray>::New(
+                            pxr::VtIntArray(holeIndices.begin(), holeIndices.end())))
+                        .SetOrientation(pxr::HdMeshTopologySchema::BuildOrientationDataSource(
+                            pxr::HdMeshTopologySchemaTokens->rightHanded))
+                        .Build();
+    auto mesh = pxr::HdMeshSchema::Builder()
+                    .SetTopology(topology)
+                    .SetSubdivisionScheme(pxr::HdRetainedTypedSampledDataSource<pxr::TfToken>::New(batch.key.subdivisionScheme))
+                    .SetDoubleSided(pxr::HdRetainedTypedSampledDataSource<bool>::New(batch.key.doubleSided))
+                    .Build();
+    auto xform = pxr::HdXformSchema::Builder()
+                     .SetMatrix(pxr::HdRetainedTypedSampledDataSource<pxr::GfMatrix4d>::New(pxr::GfMatrix4d(1.0)))
+                     .SetResetXformStack(pxr::HdRetainedTypedSampledDataSource<bool>::New(true))
+                     .Build();
+    auto extentSource = pxr::HdExtentSchema::Builder()
+                            .SetMin(pxr::HdRetainedTypedSampledDataSource<pxr::GfVec3d>::New(extent.GetMin()))
+                            .SetMax(pxr::HdRetainedTypedSampledDataSource<pxr::GfVec3d>::New(extent.GetMax()))
+                            .Build();
+
+    std::vector<pxr::TfToken> names = {pxr::HdMeshSchema::GetSchemaToken(), pxr::HdPrimvarsSchema::GetSchemaToken(),
+                                       pxr::HdXformSchema::GetSchemaToken(), pxr::HdExtentSchema::GetSchemaToken(),
+                                       pxr::HdVisibilitySchema::GetSchemaToken()};
+    std::vector<pxr::HdDataSourceBaseHandle> values = {
+        mesh, pxr::HdRetainedContainerDataSource::New(primvarNames.size(), primvarNames.data(), primvarValues.data()),
+        xform, extentSource,
+        pxr::HdVisibilitySchema::Builder().SetVisibility(pxr::HdRetainedTypedSampledDataSource<bool>::New(true)).Build()};
+    if (materialBindings) {
+        names.push_back(pxr::HdMaterialBindingsSchema::GetSchemaToken());
+        values.push_back(materialBindings);
+    }
+    if (purpose) {
+        names.push_back(pxr::HdPurposeSchema::GetSchemaToken());
+        values.push_back(purpose);
+    }
+    if (displayStyle) {
+        names.push_back(pxr::HdLegacyDisplayStyleSchema::GetSchemaToken());
+        values.push_back(displayStyle);
+    }
+    batch.dataSource = pxr::HdRetainedContainerDataSource::New(names.size(), names.data(), values.data());
+    batch.dirty = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MeshMergingSceneIndex::_send(Changes &changes) {
+    if (!changes.removed.empty()) {
+        _SendPrimsRemoved(changes.removed);
+    }
+    if (!changes.added.empty()) {
+        _SendPrimsAdded(changes.added);
+    }
+    if (!changes.dirtied.empty()) {
+        _SendPrimsDirtied(changes.dirtied);
+    }
+}
+
+void MeshMergingSceneIndex::_PrimsAdded(const pxr::HdSceneIndexBase &,
+                                        const pxr::HdSceneIndexObserver::AddedPrimEntries &entries) {
+    Changes changes;
+    pxr::HdSceneIndexObserver::AddedPrimEntries forwarded;
+    forwarded.reserve(entries.size());
+    for (const auto &entry : entries) {
+        auto membership = entry.primType == pxr::HdPrimTypeTokens->mesh ? _membership(entry.primPath) : std::nullopt;
+        if (membership) {
+            _assign(entry.primPath, membership, changes);
+            forwarded.push_back({entry.primPath, pxr::TfToken()});
+        } else {
+            _unassign(entry.primPath, changes);
+            forwarded.push_back(entry);
+        }
+    }
+    // The model roots are added before the batches under them.
+    _SendPrimsAdded(forwarded);
+    _send(changes);
+}
+
+void MeshMergingSceneIndex::_PrimsRemoved(const pxr::HdSceneIndexBase &,
+                                          const pxr::HdSceneIndexObserver::RemovedPrimEntries &entries) {
+    Changes changes;
+    for (const auto &entry : entries) {
+        std::vector<pxr::SdfPath> removed;
+        for (auto it = _sourceBatches.lower_bound(entry.primPath);
+             it != _sourceBatches.end() && it->first.HasPrefix(entry.primPath); ++it) {
+            removed.push_back(it->first);
+        }
+        for (const auto &path : removed) {
+            _unassign(path, changes);
+        }
+    }
+    _SendPrimsRemoved(entries);
+    _send(changes);
+}
+
+void MeshMergingSceneIndex::_PrimsDirtied(const pxr::HdSceneIndexBase &,
+                                          const pxr::HdSceneIndexObserver::DirtiedPrimEntries &entries) {
+    // Only merged meshes are looked at again; a mesh that stops being animated
+    // is picked up when it is next resynced, which keeps playback cheap.
+    Changes changes;
+    pxr::HdSceneIndexObserver::DirtiedPrimEntries forwarded;
+    forwarded.reserve(entries.size());
+    for (const auto &entry : entries) {
+        if (_sourceBatches.count(entry.primPath)) {
+            if (entry.dirtyLocators.Intersects(mergedLocators())) {
+                _assign(entry.primPath, _membership(entry.primPath), changes, entry.dirtyLocators);
+            }
+        } else {
+            forwarded.push_back(entry);
+        }
+    }
+    if (!forwarded.empty()) {
+        _SendPrimsDirtied(forwarded);
+    }
+    _send(changes);
+}
+}// namespace vox
@@ -0,0 +1,145 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/usd/sdf/path.h>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace vox {
+class MeshMergingSceneIndex;
+using MeshMergingSceneIndexRefPtr = pxr::TfRefPtr<MeshMergingSceneIndex>;
+
+/// Scene index filter drawing the static meshes of a model as a few merged
+/// meshes, for sets made of many small props where per-rprim sync and draw
+/// overhead dominates. Meshes are merged when they share their material,
+/// purpose, subdivision scheme, refine level, sidedness and whether they have
+/// normals and st, and have nothing time-varying or that merging would lose:
+/// instancing, geometry subsets, primvars other than points, normals, st,
+/// displayColor and displayOpacity. Points and normals are baked to world
+/// space. The merged meshes are children of the model root, carry the display
+/// style of their first mesh, and the meshes they replace stay in the scene
+/// without a type.
+///
+/// Edits to what a merged mesh contributes only rebuild its batch, on the next
+/// sync, and dirty only the batch data they change. Batches remember which
+/// faces came from which mesh, to map picks back to it.
+class MeshMergingSceneIndex : public pxr::HdSingleInputFilteringSceneIndexBase {
+public:
+    /// Meshes are merged under the closest of `batchRoots` above them, or under their top-level prim.
+    static MeshMergingSceneIndexRefPtr New(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                           std::set<pxr::SdfPath> batchRoots);
+
+    pxr::HdSceneIndexPrim GetPrim(const pxr::SdfPath &primPath) const override;
+
+    pxr::SdfPathVector GetChildPrimPaths(const pxr::SdfPath &primPath) const override;
+
+    /// True if `primPath` is a merged mesh.
+    [[nodiscard]] bool isMerged(const pxr::SdfPath &primPath) const;
+
+    /// The mesh of the merged mesh `primPath` that is closest to `point`, in world space.
+    [[nodiscard]] pxr::SdfPath sourcePrim(const pxr::SdfPath &primPath, const pxr::GfVec3d &point) const;
+
+    /// Every mesh merged into `primPath`, with its world bounds.
+    [[nodiscard]] std::vector<std::pair<pxr::SdfPath, pxr::GfRange3d>> sourcePrims(const pxr::SdfPath &primPath) const;
+
+    /// Meshes merged, and the batches they are drawn as.
+    [[nodiscard]] size_t mergedMeshCount() const;
+    [[nodiscard]] size_t batchCount() const;
+
+protected:
+    MeshMergingSceneIndex(const pxr::HdSceneIndexBaseRefPtr &inputScene, std::set<pxr::SdfPath> batchRoots);
+
+    void _PrimsAdded(const pxr::HdSceneIndexBase &sender,
+                     const pxr::HdSceneIndexObserver::AddedPrimEntries &entries) override;
+
+    void _PrimsRemoved(const pxr::HdSceneIndexBase &sender,
+                       const pxr::HdSceneIndexObserver::RemovedPrimEntries &entries) override;
+
+    void _PrimsDirtied(const pxr::HdSceneIndexBase &sender,
+                       const pxr::HdSceneIndexObserver::DirtiedPrimEntries &entries) override;
+
+private:
+    /// What meshes must share to be merged.
+    struct Key {
+        pxr::SdfPath root;
+        pxr::SdfPath material;
+        pxr::TfToken purpose;
+        pxr::TfToken subdivisionScheme;
+        int refineLevel{0};
+        bool doubleSided{false};
+        /// The optional primvars every mesh of the batch has: normals, st.
+        std::vector<pxr::TfToken> primvars;
+
+        bool operator==(const Key &other) const;
+    };
+
+    struct Batch {
+        pxr::SdfPath path;
+        Key key;
+        std::vector<pxr::SdfPath> sources;
+        /// Sum of the vertex counts of the sources, as they were last assigned.
+        size_t vertexCount{0};
+        /// Rebuilt on the next GetPrim.
+        bool dirty{true};
+        pxr::HdContainerDataSourceHandle dataSource;
+        // Merged geometry, kept to map picks back to sources.
+        pxr::VtVec3fArray points;
+        pxr::VtIntArray faceVertexCounts;
+        pxr::VtIntArray faceVertexIndices;
+        /// First face and face-vertex index of each source, and its world bounds.
+        std::vector<size_t> firstFace;
+        std::vector<size_t> firstIndex;
+        std::vector<pxr::GfRange3d> bounds;
+    };
+
+    struct Membership {
+        Key key;
+        size_t vertexCount{0};
+    };
+
+    struct Changes {
+        pxr::HdSceneIndexObserver::AddedPrimEntries added;
+        pxr::HdSceneIndexObserver::RemovedPrimEntries removed;
+        pxr::HdSceneIndexObserver::DirtiedPrimEntries dirtied;
+    };
+
+    /// Key and vertex count of `primPath` if it can be merged.
+    std::optional<Membership> _membership(const pxr::SdfPath &primPath) const;
+    pxr::SdfPath _batchRoot(const pxr::SdfPath &primPath) const;
+    /// Puts `primPath` in a batch matching `membership`, or takes it out of its batch when none.
+    /// If it stays in its batch, `dirtyLocators` of it are what the batch is dirtied for.
+    void _assign(const pxr::SdfPath &primPath, const std::optional<Membership> &membership, Changes &changes,
+                 const pxr::HdDataSourceLocatorSet &dirtyLocators = pxr::HdDataSourceLocatorSet::UniversalSet());
+    void _unassign(const pxr::SdfPath &primPath, Changes &changes);
+    /// Sums the vertex counts of the sources of `batch` again.
+    void _countVertices(Batch &batch) const;
+    void _rebuild(Batch &batch) const;
+    const Batch *_built(const pxr::SdfPath &primPath) const;
+    void _send(Changes &changes);
+
+    std::set<pxr::SdfPath> _batchRoots;
+    /// Guards the batches, which are rebuilt by GetPrim on sync threads.
+    mutable std::mutex _mutex;
+    mutable std::vector<Batch> _batches;
+    std::unordered_map<pxr::SdfPath, size_t, pxr::SdfPath::Hash> _batchIndices;
+    /// Batch of each merged mesh, ordered so subtrees can be found.
+    std::map<pxr::SdfPath, size_t> _sourceBatches;
+    /// Vertices of each merged mesh when it was assigned.
+    std::unordered_map<pxr::SdfPath, size_t, pxr::SdfPath::Hash> _sourceVertexCounts;
+    std::unordered_map<pxr::SdfPath, std::vector<size_t>, pxr::SdfPath::Hash> _rootBatches;
+    std::unordered_map<pxr::SdfPath, size_t, pxr::SdfPath::Hash> _rootNameCounters;
+};
+}// namespace vox
@@ -0,0 +1,756 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "pick_index.h"
+
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/plane.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/pointInstancer.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace vox {
+namespace {
+constexpr uint32_t LeafSize = 4;
+
+bool intersectBounds(const pxr::GfVec3f &boundsMin, const pxr::GfVec3f &boundsMax,
+                     const pxr::GfVec3f &origin, const pxr::GfVec3f &invDir, float tMax) {
+    float tNear = 0.f;
+    float tFar = tMax;
+    for (int axis = 0; axis < 3; ++axis) {
+        auto t0 = (boundsMin[axis] - origin[axis]) * invDir[axis];
+        auto t1 = (boundsMax[axis] - origin[axis]) * invDir[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        tNear = t0 > tNear ? t0 : tNear;
+        tFar = t1 < tFar ? t1 : tFar;
+        if (tNear > tFar) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Moller-Trumbore, returns the ray parameter of the hit or a negative value.
+float intersectTriangle(const pxr::GfVec3f &origin, const pxr::GfVec3f &dir,
+                        const pxr::GfVec3f &v0, const pxr::GfVec3f &v1, const pxr::GfVec3f &v2) {
+    auto e1 = v1 - v0;
+    auto e2 = v2 - v0;
+    auto p = pxr::GfCross(dir, e2);
+    auto det = pxr::GfDot(e1, p);
+    if (std::abs(det) < 1e-12f) {
+        return -1.f;
+    }
+    auto invDet = 1.f / det;
+    auto s = origin - v0;
+    auto u = pxr::GfDot(s, p) * invDet;
+    if (u < 0.f || u > 1.f) {
+        return -1.f;
+    }
+    auto q = pxr::GfCross(s, e1);
+    auto v = pxr::GfDot(dir, q) * invDet;
+    if (v < 0.f || u + v > 1.f) {
+        return -1.f;
+    }
+    return pxr::GfDot(e2, q) * invDet;
+}
+
+/// Plane equations (n, -d), positive inside the frustum.
+using FrustumPlanes = std::array<pxr::GfVec4d, 6>;
+
+FrustumPlanes frustumPlanes(const pxr::GfFrustum &frustum) {
+    // Corners are left/right bottom/top near, then the same at far.
+    auto corners = frustum.ComputeCorners();
+    pxr::GfVec3d centroid(0.0);
+    for (const auto &corner : corners) {
+        centroid += corner / 8.0;
+    }
+    std::array<pxr::GfPlane, 6> planes = {
+        pxr::GfPlane(corners[0], corners[1], corners[2]), pxr::GfPlane(corners[4], corners[6], corners[5]),
+        pxr::GfPlane(corners[0], corners[2], corners[4]), pxr::GfPlane(corners[1], corners[5], corners[3]),
+        pxr::GfPlane(corners[0], corners[4], corners[1]), pxr::GfPlane(corners[2], corners[3], corners[6])};
+    FrustumPlanes result;
+    for (size_t i = 0; i < planes.size(); ++i) {
+        planes[i].Reorient(centroid);
+        result[i] = planes[i].GetEquation();
+    }
+    return result;
+}
+
+/// Planes in the space that `toWorld` maps to world space.
+FrustumPlanes transformPlanes(const FrustumPlanes &planes, const pxr::GfMatrix4d &toWorld) {
+    FrustumPlanes result;
+    for (size_t i = 0; i < planes.size(); ++i) {
+        result[i] = toWorld * planes[i];
+    }
+    return result;
+}
+
+enum class Containment {
+    Outside,
+    Intersecting,
+    Inside,
+};
+
+Containment classify(const FrustumPlanes &planes, const pxr::GfVec3f &boundsMin, const pxr::GfVec3f &boundsMax) {
+    auto center = pxr::GfVec3d(boundsMin + boundsMax) * 0.5;
+    auto extent = pxr::GfVec3d(boundsMax - boundsMin) * 0.5;
+    auto result = Containment::Inside;
+    for (const auto &plane : planes) {
+        auto distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+        auto radius = std::abs(plane[0]) * extent[0] + std::abs(plane[1]) * extent[1] + std::abs(plane[2]) * extent[2];
+        if (distance + radius < 0.0) {
+            return Containment::Outside;
+        }
+        if (distance - radius < 0.0) {
+            result = Containment::Intersecting;
+        }
+    }
+    return result;
+}
+
+bool isInside(const FrustumPlanes &planes, const pxr::GfVec3d &point) {
+    return std::all_of(planes.begin(), planes.end(), [&](const pxr::GfVec4d &plane) {
+        return plane[0] * point[0] + plane[1] * point[1] + plane[2] * point[2] + plane[3] >= 0.0;
+    });
+}
+
+pxr::GfVec3f inverse(const pxr::GfVec3f &dir) {
+    return {1.f / dir[0], 1.f / dir[1], 1.f / dir[2]};
+}
+
+template<typename Cache>
+bool transformMightBeTimeVarying(const pxr::UsdPrim &prim, Cache &cache) {
+    if (!prim || prim.IsPseudoRoot()) {
+        return false;
+    }
+    auto iter = cache.find(prim.GetPath());
+    if (iter != cache.end()) {
+        return iter->second;
+    }
+    pxr::UsdGeomXformable xformable(prim);
+    auto varying = (xformable && xformable.TransformMightBeTimeVarying()) ||
+                   transformMightBeTimeVarying(prim.GetParent(), cache);
+    cache.emplace(prim.GetPath(), varying);
+    return varying;
+}
+
+const pxr::TfTokenVector &instancerAttributeNames() {
+    static const pxr::TfTokenVector names = {
+        pxr::UsdGeomTokens->positions, pxr::UsdGeomTokens->orientations, pxr::UsdGeomTokens->scales,
+        pxr::UsdGeomTokens->protoIndices, pxr::UsdGeomTokens->invisibleIds, pxr::UsdGeomTokens->prototypes};
+    return names;
+}
+}// namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+void PickIndex::Bounds::extend(const pxr::GfVec3f &p) {
+    for (int axis = 0; axis < 3; ++axis) {
+        min[axis] = std::min(min[axis], p[axis]);
+        max[axis] = std::max(max[axis], p[axis]);
+    }
+}
+
+void PickIndex::Bounds::extend(const Bounds &b) {
+    for (int axis = 0; axis < 3; ++axis) {
+        min[axis] = std::min(min[axis], b.min[axis]);
+        max[axis] = std::max(max[axis], b.max[axis]);
+    }
+}
+
+void PickIndex::Bvh::build(const std::vector<Bounds> &itemBounds) {
+    nodes.clear();
+    order.resize(itemBounds.size());
+    std::iota(order.begin(), order.end(), 0u);
+    if (itemBounds.empty()) {
+        return;
+    }
+    nodes.reserve(2 * itemBounds.size() / LeafSize + 1);
+    nodes.push_back({{}, 0, uint32_t(itemBounds.size())});
+
+    // Children are always appended after their parent, refit relies on it.
+    std::vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+        auto index = stack.back();
+        stack.pop_back();
+        auto first = nodes[index].first;
+        auto count = nodes[index].count;
+
+        Bounds bounds;
+        Bounds centroids;
+        for (auto i = first; i < first + count; ++i) {
+            bounds.extend(itemBounds[order[i]]);
+            centroids.extend(itemBounds[order[i]].center());
+        }
+        nodes[index].bounds = bounds;
+        if (count <= LeafSize) {
+            continue;
+        }
+
+        auto extent = centroids.max - centroids.min;
+        int axis = extent[0] > extent[1] ? (extent[0] > extent[2] ? 0 : 2) : (extent[1] > extent[2] ? 1 : 2);
+        if (extent[axis] <= 0.f) {
+            continue;
+        }
+
+        // Split at the centroid midpoint, falling back to the median when that leaves a side empty.
+        auto begin = order.begin() + first;
+        auto end = begin + count;
+        auto split = centroids.center()[axis];
+        auto mid = std::partition(begin, end, [&](uint32_t item) {
+            return itemBounds[item].center()[axis] < split;
+        });
+        if (mid == begin || mid == end) {
+            mid = begin + count / 2;
+            std::nth_element(begin, mid, end, [&](uint32_t a, uint32_t b) {
+                return itemBounds[a].center()[axis] < itemBounds[b].center()[axis];
+            });
+        }
+
+        auto leftCount = uint32_t(mid - begin);
+        auto left = uint32_t(nodes.size());
+        nodes.push_back({{}, first, leftCount});
+        nodes.push_back({{}, first + leftCount, count - leftCount});
+        nodes[index].first = left;
+        nodes[index].count = 0;
+        stack.push_back(left);
+        stack.push_back(left + 1);
+    }
+}
+
+void PickIndex::Bvh::refit(const std::vector<Bounds> &itemBounds) {
+    for (auto i = nodes.size(); i-- > 0;) {
+        auto &node = nodes[i];
+        Bounds bounds;
+        if (node.count > 0) {
+            for (auto j = node.first; j < node.first + node.count; ++j) {
+                bounds.extend(itemBounds[order[j]]);
+            }
+        } else {
+            bounds = nodes[node.first].bounds;
+            bounds.extend(nodes[node.first + 1].bounds);
+        }
+        node.bounds = bounds;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+PickIndex::PickIndex()
+    : _purposes{pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->proxy} {
+}
+
+PickIndex::~PickIndex() {
+    if (_noticeKey) {
+        pxr::TfNotice::Revoke(_noticeKey.value());
+    }
+}
+
+void PickIndex::setStage(const pxr::UsdStageRefPtr &stage) {
+    if (_noticeKey) {
+        pxr::TfNotice::Revoke(_noticeKey.value());
+        _noticeKey = std::nullopt;
+    }
+    _stage = stage;
+    _meshes.clear();
+    _instances.clear();
+    _instanceBounds.clear();
+    _topLevel = {};
+    _dirtyXformPaths.clear();
+    _structureDirty = true;
+    if (_stage) {
+        _noticeKey = pxr::TfNotice::Register(pxr::TfCreateWeakPtr(this), &PickIndex::_onObjectsChanged, _stage);
+    }
+}
+
+void PickIndex::setTime(pxr::UsdTimeCode time) {
+    if (time != _time) {
+        _time = time;
+        _timeChanged = true;
+    }
+}
+
+void PickIndex::setIncludedPurposes(const pxr::TfTokenVector &purposes) {
+    if (purposes != _purposes) {
+        _purposes = purposes;
+        _structureDirty = true;
+    }
+}
+
+size_t PickIndex::triangleCount() const {
+    size_t count = 0;
+    for (const auto &[path, mesh] : _meshes) {
+        count += mesh.triangles.size();
+    }
+    return count;
+}
+
+bool PickIndex::_isPruned(const pxr::UsdPrim &prim) const {
+    pxr::UsdGeomImageable imageable(prim);
+    if (!imageable) {
+        return false;
+    }
+    pxr::TfToken visibility;
+    if (imageable.GetVisibilityAttr().Get(&visibility, _time) && visibility == pxr::UsdGeomTokens->invisible) {
+        return true;
+    }
+    pxr::TfToken purpose;
+    return imageable.GetPurposeAttr().Get(&purpose) && purpose != pxr::UsdGeomTokens->default_ &&
+           std::find(_purposes.begin(), _purposes.end(), purpose) == _purposes.end();
+}
+
+void PickIndex::_rebuildInstances() {
+    _instances.clear();
+    _instancerPaths.clear();
+    _hasUnsupportedGprims = false;
+    _hasTimeVaryingInstancers = false;
+
+    TimeVaryingCache timeVaryingCache;
+    auto range = pxr::UsdPrimRange(_stage->GetPseudoRoot(), pxr::UsdTraverseInstanceProxies());
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        const auto &prim = *it;
+        if (_isPruned(prim)) {
+            it.PruneChildren();
+            continue;
+        }
+        if (prim.IsA<pxr::UsdGeomPointInstancer>()) {
+            _addPointInstancer(prim, timeVaryingCache);
+            // Prototypes are only drawn through the instancer.
+            it.PruneChildren();
+        } else if (prim.IsA<pxr::UsdGeomMesh>()) {
+            _addMesh(prim, {}, -1, prim.GetPath(), pxr::GfMatrix4d(1.0),
+                     transformMightBeTimeVarying(prim, timeVaryingCache));
+        } else if (prim.IsA<pxr::UsdGeomGprim>()) {
+            _hasUnsupportedGprims = true;
+        }
+    }
+
+    // Drop the triangles of meshes that are no longer drawn.
+    std::unordered_map<pxr::SdfPath, bool, pxr::SdfPath::Hash> used;
+    for (const auto &instance : _instances) {
+        used[instance.meshKey] = true;
+    }
+    for (auto it = _meshes.begin(); it != _meshes.end();) {
+        it = used.count(it->first) ? std::next(it) : _meshes.erase(it);
+    }
+    _structureDirty = false;
+}
+
+void PickIndex::_addPointInstancer(const pxr::UsdPrim &prim, TimeVaryingCache &timeVaryingCache) {
+    pxr::UsdGeomPointInstancer instancer(prim);
+    pxr::VtArray<pxr::GfMatrix4d> xforms;
+    // Keep masked instances in the array so that indices match protoIndices.
+    if (!instancer.ComputeInstanceTransformsAtTime(&xforms, _time, _time,
+                                                   pxr::UsdGeomPointInstancer::IncludeProtoXform,
+                                                   pxr::UsdGeomPointInstancer::IgnoreMask)) {
+        return;
+    }
+    pxr::VtIntArray protoIndices;
+    instancer.GetProtoIndicesAttr().Get(&protoIndices, _time);
+    pxr::SdfPathVector prototypes;
+    instancer.GetPrototypesRel().GetForwardedTargets(&prototypes);
+    auto mask = instancer.ComputeMaskAtTime(_time);
+
+    _instancerPaths.push_back(prim.GetPath());
+    for (const auto &name : instancerAttributeNames()) {
+        if (auto attr = prim.GetAttribute(name); attr && attr.ValueMightBeTimeVarying()) {
+            _hasTimeVaryingInstancers = true;
+        }
+    }
+
+    // Meshes of each prototype, relative to the prototype root.
+    pxr::UsdGeomXformCache xformCache(_time);
+    std::vector<std::vector<std::pair<pxr::UsdPrim, pxr::GfMatrix4d>>> prototypeMeshes(prototypes.size());
+    for (size_t i = 0; i < prototypes.size(); ++i) {
+        auto prototype = _stage->GetPrimAtPath(prototypes[i]);
+        if (!prototype) {
+            continue;
+        }
+        auto range = pxr::UsdPrimRange(prototype, pxr::UsdTraverseInstanceProxies());
+        for (auto it = range.begin(); it != range.end(); ++it) {
+            if (_isPruned(*it)) {
+                it.PruneChildren();
+            } else if (it->IsA<pxr::UsdGeomMesh>()) {
+                bool resetsXformStack = false;
+                prototypeMeshes[i].emplace_back(*it, xformCache.ComputeRelativeTransform(*it, prototype, &resetsXformStack));
+            } else if (it->IsA<pxr::UsdGeomGprim>()) {
+                _hasUnsupportedGprims = true;
+            }
+        }
+    }
+
+    auto timeVarying = transformMightBeTimeVarying(prim, timeVaryingCache);
+    for (size_t i = 0; i < xforms.size() && i < protoIndices.size(); ++i) {
+        auto protoIndex = protoIndices[i];
+        if ((!mask.empty() && !mask[i]) || protoIndex < 0 || size_t(protoIndex) >= prototypeMeshes.size()) {
+            continue;
+        }
+        for (const auto &[mesh, relative] : prototypeMeshes[protoIndex]) {
+            _addMesh(mesh, prim.GetPath(), int(i), prim.GetPath(), relative * xforms[i], timeVarying);
+        }
+    }
+}
+
+void PickIndex::_addMesh(const pxr::UsdPrim &prim, const pxr::SdfPath &instancerPath, int instanceIndex,
+                         const pxr::SdfPath &xformPrim, const pxr::GfMatrix4d &localXform, bool timeVarying) {
+    // Instance proxies share the triangles of their prototype.
+    auto key = prim.IsInstanceProxy() ? prim.GetPrimInPrototype().GetPath() : prim.GetPath();
+    auto &mesh = _meshes[key];
+
+    Instance instance;
+    instance.mesh = &mesh;
+    instance.meshKey = key;
+    instance.primPath = prim.GetPath();
+    instance.instancerPath = instancerPath;
+    instance.instanceIndex = instanceIndex;
+    instance.xformPrim = xformPrim;
+    instance.localXform = localXform;
+    instance.timeVarying = timeVarying;
+    _instances.push_back(std::move(instance));
+}
+
+bool PickIndex::_buildDirtyMeshes() {
+    std::vector<std::pair<pxr::UsdPrim, Mesh *>> dirty;
+    for (auto &[key, mesh] : _meshes) {
+        mesh.rebuilt = false;
+        if (mesh.dirty) {
+            dirty.emplace_back(_stage->GetPrimAtPath(key), &mesh);
+        }
+    }
+    if (dirty.empty()) {
+        return false;
+    }
+
+    auto time = _time;
+    pxr::WorkParallelForN(dirty.size(), [&dirty, time](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            auto &mesh = *dirty[i].second;
+            pxr::UsdGeomMesh usdMesh(dirty[i].first);
+            pxr::VtVec3fArray points;
+            pxr::VtIntArray counts;
+            pxr::VtIntArray indices;
+            auto pointsAttr = usdMesh.GetPointsAttr();
+            pointsAttr.Get(&points, time);
+            usdMesh.GetFaceVertexCountsAttr().Get(&counts, time);
+            usdMesh.GetFaceVertexIndicesAttr().Get(&indices, time);
+            mesh.timeVarying = pointsAttr.ValueMightBeTimeVarying();
+
+            mesh.points.assign(points.begin(), points.end());
+            mesh.triangles.clear();
+            size_t start = 0;
+            for (auto count : counts) {
+                // Fan triangulation, faces referencing missing points are skipped.
+                auto valid = count >= 3 && start + count <= indices.size();
+                for (auto k = 0; valid && k < count; ++k) {
+                    valid = indices[start + k] >= 0 && size_t(indices[start + k]) < points.size();
+                }
+                for (auto k = 1; valid && k + 1 < count; ++k) {
+                    mesh.triangles.emplace_back(indices[start], indices[start + k], indices[start + k + 1]);
+                }
+                start += std::max(count, 0);
+            }
+
+            std::vector<Bounds> triangleBounds(mesh.triangles.size());
+            for (size_t t = 0; t < mesh.triangles.size(); ++t) {
+                for (int corner = 0; corner < 3; ++corner) {
+                    triangleBounds[t].extend(mesh.points[mesh.triangles[t][corner]]);
+                }
+            }
+            mesh.bvh.build(triangleBounds);
+            mesh.dirty = false;
+            mesh.rebuilt = true;
+        }
+    });
+    return true;
+}
+
+bool PickIndex::_updateTransforms(bool all) {
+    _instanceBounds.resize(_instances.size());
+    pxr::UsdGeomXformCache xformCache(_time);
+    bool changed = false;
+    for (size_t i = 0; i < _instances.size(); ++i) {
+        auto &instance = _instances[i];
+        auto update = all || instance.mesh->rebuilt || (_timeChanged && instance.timeVarying);
+        for (size_t p = 0; !update && p < _dirtyXformPaths.size(); ++p) {
+            update = instance.xformPrim.HasPrefix(_dirtyXformPaths[p]);
+        }
+        if (!update) {
+            continue;
+        }
+        changed = true;
+
+        auto prim = _stage->GetPrimAtPath(instance.xformPrim);
+        instance.toWorld = instance.localXform * xformCache.GetLocalToWorldTransform(prim);
+        instance.toLocal = instance.toWorld.GetInverse();
+
+        Bounds worldBounds;
+        if (!instance.mesh->bvh.nodes.empty()) {
+            const auto &local = instance.mesh->bvh.nodes.front().bounds;
+            for (int corner = 0; corner < 8; ++corner) {
+                pxr::GfVec3d p(corner & 1 ? local.max[0] : local.min[0],
+                               corner & 2 ? local.max[1] : local.min[1],
+                               corner & 4 ? local.max[2] : local.min[2]);
+                worldBounds.extend(pxr::GfVec3f(instance.toWorld.Transform(p)));
+            }
+        }
+        _instanceBounds[i] = worldBounds;
+    }
+    _dirtyXformPaths.clear();
+    return changed;
+}
+
+void PickIndex::update() {
+    if (!_stage) {
+        return;
+    }
+    if (_timeChanged) {
+        if (_hasTimeVaryingInstancers) {
+            _structureDirty = true;
+        }
+        for (auto &[key, mesh] : _meshes) {
+            mesh.dirty |= mesh.timeVarying;
+        }
+    }
+
+    auto rebuildTopLevel = _structureDirty;
+    if (_structureDirty) {
+        _rebuildInstances();
+    }
+    _buildDirtyMeshes();
+    auto transformsChanged = _updateTransforms(rebuildTopLevel);
+    _timeChanged = false;
+
+    if (rebuildTopLevel) {
+        _topLevel.build(_instanceBounds);
+    } else if (transformsChanged) {
+        _topLevel.refit(_instanceBounds);
+    }
+}
+
+std::optional<PickIndex::Hit> PickIndex::intersect(const pxr::GfRay &ray, double minDistance, double maxDistance) {
+    update();
+    if (_topLevel.nodes.empty()) {
+        return std::nullopt;
+    }
+
+    // With a unit direction, ray parameters are world distances in every instance.
+    auto origin = ray.GetStartPoint();
+    auto dir = ray.GetDirection().GetNormalized();
+    auto originF = pxr::GfVec3f(origin);
+    auto invDirF = inverse(pxr::GfVec3f(dir));
+
+    auto closest = float(std::min(maxDistance, double(std::numeric_limits<float>::max())));
+    const Instance *hitInstance = nullptr;
+    uint32_t hitTriangle = 0;
+
+    std::vector<uint32_t> stack{0};
+    std::vector<uint32_t> meshStack;
+    while (!stack.empty()) {
+        const auto &node = _topLevel.nodes[stack.back()];
+        stack.pop_back();
+        if (!intersectBounds(node.bounds.min, node.bounds.max, originF, invDirF, closest)) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+
+        for (auto i = node.first; i < node.first + node.count; ++i) {
+            const auto &instance = _instances[_topLevel.order[i]];
+            const auto &mesh = *instance.mesh;
+            if (mesh.bvh.nodes.empty()) {
+                continue;
+            }
+            auto localOrigin = pxr::GfVec3f(instance.toLocal.Transform(origin));
+            auto localDir = pxr::GfVec3f(instance.toLocal.TransformDir(dir));
+            auto localInvDir = inverse(localDir);
+
+            meshStack.assign(1, 0);
+            while (!meshStack.empty()) {
+                const auto &meshNode = mesh.bvh.nodes[meshStack.back()];
+                meshStack.pop_back();
+                if (!intersectBounds(meshNode.bounds.min, meshNode.bounds.max, localOrigin, localInvDir, closest)) {
+                    continue;
+                }
+                if (meshNode.count == 0) {
+                    meshStack.push_back(meshNode.first);
+                    meshStack.push_back(meshNode.first + 1);
+                    continue;
+                }
+                for (auto j = meshNode.first; j < meshNode.first + meshNode.count; ++j) {
+                    auto triangle = mesh.bvh.order[j];
+                    const auto &indices = mesh.triangles[triangle];
+                    auto t = intersectTriangle(localOrigin, localDir, mesh.points[indices[0]],
+                                               mesh.points[indices[1]], mesh.points[indices[2]]);
+                    if (t >= float(minDistance) && t < closest) {
+                        closest = t;
+                        hitInstance = &instance;
+                        hitTriangle = triangle;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!hitInstance) {
+        return std::nullopt;
+    }
+
+    const auto &mesh = *hitInstance->mesh;
+    const auto &indices = mesh.triangles[hitTriangle];
+    auto localNormal = pxr::GfCross(mesh.points[indices[1]] - mesh.points[indices[0]],
+                                    mesh.points[indices[2]] - mesh.points[indices[0]]);
+    // Normals transform with the inverse transpose.
+    auto normal = hitInstance->toLocal.GetTranspose().TransformDir(pxr::GfVec3d(localNormal)).GetNormalized();
+    if (pxr::GfDot(normal, dir) > 0.0) {
+        normal = -normal;
+    }
+
+    Hit hit;
+    hit.distance = closest;
+    hit.point = origin + dir * double(closest);
+    hit.normal = normal;
+    hit.primPath = hitInstance->primPath;
+    hit.instancerPath = hitInstance->instancerPath;
+    hit.instanceIndex = hitInstance->instanceIndex;
+    return hit;
+}
+
+std::vector<PickIndex::Hit> PickIndex::select(const pxr::GfFrustum &frustum, const RegionTest &contains) {
+    update();
+    std::vector<Hit> hits;
+    if (_topLevel.nodes.empty()) {
+        return hits;
+    }
+
+    auto planes = frustumPlanes(frustum);
+    auto viewProjection = frustum.ComputeViewMatrix() * frustum.ComputeProjectionMatrix();
+
+    // Whether the mesh of `instance` has a triangle in the frustum, and in the
+    // region if given. Without a region a triangle counts when its bounds do.
+    auto meshSelected = [&](const Instance &instance) {
+        const auto &mesh = *instance.mesh;
+        if (mesh.bvh.nodes.empty()) {
+            return false;
+        }
+        auto localPlanes = transformPlanes(planes, instance.toWorld);
+        auto vertexSelected = [&](const pxr::GfVec3f &point) {
+            auto world = instance.toWorld.Transform(pxr::GfVec3d(point));
+            if (!isInside(planes, world)) {
+                return false;
+            }
+            auto ndc = viewProjection.Transform(world);
+            return contains(pxr::GfVec2d(ndc[0], ndc[1]));
+        };
+
+        std::vector<uint32_t> stack{0};
+        while (!stack.empty()) {
+            const auto &node = mesh.bvh.nodes[stack.back()];
+            stack.pop_back();
+            auto containment = classify(localPlanes, node.bounds.min, node.bounds.max);
+            if (containment == Containment::Outside) {
+                continue;
+            }
+            if (!contains && containment == Containment::Inside) {
+                return true;
+            }
+            if (node.count == 0) {
+                stack.push_back(node.first);
+                stack.push_back(node.first + 1);
+                continue;
+            }
+            for (auto j = node.first; j < node.first + node.count; ++j) {
+                const auto &indices = mesh.triangles[mesh.bvh.order[j]];
+                if (!contains) {
+                    Bounds bounds;
+                    for (int k = 0; k < 3; ++k) {
+                        bounds.extend(mesh.points[indices[k]]);
+                    }
+                    if (classify(localPlanes, bounds.min, bounds.max) != Containment::Outside) {
+                        return true;
+                    }
+                } else if (vertexSelected(mesh.points[indices[0]]) || vertexSelected(mesh.points[indices[1]]) ||
+                           vertexSelected(mesh.points[indices[2]])) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    std::vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+        const auto &node = _topLevel.nodes[stack.back()];
+        stack.pop_back();
+        if (classify(planes, node.bounds.min, node.bounds.max) == Containment::Outside) {
+            continue;
+        }
+        if (node.count == 0) {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+        for (auto i = node.first; i < node.first + node.count; ++i) {
+            auto index = _topLevel.order[i];
+            const auto &bounds = _instanceBounds[index];
+            auto containment = classify(planes, bounds.min, bounds.max);
+            if (containment == Containment::Outside) {
+                continue;
+            }
+            const auto &instance = _instances[index];
+            if ((containment == Containment::Inside && !contains) || meshSelected(instance)) {
+                hits.push_back({0.0, {}, {}, instance.primPath, instance.instancerPath, instance.instanceIndex});
+            }
+        }
+    }
+    return hits;
+}
+
+void PickIndex::_onObjectsChanged(const pxr::UsdNotice::ObjectsChanged &notice, const pxr::UsdStageWeakPtr &sender) {
+    for (const auto &path : notice.GetResyncedPaths()) {
+        _structureDirty = true;
+        auto primPath = path.GetPrimPath();
+        for (auto &[key, mesh] : _meshes) {
+            if (key.HasPrefix(primPath)) {
+                mesh.dirty = true;
+            }
+        }
+    }
+
+    const auto &instancerNames = instancerAttributeNames();
+    for (const auto &path : notice.GetChangedInfoOnlyPaths()) {
+        if (!path.IsPropertyPath()) {
+            continue;
+        }
+        const auto &name = path.GetNameToken();
+        auto primPath = path.GetPrimPath();
+        if (pxr::UsdGeomXformable::IsTransformationAffectedByAttrNamed(name)) {
+            // Moving a prim inside an instancer prototype changes the instancer's instances.
+            for (const auto &instancerPath : _instancerPaths) {
+                if (primPath != instancerPath && primPath.HasPrefix(instancerPath)) {
+                    _structureDirty = true;
+                }
+            }
+            _dirtyXformPaths.push_back(primPath);
+        } else if (name == pxr::UsdGeomTokens->points || name == pxr::UsdGeomTokens->faceVertexCounts ||
+                   name == pxr::UsdGeomTokens->faceVertexIndices) {
+            if (auto iter = _meshes.find(primPath); iter != _meshes.end()) {
+                iter->second.dirty = true;
+            }
+        } else if (name == pxr::UsdGeomTokens->visibility || name == pxr::UsdGeomTokens->purpose ||
+                   std::find(instancerNames.begin(), instancerNames.end(), name) != instancerNames.end()) {
+            _structureDirty = true;
+        }
+    }
+}
+}// namespace vox
@@ -0,0 +1,158 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec2d.h>
+#include <pxr/base/gf/ray.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/gf/vec3i.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/stage.h>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace vox {
+/// CPU ray picking against the meshes of a stage, without rendering.
+///
+/// Every mesh gets a bounding volume hierarchy over its triangles in local
+/// space, shared by all native and point instancer instances of it. A second
+/// hierarchy over the world bounds of all instances is refit in place when
+/// transforms change, so moving prims never rebuilds the triangle hierarchies.
+/// Stage edits are tracked through change notices and applied lazily on the
+/// next query. Not thread safe; use from the thread that edits the stage.
+class PickIndex : public pxr::TfWeakBase {
+public:
+    struct Hit {
+        double distance{};
+        pxr::GfVec3d point;
+        pxr::GfVec3d normal;
+        pxr::SdfPath primPath;
+        pxr::SdfPath instancerPath;
+        int instanceIndex{-1};
+    };
+
+    PickIndex();
+    ~PickIndex();
+
+    void setStage(const pxr::UsdStageRefPtr &stage);
+
+    void setTime(pxr::UsdTimeCode time);
+
+    /// Purposes whose prims can be picked, default and proxy unless told otherwise.
+    void setIncludedPurposes(const pxr::TfTokenVector &purposes);
+
+    /// Applies pending stage edits and time changes. Queries call this themselves.
+    void update();
+
+    /// Closest hit along `ray` (direction need not be normalized) within [minDistance, maxDistance].
+    std::optional<Hit> intersect(const pxr::GfRay &ray, double minDistance = 0.0,
+                                 double maxDistance = std::numeric_limits<double>::infinity());
+
+    /// Tests a point in the normalized device coordinates of a region's frustum.
+    using RegionTest = std::function<bool(const pxr::GfVec2d &ndc)>;
+
+    /// One hit per instance with geometry inside `frustum`. With `contains`, a
+    /// mesh only counts if one of its vertices inside the frustum passes it,
+    /// which narrows a bounding frustum down to a lasso.
+    std::vector<Hit> select(const pxr::GfFrustum &frustum, const RegionTest &contains = {});
+
+    /// True if the stage has gprims other than meshes, which only Hydra can pick.
+    [[nodiscard]] bool hasUnsupportedGprims() const { return _hasUnsupportedGprims; }
+
+    [[nodiscard]] size_t triangleCount() const;
+
+private:
+    struct Bounds {
+        pxr::GfVec3f min{std::numeric_limits<float>::max()};
+        pxr::GfVec3f max{-std::numeric_limits<float>::max()};
+
+        void extend(const pxr::GfVec3f &p);
+        void extend(const Bounds &b);
+        [[nodiscard]] pxr::GfVec3f center() const { return (min + max) * 0.5f; }
+        [[nodiscard]] bool isEmpty() const { return min[0] > max[0]; }
+    };
+
+    /// Interior nodes have count == 0 and children at `first` and `first + 1`.
+    /// Leaves reference `count` items starting at `first` in the item order.
+    struct Node {
+        Bounds bounds;
+        uint32_t first{0};
+        uint32_t count{0};
+    };
+
+    struct Bvh {
+        std::vector<Node> nodes;
+        std::vector<uint32_t> order;
+
+        void build(const std::vector<Bounds> &itemBounds);
+        /// Recomputes node bounds bottom up, keeping the topology.
+        void refit(const std::vector<Bounds> &itemBounds);
+    };
+
+    struct Mesh {
+        std::vector<pxr::GfVec3f> points;
+        std::vector<pxr::GfVec3i> triangles;
+        Bvh bvh;
+        bool timeVarying{false};
+        bool dirty{true};
+        /// Set when the last update rebuilt the triangles.
+        bool rebuilt{false};
+    };
+
+    using TimeVaryingCache = std::unordered_map<pxr::SdfPath, bool, pxr::SdfPath::Hash>;
+
+    struct Instance {
+        const Mesh *mesh{nullptr};
+        pxr::SdfPath meshKey;
+        pxr::SdfPath primPath;
+        pxr::SdfPath instancerPath;
+        int instanceIndex{-1};
+        /// Prim whose local to world transform places the instance.
+        pxr::SdfPath xformPrim;
+        /// Mesh to xformPrim space, for meshes under point instancer prototypes.
+        pxr::GfMatrix4d localXform{1.0};
+        bool timeVarying{false};
+        pxr::GfMatrix4d toWorld{1.0};
+        pxr::GfMatrix4d toLocal{1.0};
+    };
+
+    void _rebuildInstances();
+    void _addPointInstancer(const pxr::UsdPrim &prim, TimeVaryingCache &timeVaryingCache);
+    void _addMesh(const pxr::UsdPrim &prim, const pxr::SdfPath &instancerPath, int instanceIndex,
+                  const pxr::SdfPath &xformPrim, const pxr::GfMatrix4d &localXform, bool timeVarying);
+    bool _buildDirtyMeshes();
+    bool _updateTransforms(bool all);
+    bool _isPruned(const pxr::UsdPrim &prim) const;
+
+    void _onObjectsChanged(const pxr::UsdNotice::ObjectsChanged &notice, const pxr::UsdStageWeakPtr &sender);
+
+    pxr::UsdStageRefPtr _stage;
+    pxr::UsdTimeCode _time{pxr::UsdTimeCode::Default()};
+    pxr::TfTokenVector _purposes;
+    std::optional<pxr::TfNotice::Key> _noticeKey;
+
+    std::unordered_map<pxr::SdfPath, Mesh, pxr::SdfPath::Hash> _meshes;
+    std::vector<Instance> _instances;
+    std::vector<pxr::SdfPath> _instancerPaths;
+    std::vector<Bounds> _instanceBounds;
+    Bvh _topLevel;
+    bool _hasUnsupportedGprims{false};
+    bool _hasTimeVaryingInstancers{false};
+
+    // Pending work, applied by update().
+    bool _structureDirty{true};
+    bool _timeChanged{false};
+    std::vector<pxr::SdfPath> _dirtyXformPaths;
+};
+}// namespace vox
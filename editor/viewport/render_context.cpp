@@ -0,0 +1,289 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "render_context.h"
+
+#include <pxr/imaging/hd/aov.h>
+#include <pxr/imaging/hd/driver.h>
+#include <pxr/imaging/hd/sceneIndexPluginRegistry.h>
+#include <pxr/imaging/hgi/tokens.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/imageable.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usdImaging/usdImagingGL/rendererSettings.h>
+#include <functional>
+#include <mutex>
+
+namespace vox {
+namespace {
+/// Filters of the engine a context is creating; other render indices, such as the shader warm-up's, stay as they are.
+std::function<pxr::HdSceneIndexBaseRefPtr(const pxr::HdSceneIndexBaseRefPtr &)> creatingFilter;
+
+/// Assemblies and groups; meshes are merged under the closest one.
+std::set<pxr::SdfPath> groupModels(const pxr::UsdStageRefPtr &stage) {
+    std::set<pxr::SdfPath> groups;
+    for (const auto &prim : stage->Traverse()) {
+        if (prim.IsGroup()) {
+            groups.insert(prim.GetPath());
+        }
+    }
+    return groups;
+}
+
+/// Components with proxy purpose prims below them; the LOD filter shows their proxies when they get small.
+std::set<pxr::SdfPath> proxyModels(const pxr::UsdStageRefPtr &stage) {
+    std::set<pxr::SdfPath> models;
+    pxr::SdfPath component;
+    auto range = pxr::UsdPrimRange::Stage(stage);
+    for (auto iter = range.begin(); iter != range.end(); ++iter) {
+        const auto &prim = *iter;
+        if (prim.IsComponent()) {
+            component = prim.GetPath();
+        } else if (component.IsEmpty() || !prim.GetPath().HasPrefix(component)) {
+            component = pxr::SdfPath();
+            continue;
+        }
+        // Purpose is inherited, so the first authored proxy purpose decides.
+        pxr::TfToken purpose;
+        if (pxr::UsdGeomImageable(prim).GetPurposeAttr().Get(&purpose) && purpose == pxr::UsdGeomTokens->proxy) {
+            models.insert(component);
+            iter.PruneChildren();
+        }
+    }
+    return models;
+}
+
+/// Renderer settings of `from` that aren't at their default, set on `to`.
+void copyRendererSettings(pxr::UsdImagingGLEngine &from, pxr::UsdImagingGLEngine &to) {
+    for (const auto &setting : from.GetRendererSettingsList()) {
+        auto value = from.GetRendererSetting(setting.key);
+        if (value != setting.defValue) {
+            to.SetRendererSetting(setting.key, value);
+        }
+    }
+}
+
+void registerSceneIndexFilters() {
+    // Registrations can't be undone, so there is one for the process, filtering only the engines of a context.
+    static std::once_flag once;
+    std::call_once(once, []() {
+        pxr::HdSceneIndexPluginRegistry::GetInstance().RegisterSceneIndexForRenderer(
+            "GL",
+            [](const std::string &, const pxr::HdSceneIndexBaseRefPtr &inputScene,
+               const pxr::HdContainerDataSourceHandle &) -> pxr::HdSceneIndexBaseRefPtr {
+                return creatingFilter ? creatingFilter(inputScene) : inputScene;
+            },
+            nullptr, 0, pxr::HdSceneIndexPluginRegistry::InsertionOrderAtEnd);
+    });
+}
+}// namespace
+
+RenderContext::RenderContext(DataModel &model)
+    : _model{model}, _hgi{pxr::Hgi::CreatePlatformDefaultHgi()} {
+    registerSceneIndexFilters();
+    _meshMergingEnabled = _model.viewSettings().meshMerging();
+    // Connected before any view, so views see the new engine when they are told about the stage.
+    connect(&_model, &DataModel::signalStageReplaced, this, &RenderContext::_stageReplaced);
+    connect(&_model.viewSettings(), &ViewSettingsDataModel::signalSettingChanged, this, &RenderContext::_settingChanged);
+}
+
+RenderContext::~RenderContext() {
+    _modeEngines.clear();
+    _engine.reset();
+    _retired.clear();
+}
+
+Engine *RenderContext::engine(const Viewport *view) const {
+    auto state = _views.find(view);
+    if (state != _views.end() && state->second.renderMode) {
+        if (auto modeEngine = _modeEngines.find(*state->second.renderMode); modeEngine != _modeEngines.end()) {
+            return modeEngine->second.get();
+        }
+    }
+    return _engine.get();
+}
+
+void RenderContext::setRenderMode(const Viewport *view, std::optional<RenderModes> mode) {
+    auto &state = _views[view];
+    if (state.renderMode == mode) {
+        return;
+    }
+    state.renderMode = mode;
+    _updateModeEngines();
+}
+
+pxr::GfVec2i RenderContext::renderBufferSize(const Viewport *view, const pxr::GfVec2i &windowSize) {
+    _views[view].windowSize = windowSize;
+    const auto *viewEngine = engine(view);
+    pxr::GfVec2i size{0};
+    for (const auto &[other, state] : _views) {
+        if (engine(other) == viewEngine) {
+            size = pxr::GfVec2i(std::max(size[0], state.windowSize[0]), std::max(size[1], state.windowSize[1]));
+        }
+    }
+    return size;
+}
+
+bool RenderContext::makeCurrent(const Viewport *view) {
+    auto &current = _currentViews[engine(view)];
+    if (current == view) {
+        return false;
+    }
+    current = view;
+    return true;
+}
+
+void RenderContext::release(const Viewport *view) {
+    for (auto &[engine, current] : _currentViews) {
+        if (current == view) {
+            current = nullptr;
+        }
+    }
+    setIdRenderOutputs(view, false);
+    _views.erase(view);
+    _updateModeEngines();
+}
+
+void RenderContext::setIdRenderOutputs(const Viewport *view, bool enabled) {
+    if (enabled) {
+        _idRenderViews.insert(view);
+    } else {
+        _idRenderViews.erase(view);
+    }
+    if (_engine) {
+        _engine->setIdRenderOutputs(!_idRenderViews.empty());
+    }
+    for (auto &[mode, engine] : _modeEngines) {
+        engine->setIdRenderOutputs(!_idRenderViews.empty());
+    }
+}
+
+void RenderContext::setRendererSetting(const pxr::TfToken &id, const pxr::VtValue &value) {
+    if (_engine) {
+        _engine->SetRendererSetting(id, value);
+    }
+    for (auto &[mode, engine] : _modeEngines) {
+        engine->SetRendererSetting(id, value);
+    }
+}
+
+pxr::SdfPath RenderContext::sourcePrim(const pxr::SdfPath &primPath, const pxr::GfVec3d &point) const {
+    if (_screenSizeLod && _screenSizeLod->isBounds(primPath)) {
+        return primPath.GetParentPath();
+    }
+    return _meshMerging && _meshMerging->isMerged(primPath) ? _meshMerging->sourcePrim(primPath, point) : primPath;
+}
+
+void RenderContext::rebuildEngine() {
+    if (_model.stage() && _engine) {
+        _createEngine();
+        emit signalEngineRebuilt();
+    }
+}
+
+void RenderContext::_stageReplaced() {
+    if (_model.stage()) {
+        _createEngine();
+    }
+}
+
+void RenderContext::_settingChanged() {
+    if (_model.viewSettings().meshMerging() == _meshMergingEnabled) {
+        return;
+    }
+    _meshMergingEnabled = _model.viewSettings().meshMerging();
+    // Filters are part of the render index, so they only change with a new engine.
+    rebuildEngine();
+}
+
+void RenderContext::_createEngine() {
+    auto previous = std::move(_engine);
+    // Engines of other draw modes are built again for the new stage, after the shared one.
+    for (auto &[mode, engine] : _modeEngines) {
+        retire(std::move(engine));
+    }
+    _modeEngines.clear();
+    _meshMerging.reset();
+    _screenSizeLod.reset();
+    _adaptiveRefinement.reset();
+    // The refinement and LOD filters are always there, they pass prims through until they are used.
+    creatingFilter = [this, proxies = proxyModels(_model.stage()),
+                      roots = _meshMergingEnabled ? groupModels(_model.stage()) : std::set<pxr::SdfPath>()](
+                         const pxr::HdSceneIndexBaseRefPtr &inputScene) {
+        _screenSizeLod = ScreenSizeLodSceneIndex::New(inputScene, proxies);
+        pxr::HdSceneIndexBaseRefPtr scene = _screenSizeLod;
+        if (_meshMergingEnabled) {
+            // Merged after LOD, so meshes of small models leave their batch.
+            _meshMerging = MeshMergingSceneIndex::New(scene, roots);
+            scene = _meshMerging;
+        }
+        // Last, so a level change only dirties the mesh itself, never a batch it is merged into.
+        _adaptiveRefinement = AdaptiveRefinementSceneIndex::New(scene, pxr::get_pointer(_meshMerging));
+        return _adaptiveRefinement;
+    };
+    _engine = _newEngine();
+    creatingFilter = nullptr;
+    _currentViews.clear();
+
+    if (previous) {
+        // Settings changed in the render settings panel stay as they were for the new stage.
+        copyRendererSettings(*previous, *_engine);
+        retire(std::move(previous));
+    }
+    _updateModeEngines();
+}
+
+std::unique_ptr<Engine> RenderContext::_newEngine() {
+    pxr::HdDriver driver{pxr::HgiTokens->renderDriver, pxr::VtValue(_hgi.get())};
+    auto engine = std::make_unique<Engine>(driver);
+    engine->SetEnablePresentation(false);
+    engine->SetRendererAov(pxr::HdAovTokens->color);
+    engine->setIdRenderOutputs(!_idRenderViews.empty());
+    return engine;
+}
+
+void RenderContext::_updateModeEngines() {
+    std::set<RenderModes> used;
+    for (const auto &[view, state] : _views) {
+        if (state.renderMode) {
+            used.insert(*state.renderMode);
+        }
+    }
+    for (auto iter = _modeEngines.begin(); iter != _modeEngines.end();) {
+        if (used.count(iter->first)) {
+            ++iter;
+            continue;
+        }
+        _currentViews.erase(iter->second.get());
+        retire(std::move(iter->second));
+        iter = _modeEngines.erase(iter);
+    }
+    if (!_engine) {
+        return;
+    }
+    for (auto mode : used) {
+        if (!_modeEngines.count(mode)) {
+            auto engine = _newEngine();
+            copyRendererSettings(*_engine, *engine);
+            _modeEngines.emplace(mode, std::move(engine));
+        }
+    }
+}
+
+void RenderContext::retire(std::unique_ptr<Engine> engine) {
+    if (engine) {
+        _retired.push_back(std::move(engine));
+    }
+}
+
+void RenderContext::freeRetired() {
+    // Freeing a scene's prims, buffers and textures takes about as long as loading
+    // them; one engine per pass, so several retired at once don't stall one frame.
+    if (!_retired.empty()) {
+        _retired.pop_front();
+    }
+}
+}// namespace vox
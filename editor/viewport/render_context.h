@@ -0,0 +1,130 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <QObject>
+#include <pxr/imaging/hgi/hgi.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include "adaptive_refinement.h"
+#include "engine.h"
+#include "mesh_merging.h"
+#include "screen_size_lod.h"
+#include "../model/data_model.h"
+
+namespace vox {
+class Viewport;
+
+/// Rendering state shared by the viewports of a window: one Hgi device and
+/// one engine per stage, so the render index, the resource registry and the
+/// compiled shaders are built once however many views show the stage. Each
+/// view keeps its own camera, framing and lighting, and pushes them again
+/// when another view rendered last. The AOVs are sized to the largest view
+/// and smaller views render into a corner of them, so alternating views
+/// don't reallocate them. A view overriding the draw mode renders with an
+/// engine of that mode, as switching the render collection of the shared
+/// one every frame would rebuild its draw batches. On stage replacement the
+/// new engines take over the renderer settings of the old ones, which are
+/// freed between frames.
+class RenderContext : public QObject {
+    Q_OBJECT
+signals:
+    /// The engine was rebuilt for the same stage, after a setting that needs a new render index changed.
+    void signalEngineRebuilt();
+
+public:
+    explicit RenderContext(DataModel &model);
+
+    ~RenderContext() override;
+
+    [[nodiscard]] pxr::Hgi *hgi() const { return _hgi.get(); }
+
+    /// Engine for the current stage, null until a stage is set.
+    [[nodiscard]] Engine *engine() const { return _engine.get(); }
+
+    /// Engine `view` renders with: the shared one, or the one of its draw mode.
+    [[nodiscard]] Engine *engine(const Viewport *view) const;
+
+    /// Draw mode `view` renders in when it isn't the one of the view settings, none otherwise.
+    /// Creates the engine of that mode, and frees those no view uses anymore.
+    void setRenderMode(const Viewport *view, std::optional<RenderModes> mode);
+
+    /// Render buffer size of the engine of `view`, whose window is `windowSize`:
+    /// the largest window of the views rendering with that engine.
+    pxr::GfVec2i renderBufferSize(const Viewport *view, const pxr::GfVec2i &windowSize);
+
+    /// Makes `view` the one rendering. Returns true if the engine state it
+    /// pushed before may have been overwritten, by another view or a new engine.
+    bool makeCurrent(const Viewport *view);
+
+    /// Forgets `view`; called before it is destroyed.
+    void release(const Viewport *view);
+
+    /// Frees `engine` at the next freeRetired(). Hgi resources are created and
+    /// destroyed on the main thread only, and not while a frame is encoded.
+    void retire(std::unique_ptr<Engine> engine);
+
+    /// Frees the oldest retired engine; called on the main thread between frames, after EndFrame.
+    void freeRetired();
+
+    /// Builds the engine of the stage again, for changes its filters only see when created,
+    /// such as proxies added to models.
+    void rebuildEngine();
+
+    /// Id outputs are rendered while any view asks for them.
+    void setIdRenderOutputs(const Viewport *view, bool enabled);
+
+    /// Sets a renderer setting on every engine.
+    void setRendererSetting(const pxr::TfToken &id, const pxr::VtValue &value);
+
+    /// Mesh merging filter of the current engine, null when merging is off.
+    [[nodiscard]] MeshMergingSceneIndex *meshMerging() const { return pxr::get_pointer(_meshMerging); }
+
+    /// Screen-size LOD filter of the current engine, null until a stage is set.
+    [[nodiscard]] ScreenSizeLodSceneIndex *screenSizeLod() const { return pxr::get_pointer(_screenSizeLod); }
+
+    /// Adaptive refinement filter of the current engine, null until a stage is set.
+    [[nodiscard]] AdaptiveRefinementSceneIndex *adaptiveRefinement() const { return pxr::get_pointer(_adaptiveRefinement); }
+
+    /// The prim a hit on `primPath` at world `point` stands for; merged meshes map back to the mesh hit,
+    /// and the box of a model drawn as bounds to the model.
+    [[nodiscard]] pxr::SdfPath sourcePrim(const pxr::SdfPath &primPath, const pxr::GfVec3d &point) const;
+
+private:
+    struct ViewState {
+        std::optional<RenderModes> renderMode;
+        pxr::GfVec2i windowSize{0};
+    };
+
+    void _stageReplaced();
+    void _createEngine();
+    /// Engine rendering into color, with the id outputs and renderer settings of the shared one.
+    std::unique_ptr<Engine> _newEngine();
+    /// Creates the engines of the draw modes views use, and retires the others.
+    void _updateModeEngines();
+    void _settingChanged();
+
+    DataModel &_model;
+    pxr::HgiUniquePtr _hgi;
+    std::unique_ptr<Engine> _engine;
+    /// Engines of the draw modes views override; they have none of the filters of the shared one.
+    std::map<RenderModes, std::unique_ptr<Engine>> _modeEngines;
+    /// Engines of replaced stages and finished jobs, waiting for freeRetired().
+    std::deque<std::unique_ptr<Engine>> _retired;
+    std::map<const Viewport *, ViewState> _views;
+    /// View that rendered last with each engine.
+    std::map<const Engine *, const Viewport *> _currentViews;
+    std::set<const Viewport *> _idRenderViews;
+    bool _meshMergingEnabled{false};
+    MeshMergingSceneIndexRefPtr _meshMerging;
+    ScreenSizeLodSceneIndexRefPtr _screenSizeLod;
+    AdaptiveRefinementSceneIndexRefPtr _adaptiveRefinement;
+};
+}// namespace vox
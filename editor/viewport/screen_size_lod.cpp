@@ -0,0 +1,338 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "screen_size_lod.h"
+
+#include <pxr/base/gf/vec4d.h>
+#include <pxr/imaging/hd/basisCurvesSchema.h>
+#include <pxr/imaging/hd/basisCurvesTopologySchema.h>
+#include <pxr/imaging/hd/extentSchema.h>
+#include <pxr/imaging/hd/overlayContainerDataSource.h>
+#include <pxr/imaging/hd/primvarsSchema.h>
+#include <pxr/imaging/hd/purposeSchema.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/visibilitySchema.h>
+#include <pxr/imaging/hd/xformSchema.h>
+#include <algorithm>
+#include <limits>
+
+namespace vox {
+namespace {
+/// Models switch back to full once they are this much over the threshold.
+constexpr float Hysteresis = 1.25f;
+/// Color of the bounds draw mode.
+const pxr::GfVec3f BoundsColor(0.5f);
+
+const pxr::TfToken &boundsName() {
+    static const pxr::TfToken name("__lodBounds");
+    return name;
+}
+
+/// Larger side of the window rectangle covered by `range`, infinite when it reaches behind the camera.
+double projectedSize(const pxr::GfRange3d &range, const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize) {
+    pxr::GfVec2d min(std::numeric_limits<double>::max()), max(-std::numeric_limits<double>::max());
+    for (int i = 0; i < 8; ++i) {
+        auto corner = range.GetCorner(i);
+        auto clip = pxr::GfVec4d(corner[0], corner[1], corner[2], 1.0) * viewProjection;
+        if (clip[3] <= 1e-6) {
+            return std::numeric_limits<double>::infinity();
+        }
+        pxr::GfVec2d ndc(clip[0] / clip[3], clip[1] / clip[3]);
+        min = pxr::GfCompMin(min, ndc);
+        max = pxr::GfCompMax(max, ndc);
+    }
+    return std::max((max[0] - min[0]) * 0.5 * windowSize[0], (max[1] - min[1]) * 0.5 * windowSize[1]);
+}
+
+pxr::HdContainerDataSourceHandle buildPrimvar(const pxr::HdSampledDataSourceHandle &value,
+                                              const pxr::TfToken &interpolation, const pxr::TfToken &role) {
+    return pxr::HdPrimvarSchema::Builder()
+        .SetPrimvarValue(value)
+        .SetInterpolation(pxr::HdPrimvarSchema::BuildInterpolationDataSource(interpolation))
+        .SetRole(pxr::HdPrimvarSchema::BuildRoleDataSource(role))
+        .Build();
+}
+
+/// The twelve edges of `range` as linear curves, in world space.
+pxr::HdContainerDataSourceHandle buildBounds(const pxr::GfRange3d &range) {
+    pxr::VtVec3fArray points(8);
+    for (size_t i = 0; i < 8; ++i) {
+        points[i] = pxr::GfVec3f(range.GetCorner(i));
+    }
+    // Corner i has bit 0 set for max x, bit 1 for max y, bit 2 for max z.
+    pxr::VtIntArray indices = {0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7};
+    pxr::VtIntArray counts(12, 2);
+
+    auto topology = pxr::HdBasisCurvesTopologySchema::Builder()
+                        .SetCurveVertexCounts(pxr::HdRetainedTypedSampledDataSource<pxr::VtIntArray>::New(counts))
+                        .SetCurveIndices(pxr::HdRetainedTypedSampledDataSource<pxr::VtIntArray>::New(indices))
+                        .SetBasis(pxr::HdBasisCurvesTopologySchema::BuildBasisDataSource(pxr::HdTokens->bezier))
+                        .SetType(pxr::HdBasisCurvesTopologySchema::BuildTypeDataSource(pxr::HdTokens->linear))
+                        .SetWrap(pxr::HdBasisCurvesTopologySchema::BuildWrapDataSource(pxr::HdTokens->nonperiodic))
+                        .Build();
+    std::vector<pxr::TfToken> primvarNames = {pxr::HdTokens->points, pxr::HdTokens->displayColor};
+    std::vector<pxr::HdDataSourceBaseHandle> primvarValues = {
+        buildPrimvar(pxr::HdRetainedTypedSampledDataSource<pxr::VtVec3fArray>::New(points),
+                     pxr::HdPrimvarSchemaTokens->vertex, pxr::HdPrimvarSchemaTokens->point),
+        buildPrimvar(pxr::HdRetainedTypedSampledDataSource<pxr::VtVec3fArray>::New(pxr::VtVec3fArray(1, BoundsColor)),
+                     pxr::HdPrimvarSchemaTokens->constant, pxr::HdPrimvarSchemaTokens->color)};
+    auto xform = pxr::HdXformSchema::Builder()
+                     .SetMatrix(pxr::HdRetainedTypedSampledDataSource<pxr::GfMatrix4d>::New(pxr::GfMatrix4d(1.0)))
+                     .SetResetXformStack(pxr::HdRetainedTypedSampledDataSource<bool>::New(true))
+                     .Build();
+    auto extent = pxr::HdExtentSchema::Builder()
+                      .SetMin(pxr::HdRetainedTypedSampledDataSource<pxr::GfVec3d>::New(range.GetMin()))
+                      .SetMax(pxr::HdRetainedTypedSampledDataSource<pxr::GfVec3d>::New(range.GetMax()))
+                      .Build();
+
+    std::vector<pxr::TfToken> names = {pxr::HdBasisCurvesSchema::GetSchemaToken(), pxr::HdPrimvarsSchema::GetSchemaToken(),
+                                       pxr::HdXformSchema::GetSchemaToken(), pxr::HdExtentSchema::GetSchemaToken(),
+                                       pxr::HdVisibilitySchema::GetSchemaToken()};
+    std::vector<pxr::HdDataSourceBaseHandle> values = {
+        pxr::HdBasisCurvesSchema::Builder().SetTopology(topology).Build(),
+        pxr::HdRetainedContainerDataSource::New(primvarNames.size(), primvarNames.data(), primvarValues.data()),
+        xform, extent,
+        pxr::HdVisibilitySchema::Builder().SetVisibility(pxr::HdRetainedTypedSampledDataSource<bool>::New(true)).Build()};
+    return pxr::HdRetainedContainerDataSource::New(names.size(), names.data(), values.data());
+}
+
+pxr::TfToken purposeOf(const pxr::HdContainerDataSourceHandle &dataSource) {
+    if (auto purpose = pxr::HdPurposeSchema::GetFromParent(dataSource).GetPurpose()) {
+        return purpose->GetTypedValue(0.f);
+    }
+    return pxr::HdTokens->geometry;
+}
+}// namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+ScreenSizeLodSceneIndexRefPtr ScreenSizeLodSceneIndex::New(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                                           std::set<pxr::SdfPath> proxyModels) {
+    return pxr::TfCreateRefPtr(new ScreenSizeLodSceneIndex(inputScene, std::move(proxyModels)));
+}
+
+ScreenSizeLodSceneIndex::ScreenSizeLodSceneIndex(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                                 std::set<pxr::SdfPath> proxyModels)
+    : pxr::HdSingleInputFilteringSceneIndexBase(inputScene), _proxyModels{std::move(proxyModels)} {
+}
+
+pxr::HdSceneIndexPrim ScreenSizeLodSceneIndex::GetPrim(const pxr::SdfPath &primPath) const {
+    // The map is only written by update() and notices, never during sync.
+    if (_reduced.empty()) {
+        return _GetInputSceneIndex()->GetPrim(primPath);
+    }
+    if (isBounds(primPath)) {
+        return {pxr::HdPrimTypeTokens->basisCurves, _reduced.at(primPath.GetParentPath()).boundsDataSource};
+    }
+    auto prim = _GetInputSceneIndex()->GetPrim(primPath);
+    if (const auto *reduced = _reducedAncestor(primPath)) {
+        return _reducedPrim(*reduced, prim);
+    }
+    return prim;
+}
+
+pxr::SdfPathVector ScreenSizeLodSceneIndex::GetChildPrimPaths(const pxr::SdfPath &primPath) const {
+    auto children = _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+    if (auto it = _reduced.find(primPath); it != _reduced.end() && it->second.boundsDataSource) {
+        children.push_back(primPath.AppendChild(boundsName()));
+    }
+    return children;
+}
+
+void ScreenSizeLodSceneIndex::setCardModels(std::set<pxr::SdfPath> models) {
+    _cardModels = std::move(models);
+    _viewProjection.reset();
+}
+
+bool ScreenSizeLodSceneIndex::drawsCards(const pxr::SdfPath &modelPath) const {
+    auto it = _reduced.find(modelPath);
+    return it != _reduced.end() && it->second.form == Form::Cards;
+}
+
+bool ScreenSizeLodSceneIndex::isBounds(const pxr::SdfPath &primPath) const {
+    if (primPath.GetNameToken() != boundsName()) {
+        return false;
+    }
+    auto it = _reduced.find(primPath.GetParentPath());
+    return it != _reduced.end() && it->second.boundsDataSource;
+}
+
+void ScreenSizeLodSceneIndex::update(const std::vector<ModelBoundsCache::ModelBounds> &models, uint64_t version,
+                                     const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize,
+                                     float thresholdPixels) {
+    thresholdPixels = std::max(thresholdPixels, 0.f);
+    if (version == _version && _viewProjection == viewProjection && windowSize == _windowSize &&
+        thresholdPixels == _threshold) {
+        return;
+    }
+    _version = version;
+    _viewProjection = viewProjection;
+    _windowSize = windowSize;
+    _threshold = thresholdPixels;
+    _modelCount = thresholdPixels > 0.f ? models.size() : 0;
+
+    pxr::HdSceneIndexObserver::AddedPrimEntries added;
+    pxr::HdSceneIndexObserver::RemovedPrimEntries removed;
+    std::unordered_map<pxr::SdfPath, Reduced, pxr::SdfPath::Hash> reduced;
+    if (thresholdPixels > 0.f) {
+        for (const auto &model : models) {
+            auto previous = _reduced.find(model.path);
+            auto wasReduced = previous != _reduced.end();
+            auto threshold = wasReduced ? thresholdPixels * Hysteresis : thresholdPixels;
+            if (projectedSize(model.range, viewProjection, windowSize) >= threshold) {
+                continue;
+            }
+            auto form = _cardModels.count(model.path) ? Form::Cards
+                        : _proxyModels.count(model.path) ? Form::Proxy
+                                                         : Form::Bounds;
+            if (wasReduced && previous->second.form == form) {
+                auto entry = previous->second;
+                if (entry.boundsDataSource && entry.range != model.range) {
+                    // Animated bounds: the box is replaced where it is.
+                    entry.range = model.range;
+                    entry.boundsDataSource = buildBounds(model.range);
+                    added.push_back({model.path.AppendChild(boundsName()), pxr::HdPrimTypeTokens->basisCurves});
+                }
+                reduced.emplace(model.path, std::move(entry));
+                continue;
+            }
+            Reduced entry;
+            entry.range = model.range;
+            entry.form = form;
+            if (form == Form::Bounds) {
+                entry.boundsDataSource = buildBounds(model.range);
+            }
+            reduced.emplace(model.path, std::move(entry));
+        }
+    }
+
+    // Models whose form changed, with the form they had and have; cards don't touch the gprims.
+    std::vector<pxr::SdfPath> resend;
+    for (const auto &[path, entry] : _reduced) {
+        auto it = reduced.find(path);
+        if (it != reduced.end() && it->second.form == entry.form) {
+            continue;
+        }
+        if (entry.boundsDataSource) {
+            removed.push_back({path.AppendChild(boundsName())});
+        }
+        if (entry.form != Form::Cards) {
+            resend.push_back(path);
+        }
+        ++_generation;
+    }
+    for (const auto &[path, entry] : reduced) {
+        auto it = _reduced.find(path);
+        if (it != _reduced.end() && it->second.form == entry.form) {
+            continue;
+        }
+        if (entry.boundsDataSource) {
+            added.push_back({path.AppendChild(boundsName()), pxr::HdPrimTypeTokens->basisCurves});
+        }
+        if (entry.form != Form::Cards && (it == _reduced.end() || it->second.form == Form::Cards)) {
+            resend.push_back(path);
+        }
+        ++_generation;
+    }
+    _reduced = std::move(reduced);
+
+    for (const auto &path : resend) {
+        _resendGprims(path, &added);
+    }
+    if (!removed.empty()) {
+        _SendPrimsRemoved(removed);
+    }
+    if (!added.empty()) {
+        _SendPrimsAdded(added);
+    }
+}
+
+const ScreenSizeLodSceneIndex::Reduced *ScreenSizeLodSceneIndex::_reducedAncestor(const pxr::SdfPath &primPath) const {
+    for (auto path = primPath; !path.IsEmpty() && !path.IsAbsoluteRootPath(); path = path.GetParentPath()) {
+        if (auto it = _reduced.find(path); it != _reduced.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+pxr::HdSceneIndexPrim ScreenSizeLodSceneIndex::_reducedPrim(const Reduced &reduced, const pxr::HdSceneIndexPrim &prim) const {
+    if (!pxr::HdPrimTypeIsGprim(prim.primType)) {
+        return prim;
+    }
+    if (reduced.form == Form::Cards) {
+        return prim;
+    }
+    if (reduced.form == Form::Bounds) {
+        return {pxr::TfToken(), nullptr};
+    }
+    auto purpose = purposeOf(prim.dataSource);
+    if (purpose == pxr::HdTokens->render) {
+        return {pxr::TfToken(), nullptr};
+    }
+    if (purpose != pxr::HdTokens->proxy) {
+        return prim;
+    }
+    // Drawn whichever purposes the view shows, like the render geometry it stands for.
+    static const auto geometry = pxr::HdRetainedContainerDataSource::New(
+        pxr::HdPurposeSchema::GetSchemaToken(),
+        pxr::HdPurposeSchema::Builder().SetPurpose(pxr::HdRetainedTypedSampledDataSource<pxr::TfToken>::New(pxr::HdTokens->geometry)).Build());
+    return {prim.primType, pxr::HdOverlayContainerDataSource::New(geometry, prim.dataSource)};
+}
+
+void ScreenSizeLodSceneIndex::_resendGprims(const pxr::SdfPath &modelPath,
+                                            pxr::HdSceneIndexObserver::AddedPrimEntries *added) const {
+    const auto &input = _GetInputSceneIndex();
+    for (const auto &path : pxr::HdSceneIndexPrimView(input, modelPath)) {
+        auto prim = input->GetPrim(path);
+        if (pxr::HdPrimTypeIsGprim(prim.primType)) {
+            // Adding a prim again replaces it, which is how its type changes.
+            added->push_back({path, GetPrim(path).primType});
+        }
+    }
+}
+
+void ScreenSizeLodSceneIndex::_PrimsAdded(const pxr::HdSceneIndexBase &,
+                                          const pxr::HdSceneIndexObserver::AddedPrimEntries &entries) {
+    if (_reduced.empty()) {
+        _SendPrimsAdded(entries);
+        return;
+    }
+    pxr::HdSceneIndexObserver::AddedPrimEntries forwarded;
+    forwarded.reserve(entries.size());
+    for (const auto &entry : entries) {
+        if (pxr::HdPrimTypeIsGprim(entry.primType) && _reducedAncestor(entry.primPath)) {
+            forwarded.push_back({entry.primPath, GetPrim(entry.primPath).primType});
+        } else {
+            forwarded.push_back(entry);
+        }
+    }
+    _SendPrimsAdded(forwarded);
+}
+
+void ScreenSizeLodSceneIndex::_PrimsRemoved(const pxr::HdSceneIndexBase &,
+                                            const pxr::HdSceneIndexObserver::RemovedPrimEntries &entries) {
+    // Removing a model removes its box with it; it is looked at again on the next update.
+    // Models drawn as cards are resynced by their draw mode switching, and keep their state.
+    auto count = _reduced.size();
+    for (const auto &entry : entries) {
+        for (auto it = _reduced.begin(); it != _reduced.end();) {
+            auto drop = it->second.form != Form::Cards && it->first.HasPrefix(entry.primPath);
+            it = drop ? _reduced.erase(it) : std::next(it);
+        }
+    }
+    if (_reduced.size() != count) {
+        _viewProjection.reset();
+    }
+    _SendPrimsRemoved(entries);
+}
+
+void ScreenSizeLodSceneIndex::_PrimsDirtied(const pxr::HdSceneIndexBase &,
+                                            const pxr::HdSceneIndexObserver::DirtiedPrimEntries &entries) {
+    _SendPrimsDirtied(entries);
+}
+}// namespace vox
@@ -0,0 +1,108 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/gf/vec2i.h>
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/usd/sdf/path.h>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "../model/model_bounds_cache.h"
+
+namespace vox {
+class ScreenSizeLodSceneIndex;
+using ScreenSizeLodSceneIndexRefPtr = pxr::TfRefPtr<ScreenSizeLodSceneIndex>;
+
+/// Scene index filter drawing the models that cover few pixels in a cheaper
+/// form, so distant clutter stops costing full gprim sync and draws. A model
+/// with baked cards is left to UsdImaging, which draws it as cards while the
+/// card baker authors the draw mode; a model with proxy geometry shows its
+/// proxy instead of its render geometry; any other model is drawn as its
+/// bounding box, like the bounds draw mode. Models switch when their
+/// projected size drops below the threshold and switch back once it is a
+/// quarter above it, so they don't flicker at the boundary.
+class ScreenSizeLodSceneIndex : public pxr::HdSingleInputFilteringSceneIndexBase {
+public:
+    /// `proxyModels` are the models with proxy purpose gprims below them.
+    static ScreenSizeLodSceneIndexRefPtr New(const pxr::HdSceneIndexBaseRefPtr &inputScene,
+                                             std::set<pxr::SdfPath> proxyModels);
+
+    pxr::HdSceneIndexPrim GetPrim(const pxr::SdfPath &primPath) const override;
+
+    pxr::SdfPathVector GetChildPrimPaths(const pxr::SdfPath &primPath) const override;
+
+    /// Switches the models of `models` seen through `viewProjection` in a
+    /// window of `windowSize`, whose bounds span fewer than `thresholdPixels`
+    /// on screen. A threshold of 0 draws every model in full. `version` tells
+    /// whether `models` changed since the last call.
+    void update(const std::vector<ModelBoundsCache::ModelBounds> &models, uint64_t version,
+                const pxr::GfMatrix4d &viewProjection, const pxr::GfVec2i &windowSize, float thresholdPixels);
+
+    /// Models to draw as cards when they are small, from the next update.
+    void setCardModels(std::set<pxr::SdfPath> models);
+
+    /// True if `modelPath` is small and should be drawn as its cards.
+    [[nodiscard]] bool drawsCards(const pxr::SdfPath &modelPath) const;
+
+    /// Bumped whenever a model switches.
+    [[nodiscard]] uint64_t generation() const { return _generation; }
+
+    /// True if `primPath` is the box drawn for a model; its parent is the model.
+    [[nodiscard]] bool isBounds(const pxr::SdfPath &primPath) const;
+
+    /// Models drawn as bounds, proxies or cards, and models considered.
+    [[nodiscard]] size_t reducedCount() const { return _reduced.size(); }
+    [[nodiscard]] size_t modelCount() const { return _modelCount; }
+
+protected:
+    ScreenSizeLodSceneIndex(const pxr::HdSceneIndexBaseRefPtr &inputScene, std::set<pxr::SdfPath> proxyModels);
+
+    void _PrimsAdded(const pxr::HdSceneIndexBase &sender,
+                     const pxr::HdSceneIndexObserver::AddedPrimEntries &entries) override;
+
+    void _PrimsRemoved(const pxr::HdSceneIndexBase &sender,
+                       const pxr::HdSceneIndexObserver::RemovedPrimEntries &entries) override;
+
+    void _PrimsDirtied(const pxr::HdSceneIndexBase &sender,
+                       const pxr::HdSceneIndexObserver::DirtiedPrimEntries &entries) override;
+
+private:
+    enum class Form {
+        Bounds,
+        Proxy,
+        Cards
+    };
+
+    struct Reduced {
+        pxr::GfRange3d range;
+        Form form{Form::Bounds};
+        pxr::HdContainerDataSourceHandle boundsDataSource;
+    };
+
+    /// The reduced model `primPath` is in, if any.
+    const Reduced *_reducedAncestor(const pxr::SdfPath &primPath) const;
+    /// How `prim` is drawn while its model is reduced.
+    pxr::HdSceneIndexPrim _reducedPrim(const Reduced &reduced, const pxr::HdSceneIndexPrim &prim) const;
+    /// Re-adds the gprims below `modelPath` with their type as drawn now.
+    void _resendGprims(const pxr::SdfPath &modelPath, pxr::HdSceneIndexObserver::AddedPrimEntries *added) const;
+
+    std::set<pxr::SdfPath> _proxyModels;
+    std::set<pxr::SdfPath> _cardModels;
+    std::unordered_map<pxr::SdfPath, Reduced, pxr::SdfPath::Hash> _reduced;
+    size_t _modelCount{0};
+    uint64_t _generation{0};
+    // What the last update was computed for.
+    uint64_t _version{0};
+    std::optional<pxr::GfMatrix4d> _viewProjection;
+    pxr::GfVec2i _windowSize{0};
+    float _threshold{0.f};
+};
+}// namespace vox
@@ -0,0 +1,68 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usdImaging/usdImagingGL/renderParams.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "render_context.h"
+
+namespace vox {
+/// Compiles the shaders of recently opened stages while the viewer is idle.
+/// Only one gprim per distinct type, material and primvar set is rendered,
+/// from a stage masked to those prims, so the main thread syncs a handful of
+/// prims instead of the whole stage.
+///
+/// The viewer caches nothing itself: Storm keeps its programs in the warmup
+/// engine, which is freed right after. What persists across sessions is only
+/// Metal's on-disk compiler cache, which the OS owns and may evict. Warmup
+/// fills it, so opening a warmed stage compiles faster, not never.
+class ShaderWarmup {
+public:
+    explicit ShaderWarmup(RenderContext &context);
+
+    /// Remembers `path` as the most recently opened stage, across launches.
+    void noteStage(const std::string &path);
+
+    [[nodiscard]] const std::vector<std::string> &recentStages() const { return _recentStages; }
+
+    /// Queues the recent stages other than `current`, or drops the queue.
+    void setEnabled(bool enabled, const std::string &current);
+
+    [[nodiscard]] bool active() const { return !_queue.empty() || _pending; }
+
+    /// Renders at most one queued stage, once its sample has loaded on a worker thread.
+    /// Call from the event loop while the user isn't interacting.
+    void step(const pxr::UsdImagingGLRenderParams &params);
+
+    [[nodiscard]] size_t warmedCount() const { return _warmedCount; }
+
+private:
+    struct Load {
+        std::mutex mutex;
+        pxr::UsdStageRefPtr stage;
+        bool done{false};
+    };
+
+    /// Opens `path` masked to one gprim per draw program it needs, with their materials.
+    static pxr::UsdStageRefPtr _openSample(const std::string &path);
+
+    /// Renders one small frame of the sample, which compiles its draw programs.
+    void _render(const pxr::UsdStageRefPtr &stage, const pxr::UsdImagingGLRenderParams &params);
+
+    RenderContext &_context;
+    bool _enabled{false};
+    std::vector<std::string> _recentStages;
+    std::deque<std::string> _queue;
+    std::shared_ptr<Load> _pending;
+    size_t _warmedCount{0};
+};
+}// namespace vox
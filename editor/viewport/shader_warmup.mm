@@ -0,0 +1,186 @@
+//  Copyright (c) 2024 Feng Yang
+//
+//  I am making my contributions/submissions to this project solely in my
+//  personal capacity and am not conveying any rights to any intellectual
+//  property of any third parties.
+
+#include "shader_warmup.h"
+#include "../model/free_camera.h"
+#include "../profiler.h"
+
+#include <pxr/base/work/detachedTask.h>
+#include <pxr/imaging/cameraUtil/framing.h>
+#include <pxr/imaging/hd/aov.h>
+#include <pxr/imaging/hd/driver.h>
+#include <pxr/imaging/hgi/tokens.h>
+#include <pxr/imaging/hgiMetal/hgi.h>
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/bboxCache.h>
+#include <pxr/usd/usdGeom/gprim.h>
+#include <pxr/usd/usdGeom/metrics.h>
+#include <pxr/usd/usdGeom/primvarsAPI.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdShade/materialBindingAPI.h>
+#include <QSettings>
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+namespace vox {
+namespace {
+constexpr size_t MaxRecentStages = 8;
+/// Program selection doesn't depend on the resolution, so a tiny frame does.
+constexpr int WarmupSize = 64;
+const char *RecentStagesKey = "recentStages";
+}// namespace
+
+ShaderWarmup::ShaderWarmup(RenderContext &context)
+    : _context{context} {
+    for (const auto &path : QSettings().value(RecentStagesKey).toStringList()) {
+        _recentStages.push_back(path.toStdString());
+    }
+}
+
+void ShaderWarmup::noteStage(const std::string &path) {
+    if (path.empty()) {
+        return;
+    }
+    _recentStages.erase(std::remove(_recentStages.begin(), _recentStages.end(), path), _recentStages.end());
+    _recentStages.insert(_recentStages.begin(), path);
+    if (_recentStages.size() > MaxRecentStages) {
+        _recentStages.resize(MaxRecentStages);
+    }
+    QStringList paths;
+    for (const auto &recent : _recentStages) {
+        paths.push_back(QString::fromStdString(recent));
+    }
+    QSettings().setValue(RecentStagesKey, paths);
+}
+
+void ShaderWarmup::setEnabled(bool enabled, const std::string &current) {
+    if (enabled == _enabled) {
+        return;
+    }
+    _enabled = enabled;
+    _queue.clear();
+    if (enabled) {
+        for (const auto &path : _recentStages) {
+            if (path != current) {
+                _queue.push_back(path);
+            }
+        }
+    }
+}
+
+void ShaderWarmup::step(const pxr::UsdImagingGLRenderParams &params) {
+    if (!_pending) {
+        if (_queue.empty()) {
+            return;
+        }
+        // Composition and sampling run on a worker thread; only the render needs the main thread.
+        _pending = std::make_shared<Load>();
+        pxr::WorkRunDetachedTask([load = _pending, path = _queue.front()]() {
+            auto stage = _openSample(path);
+            std::lock_guard<std::mutex> lock(load->mutex);
+            load->stage = stage;
+            load->done = true;
+        });
+        _queue.pop_front();
+        return;
+    }
+
+    pxr::UsdStageRefPtr stage;
+    {
+        std::lock_guard<std::mutex> lock(_pending->mutex);
+        if (!_pending->done) {
+            return;
+        }
+        stage = std::move(_pending->stage);
+    }
+    _pending.reset();
+    if (stage && _enabled) {
+        _render(stage, params);
+        ++_warmedCount;
+    }
+    if (stage) {
+        pxr::WorkMoveDestroyAsync(stage);
+    }
+}
+
+pxr::UsdStageRefPtr ShaderWarmup::_openSample(const std::string &path) {
+    auto stage = pxr::UsdStage::Open(path);
+    if (!stage) {
+        return {};
+    }
+    // Storm picks a program from the prim type, its material network and the primvars it reads.
+    using Key = std::tuple<pxr::TfToken, pxr::SdfPath, std::vector<pxr::TfToken>>;
+    std::set<Key> seen;
+    std::set<pxr::SdfPath> prototypes;
+    pxr::UsdStagePopulationMask mask;
+    auto range = pxr::UsdPrimRange(stage->GetPseudoRoot());
+    for (auto iter = range.begin(); iter != range.end(); ++iter) {
+        if (iter->IsInstance()) {
+            // One instance stands for every other instance of its prototype.
+            if (prototypes.insert(iter->GetPrototype().GetPath()).second) {
+                mask.Add(iter->GetPath());
+            }
+            iter.PruneChildren();
+            continue;
+        }
+        if (!iter->IsA<pxr::UsdGeomGprim>()) {
+            continue;
+        }
+        auto material = pxr::UsdShadeMaterialBindingAPI(*iter).ComputeBoundMaterial();
+        std::vector<pxr::TfToken> primvars;
+        for (const auto &primvar : pxr::UsdGeomPrimvarsAPI(*iter).GetPrimvarsWithAuthoredValues()) {
+            primvars.push_back(primvar.GetPrimvarName());
+        }
+        std::sort(primvars.begin(), primvars.end());
+        auto materialPath = material ? material.GetPath() : pxr::SdfPath();
+        if (seen.emplace(iter->GetTypeName(), materialPath, std::move(primvars)).second) {
+            mask.Add(iter->GetPath());
+            if (!materialPath.IsEmpty()) {
+                mask.Add(materialPath);
+            }
+        }
+    }
+    // The full stage is only needed to pick the sample; this is a worker already.
+    stage = nullptr;
+    if (mask.IsEmpty()) {
+        return {};
+    }
+    return pxr::UsdStage::OpenMasked(path, mask);
+}
+
+void ShaderWarmup::_render(const pxr::UsdStageRefPtr &stage, const pxr::UsdImagingGLRenderParams &params) {
+    VOX_PROFILE_SCOPE("shaderWarmup");
+    auto *hgi = static_cast<pxr::HgiMetal *>(_context.hgi());
+    pxr::HdDriver driver{pxr::HgiTokens->renderDriver, pxr::VtValue(_context.hgi())};
+    auto engine = std::make_unique<Engine>(driver);
+    engine->SetEnablePresentation(false);
+    engine->SetRendererAov(pxr::HdAovTokens->color);
+    engine->SetRenderBufferSize(pxr::GfVec2i(WarmupSize));
+    engine->SetFraming(pxr::CameraUtilFraming(pxr::GfRect2i(pxr::GfVec2i(0), WarmupSize, WarmupSize)));
+
+    // Framing the whole sample keeps frustum culling from skipping any draw batch.
+    pxr::UsdGeomBBoxCache bboxCache(stage->GetStartTimeCode(),
+                                    {pxr::UsdGeomTokens->default_, pxr::UsdGeomTokens->proxy}, true);
+    auto bbox = bboxCache.ComputeWorldBound(stage->GetPseudoRoot());
+    FreeCamera camera(pxr::UsdGeomGetStageUpAxis(stage) == pxr::UsdGeomTokens->z);
+    if (!bbox.GetRange().IsEmpty()) {
+        camera.frameSelection(bbox, 1.1f);
+    }
+    auto frustum = camera.computeGfCamera(bbox, true).GetFrustum();
+    engine->SetCameraState(frustum.ComputeViewMatrix(), frustum.ComputeProjectionMatrix());
+
+    auto renderParams = params;
+    renderParams.frame = stage->GetStartTimeCode();
+    renderParams.bboxes = {};
+    renderParams.highlight = false;
+    hgi->StartFrame();
+    engine->Render(stage->GetPseudoRoot(), renderParams);
+    hgi->CommitPrimaryCommandBuffer();
+    hgi->EndFrame();
+    _context.retire(std::move(engine));
+}
+}// namespace vox
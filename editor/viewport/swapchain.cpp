@@ -29,7 +29,8 @@ Swapchain::Swapchain(MTL::Device *device, uint64_t window_handle,
 
     // load imgui
     IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
+    _imguiContext = ImGui::CreateContext();
+    ImGui::SetCurrentContext(_imguiContext);
     ImGuiIO &io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;// Enable Keyboard Controls
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad; // Enable Gamepad Controls
@@ -105,7 +106,13 @@ Swapchain::~Swapchain() noexcept {
     _render_pass_desc->release();
     _pipeline->release();
     _layer->release();
+    ImGui::SetCurrentContext(_imguiContext);
     ImGui_ImplMetal_Shutdown();
+    ImGui::DestroyContext(_imguiContext);
+}
+
+void Swapchain::makeCurrent() const {
+    ImGui::SetCurrentContext(_imguiContext);
 }
 
 void Swapchain::create_pso(MTL::Device *device) {
@@ -140,11 +147,12 @@ void Swapchain::create_pso(MTL::Device *device) {
         "    return out;\n"
         "}\n"
         "\n"
-        "fragment half4 fragBlitLinear(VertexOut in [[stage_in]], texture2d<float> tex[[texture(0)]])\n"
+        "fragment half4 fragBlitLinear(VertexOut in [[stage_in]], texture2d<float> tex[[texture(0)]],\n"
+        "                               constant float2 &scale [[buffer(0)]])\n"
         "{\n"
-        "    constexpr sampler s = sampler(address::clamp_to_edge);\n"
+        "    constexpr sampler s = sampler(address::clamp_to_edge, filter::linear);\n"
         "    \n"
-        "    float4 pixel = tex.sample(s, in.texcoord);\n"
+        "    float4 pixel = tex.sample(s, in.texcoord * scale);\n"
         "    return half4(pixel);\n"
         "}";
 
@@ -192,6 +200,7 @@ MTL::Drawable *Swapchain::nextDrawable() {
         auto attachment_desc = _render_pass_desc->colorAttachments()->object(0);
         attachment_desc->setTexture(drawable->texture());
 
+        makeCurrent();
         ImGui_ImplMetal_NewFrame(_render_pass_desc);
         ImGui::NewFrame();
         return drawable;
@@ -201,15 +210,19 @@ MTL::Drawable *Swapchain::nextDrawable() {
     }
 }
 
-void Swapchain::present(MTL::Drawable *drawable, MTL::CommandBuffer *command_buffer, MTL::Texture *image) noexcept {
+void Swapchain::present(MTL::Drawable *drawable, MTL::CommandBuffer *command_buffer, MTL::Texture *image,
+                        float widthScale, float heightScale) noexcept {
     auto command_encoder = command_buffer->renderCommandEncoder(_render_pass_desc);
     // Blit the texture to the view.
     command_encoder->pushDebugGroup(NS::String::string("FinalBlit", NS::UTF8StringEncoding));
     command_encoder->setFragmentTexture(image, 0);
+    const float scale[2] = {widthScale, heightScale};
+    command_encoder->setFragmentBytes(scale, sizeof(scale), 0);
     command_encoder->setRenderPipelineState(_pipeline);
     command_encoder->drawPrimitives(MTL::PrimitiveTypeTriangle, NS::UInteger(0), NS::UInteger(3));
     command_encoder->popDebugGroup();
 
+    makeCurrent();
     ImGui::Render();
     ImGui_ImplMetal_RenderDrawData(ImGui::GetDrawData(), command_buffer, command_encoder);
 
@@ -10,6 +10,8 @@
 #include "third_party/metal-cpp/Metal/Metal.hpp"
 #include <string_view>
 
+struct ImGuiContext;
+
 extern "C" CA::MetalLayer *metal_backend_create_layer(
     MTL::Device *device, uint64_t window_handle,
     uint32_t width, uint32_t height,
@@ -27,12 +29,16 @@ public:
 
     MTL::Drawable *nextDrawable();
 
-    void present(MTL::Drawable *drawable, MTL::CommandBuffer *commandBuffer, MTL::Texture *image) noexcept;
+    /// Draws the part of `image` from its origin spanning `widthScale` x `heightScale` of it over the view.
+    void present(MTL::Drawable *drawable, MTL::CommandBuffer *commandBuffer, MTL::Texture *image,
+                 float widthScale = 1.f, float heightScale = 1.f) noexcept;
 
     void set_name(std::string_view name) noexcept;
 
     void resize(int width, int height);
 
+    /// Makes this swapchain's ImGui context current; each view has its own HUD and input state.
+    void makeCurrent() const;
 
 private:
     void create_pso(MTL::Device *device);
@@ -45,6 +51,7 @@ private:
     MTL::RenderPassDescriptor *_render_pass_desc{};
     NS::String *_command_label{};
     MTL::PixelFormat _format;
+    ImGuiContext *_imguiContext{};
 };
 
 }// namespace vox
\ No newline at end of file
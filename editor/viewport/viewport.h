@@ -8,6 +8,7 @@
 
 #include <Metal/Metal.hpp>
 
+#include <pxr/base/gf/matrix4d.h>
 #include <pxr/base/gf/vec3f.h>
 #include <pxr/usd/usd/stage.h>
 #include <pxr/imaging/hdx/tokens.h>
@@ -19,7 +20,16 @@
 
 #include "swapchain.h"
 #include "camera.h"
+#include "frame_capture.h"
+#include "dynamic_resolution.h"
+#include "engine.h"
+#include "id_buffer.h"
+#include "depth_probe.h"
+#include "flipbook.h"
+#include "pick_index.h"
+#include "render_context.h"
 #include "../framerate.h"
+#include "../playback_log.h"
 #include "../model/data_model.h"
 
 namespace vox {
@@ -28,6 +38,16 @@ class Viewport : public QWidget {
 signals:
     void signalBboxUpdateTimeChanged(long long);
 
+    void signalPrimSelected(pxr::SdfPath, int, pxr::SdfPath, pxr::HdInstancerContext, pxr::GfVec3d,
+                            Qt::MouseButton,
+                            Qt::KeyboardModifiers);
+
+    void signalPrimRollover(pxr::SdfPath, int, pxr::SdfPath, pxr::HdInstancerContext,
+                            pxr::GfVec3d, Qt::KeyboardModifiers);
+
+    /// (path, instance) pairs inside a dragged marquee or lasso, instancer paths for point instances.
+    void signalPrimsRegionSelected(std::vector<std::pair<pxr::SdfPath, int>>, Qt::KeyboardModifiers);
+
     void signalMouseDrag();
 
     void signalSwitchedToFreeCam();
@@ -35,7 +55,11 @@ signals:
     void signalFrustumChanged();
 
 public:
-    explicit Viewport(QWidget *parent, DataModel &model);
+    /// The primary view drives playback and uses the camera of the view settings;
+    /// other views only show the current frame, each from its own free camera.
+    explicit Viewport(QWidget *parent, DataModel &model, RenderContext &context, bool primary = true);
+
+    ~Viewport() override;
 
     [[nodiscard]] QPaintEngine *paintEngine() const override { return nullptr; }
 
@@ -51,18 +75,46 @@ public:
 
     void setRendererSetting(pxr::TfToken const &id, pxr::VtValue const &value);
 
-private:
-    /// Initializes the Storm engine.
-    void initializeEngine();
+    /// Writes the next rendered frame to `path` without stalling the frame loop.
+    void grabFrameBuffer(const std::string &path, bool includeDepth = false);
+
+    /// Writes the next `frameCount` distinct time codes rendered into `directory`.
+    void captureSequence(const std::string &directory, int frameCount);
+
+    /// Frame and dropped-frame counts of playback, with optional per-frame timings.
+    PlaybackLog &playbackLog() { return _playbackLog; }
+
+    [[nodiscard]] bool rolloverPicking() const { return _rolloverPicking; }
+
+    /// Emits signalPrimRollover as the mouse moves, answered from the id AOVs of the last frame.
+    void setRolloverPicking(bool enabled);
+
+    /// Render params of the last frame.
+    [[nodiscard]] const pxr::UsdImagingGLRenderParams &renderParams() const { return _renderParams; }
+
+    [[nodiscard]] std::optional<RenderModes> renderMode() const { return _renderMode; }
 
+    /// Draw mode of this view only, none to follow the view settings.
+    void setRenderMode(std::optional<RenderModes> mode);
+
+private:
     /// Updates the animation timing variables.
     pxr::UsdTimeCode updateTime();
 
-    /// Draws the scene using Hydra.
-    pxr::HgiTextureHandle drawWithHydra();
+    /// Draws the scene using Hydra, seen through the camera resolved for the frame.
+    pxr::HgiTextureHandle drawWithHydra(const pxr::GfCamera &gfCamera, float cameraAspect);
 
     void drawHUD();
 
+    /// Called when a view setting that feeds the engine state changes.
+    void _markRenderStateDirty();
+
+    /// Pushes lights and the default material to the engine.
+    void _updateLightingState(const pxr::GfVec3d &cameraPosition);
+
+    /// Rebuilds the render params that only depend on view settings.
+    void _updateRenderParams();
+
 private:
     void mousePressEvent(QMouseEvent *event) override;
 
@@ -85,10 +137,18 @@ private:
 
     std::shared_ptr<FreeCamera> _createNewFreeCamera(ViewSettingsDataModel &viewSettings, bool isZUp);
 
+    /// The free camera of this view.
+    std::shared_ptr<FreeCamera> freeCamera();
+
+    void setFreeCamera(std::shared_ptr<FreeCamera> camera);
+
     std::optional<pxr::UsdPrim> getActiveSceneCamera();
 
     void switchToFreeCamera(bool computeAndSetClosestDistance = true);
 
+    /// True while the user is tumbling, trucking or zooming the camera.
+    bool isInteracting() const;
+
     /// True if the camera has a defined aspect ratio that should not change when the viewport is resized.
     bool hasLockedAspectRatio();
 
@@ -121,6 +181,8 @@ private:
     /// Set the USD Stage this widget will be displaying. To decommission
     /// (even temporarily) this widget, supply None as 'stage'.
     void _stageReplaced();
+    /// Drops what was read back from the previous engine and pushes the render state again.
+    void _engineReplaced();
 
     void _processBBoxes();
 
@@ -132,9 +194,42 @@ private:
         int outHitInstanceIndex;
         pxr::HdInstancerContext outInstancerContext;
     };
+    /// Picks meshes with the CPU pick index. When the stage has geometry the
+    /// index can't represent, a Hydra id render is picked too and the nearer hit kept.
     std::optional<PickResult> pick(const pxr::GfFrustum &pickFrustum);
+    /// Returns whether (x, y) is inside the rendered image, and the pick frustum through it.
+    std::pair<bool, pxr::GfFrustum> computePickFrustum(qreal x, qreal y);
+    /// Pick frustum through the window rectangle of `width` x `height` pixels centered at (x, y).
+    std::pair<bool, pxr::GfFrustum> computePickFrustum(qreal x, qreal y, qreal width, qreal height);
+    /// Matches the pick index purposes to the displayed ones.
+    void _updatePickPurposes();
+    /// Selects everything inside the dragged region in one selection change.
+    void _selectRegion(Qt::KeyboardModifiers modifiers);
     void pickObject(qreal x, qreal y, Qt::MouseButton button, Qt::KeyboardModifiers modifiers);
 
+    /// The camera and window the last frame was rendered with.
+    AovView _aovView();
+    /// Answers the latest rollover query once per frame, reading back ids when the buffer is stale.
+    void _serviceRollover(pxr::Hgi *hgi, uint64_t frameIndex);
+    /// Selects the released region once the id buffer holds the last frame, or can't.
+    void _serviceRegionSelect(pxr::Hgi *hgi, uint64_t frameIndex);
+    void _finishRegionSelect();
+    /// Moves the free camera's closest visible distance to the newest depth readback.
+    void _applyDepthProbe();
+    /// Reads back depth of the frame being encoded when auto clipping and the view changed.
+    void _requestDepthProbe(pxr::Hgi *hgi, uint64_t frameIndex);
+    /// Pushes the flipbook budget and spill directory, and frees it when turned off.
+    void _updateFlipbookSettings();
+    /// Requests the stage textures at the mip levels this view needs, at most a few times a second.
+    /// The filters below are shared by every view, so only the primary view's camera drives them.
+    void _updateTextureBudget(const pxr::GfMatrix4d &viewProjection);
+    /// Switches the models that got small or large on screen since the last frame.
+    void _updateScreenSizeLod(const pxr::GfMatrix4d &viewProjection);
+    /// Chooses the refine levels of the subdivision meshes under the triangle budget, at most a few times a second.
+    void _updateAdaptiveRefinement(const pxr::GfMatrix4d &viewProjection);
+    /// Pushes everything again if another view rendered with the shared engine since this one.
+    void _makeCurrent();
+
     std::optional<pxr::GfCamera> _lastComputedGfCamera{};
     float _lastAspectRatio = 1.0;
     bool _stageIsZup = true;
@@ -151,7 +246,14 @@ private:
         {RenderModes::GEOM_SMOOTH, pxr::UsdImagingGLDrawMode::DRAW_GEOM_SMOOTH},
         {RenderModes::GEOM_FLAT, pxr::UsdImagingGLDrawMode::DRAW_GEOM_FLAT},
         {RenderModes::HIDDEN_SURFACE_WIREFRAME, pxr::UsdImagingGLDrawMode::DRAW_WIREFRAME}};
+    std::optional<RenderModes> _renderMode;
     pxr::UsdImagingGLRenderParams _renderParams;
+    // Engine state last pushed, so unchanged state isn't pushed every frame.
+    bool _renderStateDirty{true};
+    std::optional<pxr::GfVec2i> _pushedRenderBufferSize;
+    std::optional<pxr::CameraUtilFraming> _pushedFraming;
+    std::optional<pxr::CameraUtilConformWindowPolicy> _pushedWindowPolicy;
+    std::optional<pxr::GfVec3d> _pushedLightPosition;
     bool _forceRefresh{false};
     bool _dragActive = false;
     enum class CameraMode {
@@ -164,16 +266,56 @@ private:
     CameraMode _cameraMode = CameraMode::None;
     qreal _lastX = 0;
     qreal _lastY = 0;
+    double _lastWheelTime = 0;
+    DynamicResolution _dynamicResolution;
+    PickIndex _pickIndex;
+    struct RolloverQuery {
+        qreal x;
+        qreal y;
+        Qt::KeyboardModifiers modifiers;
+    };
+    bool _rolloverPicking{false};
+    /// Latest mouse position only; moves between frames are coalesced.
+    std::optional<RolloverQuery> _pendingRollover;
+    /// Window pixels dragged through while selecting, starting at the press.
+    std::vector<pxr::GfVec2d> _regionPoints;
+    bool _regionActive{false};
+    /// Modifiers of a released region waiting for its id readback.
+    std::optional<Qt::KeyboardModifiers> _pendingRegionSelect;
 
 private:
     DataModel &_model;
+    RenderContext &_context;
+    bool _primary{true};
+    /// Camera of a secondary view; the primary one uses the view settings' camera.
+    std::shared_ptr<FreeCamera> _freeCamera;
     vox::Framerate _framerate;
+    int _frameStatsWindow{120};
+    std::vector<float> _frameTimeHistory;
 
     dispatch_semaphore_t _inFlightSemaphore{};
-    pxr::HgiUniquePtr _hgi;
-    std::unique_ptr<pxr::UsdImagingGLEngine> _engine;
     std::unique_ptr<Swapchain> _swapchain{};
 
+    uint64_t _frameIndex{0};
+    std::atomic<uint64_t> _completedFrameIndex{0};
+    AovReadback _aovReadback;
+    FrameCapture _frameCapture{_aovReadback};
+    IdBuffer _idBuffer{_aovReadback};
+    DepthProbe _depthProbe{_aovReadback};
+    Flipbook _flipbook{_aovReadback};
+    PlaybackLog _playbackLog;
+    PlaybackModes _playbackMode{PlaybackModes::REALTIME};
+    /// Set while the flipbook range is being rendered, to restart playback once it's done.
+    bool _flipbookRecording{false};
+    uint64_t _appliedDepthFrame{0};
+    /// Time to first pixel: from the stage being set to the GPU finishing its first frame.
+    int64_t _stageReplacedNs{-1};
+    uint64_t _firstPixelFrame{0};
+    std::atomic<int64_t> _firstPixelNs{-1};
+    double _textureBudgetTime{0.0};
+    double _refinementTime{0.0};
+    bool _refinementReduced{false};
+
     double _startTimeInSeconds{};
     double _timeCodesPerSecond{};
     double _startTimeCode{};
@@ -6,15 +6,18 @@
 
 #include "viewport.h"
 #include "camera.h"
+#include "../profiler.h"
 
 #include <pxr/pxr.h>
 #include <pxr/base/gf/camera.h>
+#include <pxr/base/gf/vec2f.h>
 #include <pxr/base/plug/plugin.h>
 #include <pxr/base/plug/registry.h>
 #include <pxr/usd/usd/prim.h>
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usdGeom/camera.h>
 #include <pxr/usd/usdGeom/metrics.h>
+#include <pxr/usd/usdGeom/tokens.h>
 #include <pxr/usd/sdf/fileFormat.h>
 #include <pxr/imaging/hgi/blitCmdsOps.h>
 #include <pxr/imaging/hgiMetal/hgi.h>
@@ -23,6 +26,8 @@
 #include <QResizeEvent>
 #include <QMimeData>
 #include <fmt/format.h>
+#include <filesystem>
+#include <set>
 
 using namespace pxr;
 
@@ -93,8 +98,8 @@ pxr::GfVec4i viewportMakeCenteredIntegral(pxr::GfVec4d viewport) {
 }// namespace
 
 //----------------------------------------------------------------------------------------------------------------------
-Viewport::Viewport(QWidget *parent, DataModel &model)
-    : QWidget{parent}, _model{model} {
+Viewport::Viewport(QWidget *parent, DataModel &model, RenderContext &context, bool primary)
+    : QWidget{parent}, _model{model}, _context{context}, _primary{primary} {
     setAcceptDrops(true);
     setAttribute(Qt::WA_NativeWindow);
     setAttribute(Qt::WA_PaintOnScreen);
@@ -103,26 +108,66 @@ Viewport::Viewport(QWidget *parent, DataModel &model)
     setAttribute(Qt::WA_DontCreateNativeAncestors);
     setAutoFillBackground(true);
 
-    initializeEngine();
+    _inFlightSemaphore = dispatch_semaphore_create(MaxBuffersInFlight);
     auto size = parent->contentsRect().size();
-    _swapchain = std::make_unique<Swapchain>((MTL::Device *)static_cast<HgiMetal *>(_hgi.get())->GetPrimaryDevice(),
+    _swapchain = std::make_unique<Swapchain>((MTL::Device *)static_cast<HgiMetal *>(_context.hgi())->GetPrimaryDevice(),
                                              winId(), size.width(), size.height());
 
     _startTimeInSeconds = 0;
 
     connect(&_model, &DataModel::signalStageReplaced, this, &Viewport::_stageReplaced);
+    connect(&_model.viewSettings(), &ViewSettingsDataModel::signalVisibleSettingChanged,
+            this, &Viewport::_markRenderStateDirty);
+    connect(&_model.viewSettings(), &ViewSettingsDataModel::signalDefaultMaterialChanged,
+            this, &Viewport::_markRenderStateDirty);
+    connect(&_model.viewSettings(), &ViewSettingsDataModel::signalSettingChanged, this, [this]() {
+        setRolloverPicking(_model.viewSettings().rolloverPrimInfo());
+        if (!_primary) {
+            return;
+        }
+        _model.framePrefetcher().setDepth(_model.viewSettings().playbackPrefetchFrames());
+        _updateFlipbookSettings();
+        // Counts from one mode mean nothing in the other.
+        if (_playbackMode != _model.viewSettings().playbackMode()) {
+            _playbackMode = _model.viewSettings().playbackMode();
+            _playbackLog.clear();
+        }
+    });
+    setRolloverPicking(_model.viewSettings().rolloverPrimInfo());
+    _playbackMode = _model.viewSettings().playbackMode();
+    if (_primary) {
+        _model.framePrefetcher().setDepth(_model.viewSettings().playbackPrefetchFrames());
+        _updateFlipbookSettings();
+    }
+    connect(&_context, &RenderContext::signalEngineRebuilt, this, &Viewport::_engineReplaced);
+    connect(&_model, &DataModel::signalPrimsChanged, this, [this](ChangeNotice, ChangeNotice) {
+        _idBuffer.invalidate();
+        _depthProbe.invalidate();
+        _flipbook.invalidate();
+    });
+    // A view added after the stage was set starts on it right away.
+    if (_model.stage() && _context.engine(this)) {
+        _stageReplaced();
+    }
 }
 
-/// Initializes the Storm engine.
-void Viewport::initializeEngine() {
-    _inFlightSemaphore = dispatch_semaphore_create(MaxBuffersInFlight);
-    _hgi = Hgi::CreatePlatformDefaultHgi();
+Viewport::~Viewport() {
+    // Completion handlers of frames in flight still signal this view's semaphore.
+    for (uint32_t i = 0; i < MaxBuffersInFlight; ++i) {
+        dispatch_semaphore_wait(_inFlightSemaphore, DISPATCH_TIME_FOREVER);
+    }
+    // Libdispatch refuses to free a semaphore below its initial count.
+    for (uint32_t i = 0; i < MaxBuffersInFlight; ++i) {
+        dispatch_semaphore_signal(_inFlightSemaphore);
+    }
+    _context.release(this);
 }
 
 void Viewport::resizeEvent(QResizeEvent *event) {
     QWidget::resizeEvent(event);
     auto display_size = computeWindowSize();
     _swapchain->resize(display_size[0], display_size[1]);
+    _swapchain->makeCurrent();
 
     auto display_w = display_size[0];
     auto display_h = display_size[1];
@@ -143,6 +188,17 @@ pxr::UsdTimeCode Viewport::updateTime() {
         _startTimeInSeconds = currentTimeInSeconds;
     }
 
+    if (_model.viewSettings().playbackMode() == PlaybackModes::EVERY_FRAME) {
+        // Steps one time code per frame, however long rendering takes.
+        double timeCode = _model.currentFrame().IsDefault() ? _startTimeCode : _model.currentFrame().GetValue() + 1.0;
+        if (timeCode > _endTimeCode || timeCode < _startTimeCode) {
+            timeCode = _startTimeCode;
+        }
+        // Keeps the clock in step, so realtime playback resumes from here.
+        _startTimeInSeconds = currentTimeInSeconds - (timeCode - _startTimeCode) / std::max(_timeCodesPerSecond, 1e-6);
+        return std::floor(timeCode);
+    }
+
     // Calculate the elapsed time in seconds from the start.
     double elapsedTimeInSeconds = currentTimeInSeconds - _startTimeInSeconds;
 
@@ -152,6 +208,10 @@ pxr::UsdTimeCode Viewport::updateTime() {
         timeCode = _startTimeCode;
         _startTimeInSeconds = currentTimeInSeconds;
     }
+    // Flipbook frames are whole time codes, so playback steps through them.
+    if (_model.viewSettings().flipbook()) {
+        timeCode = _startTimeCode + std::floor(timeCode - _startTimeCode);
+    }
 
     return timeCode;
 }
@@ -159,44 +219,138 @@ pxr::UsdTimeCode Viewport::updateTime() {
 /// Draw the scene, and blit the result to the view.
 /// Returns false if the engine wasn't initialized.
 void Viewport::draw() {
-    if (!_model.stage()) {
+    if (!_model.stage() || !_context.engine(this)) {
         // error has already been issued
         return;
     }
+    VOX_PROFILE_SCOPE("frame");
+
+    _aovReadback.poll(_completedFrameIndex.load());
+    _applyDepthProbe();
 
     auto drawable = _swapchain->nextDrawable();
     if (drawable) {
-        auto timeCode = updateTime();
-        _model.setCurrentFrame(timeCode);
+        auto flipbook = _primary && _model.viewSettings().flipbook();
+        pxr::UsdTimeCode timeCode = _model.currentFrame();
+        if (_primary) {
+            VOX_PROFILE_SCOPE("updateTime");
+            timeCode = updateTime();
+            if (flipbook) {
+                // The range is rendered once frame by frame, then played back from the start.
+                if (auto missing = _flipbook.nextMissing()) {
+                    timeCode = *missing;
+                    _flipbookRecording = true;
+                } else if (_flipbookRecording && _flipbook.isComplete()) {
+                    _flipbookRecording = false;
+                    _startTimeInSeconds = getCurrentTimeInSeconds();
+                    timeCode = _startTimeCode;
+                }
+            }
+            _playbackLog.beginFrame(timeCode.GetValue(), _startTimeCode, _endTimeCode);
+            _model.setCurrentFrame(timeCode);
+            _pickIndex.setTime(timeCode);
+        }
+        // Resolved once per frame, at the frame's time; the filters, the flipbook and Hydra share it.
+        pxr::GfCamera gfCamera;
+        float cameraAspect;
+        {
+            VOX_PROFILE_SCOPE("resolveCamera");
+            std::tie(gfCamera, cameraAspect) = resolveCamera();
+        }
+        if (_primary) {
+            auto frustum = gfCamera.GetFrustum();
+            auto viewProjection = frustum.ComputeViewMatrix() * frustum.ComputeProjectionMatrix();
+            // Authors to the session layer, so it has to run before the prefetch workers start.
+            _updateTextureBudget(viewProjection);
+            _updateScreenSizeLod(viewProjection);
+            _updateAdaptiveRefinement(viewProjection);
+        }
 
         ImGuiIO &io = ImGui::GetIO();
         const QPoint pos = mapFromGlobal(QCursor::pos());
         io.MousePos = ImVec2(pos.x(), pos.y());
 
         // Start the next frame.
-        dispatch_semaphore_wait(_inFlightSemaphore, DISPATCH_TIME_FOREVER);
-        auto *hgi = static_cast<HgiMetal *>(_hgi.get());
+        {
+            VOX_PROFILE_SCOPE("waitForFrame");
+            dispatch_semaphore_wait(_inFlightSemaphore, DISPATCH_TIME_FOREVER);
+        }
+        auto *hgi = static_cast<HgiMetal *>(_context.hgi());
         hgi->StartFrame();
 
         // Draw the scene hud
-        drawHUD();
-        // Draw the scene using Hydra, and recast the result to a MTLTexture.
-        HgiTextureHandle hgiTexture = drawWithHydra();
-        auto texture = static_cast<HgiMetalTexture *>(hgiTexture.Get())->GetTextureId();
+        {
+            VOX_PROFILE_SCOPE("drawHUD");
+            drawHUD();
+        }
+        auto frameIndex = ++_frameIndex;
+        MTL::Texture *texture = nullptr;
+        if (flipbook) {
+            VOX_PROFILE_SCOPE("flipbook");
+            texture = _flipbook.texture((MTL::Device *)hgi->GetPrimaryDevice(), _aovView(), frameIndex);
+        }
+        auto cached = texture != nullptr;
+        // Part of the texture this view rendered into.
+        pxr::GfVec2f imageScale{1.f};
+
+        if (!texture) {
+            // Upcoming frames are resolved on worker threads while Hydra syncs this one. Realtime
+            // playback lands between time codes, where the whole frames prefetched never match.
+            if (_primary && (flipbook || _playbackMode == PlaybackModes::EVERY_FRAME)) {
+                _model.framePrefetcher().prefetch(timeCode.GetValue(), _startTimeCode, _endTimeCode);
+            }
+
+            // Draw the scene using Hydra, and recast the result to a MTLTexture.
+            HgiTextureHandle hgiTexture = drawWithHydra(gfCamera, cameraAspect);
+            if (_firstPixelFrame == 0) {
+                _firstPixelFrame = frameIndex;
+            }
+            texture = (MTL::Texture *)static_cast<HgiMetalTexture *>(hgiTexture.Get())->GetTextureId();
+            auto region = _aovReadback.region();
+            imageScale = {float(region[0]) / float(texture->width()), float(region[1]) / float(texture->height())};
+
+            // Copies for pending captures are encoded before the frame is committed.
+            if (_frameCapture.wantsFrame(timeCode)) {
+                _frameCapture.readback(hgi, frameIndex, timeCode, hgiTexture,
+                                       _context.engine(this)->GetAovTexture(HdAovTokens->depth));
+            }
+            _serviceRollover(hgi, frameIndex);
+            _serviceRegionSelect(hgi, frameIndex);
+            _requestDepthProbe(hgi, frameIndex);
+            if (flipbook) {
+                _flipbook.record(hgi, frameIndex, _aovView(), hgiTexture);
+            }
+        }
 
         // Create a command buffer to blit the texture to the view.
         id<MTLCommandBuffer> commandBuffer = hgi->GetPrimaryCommandBuffer();
         __block dispatch_semaphore_t blockSemaphore = _inFlightSemaphore;
+        std::atomic<uint64_t> *completedFrameIndex = &_completedFrameIndex;
+        std::atomic<int64_t> *firstPixelNs = frameIndex == _firstPixelFrame ? &_firstPixelNs : nullptr;
         [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> buffer) {
+            if (firstPixelNs) {
+                firstPixelNs->store(Profiler::now());
+            }
+            completedFrameIndex->store(frameIndex);
             dispatch_semaphore_signal(blockSemaphore);
         }];
 
         // Copy the rendered texture to the view.
-        _swapchain->present(drawable, (MTL::CommandBuffer *)(commandBuffer), (MTL::Texture *)(texture));
+        VOX_PROFILE_SCOPE("present");
+        _swapchain->present(drawable, (MTL::CommandBuffer *)(commandBuffer), texture, imageScale[0], imageScale[1]);
 
         // Tell Hydra to commit the command buffer, and complete the work.
         hgi->CommitPrimaryCommandBuffer();
         hgi->EndFrame();
+        if (_primary) {
+            _playbackLog.endFrame(cached);
+        }
+
+        // The stage may be edited once control returns to the event loop.
+        {
+            VOX_PROFILE_SCOPE("waitForPrefetch");
+            _model.framePrefetcher().wait();
+        }
     }
 }
 
@@ -213,12 +367,87 @@ std::string reportMetricSize(long double sizeInBytes) {
     return fmt::format("{:.2f} {}", sizeInBytes / p, sizeSuffixes[i]);
 }
 void Viewport::drawHUD() {
+    _framerate.record();
     if (_model.viewSettings().showHUD()) {
-        auto stats = _engine->GetRenderStats();
+        auto stats = _context.engine(this)->GetRenderStats();
 
         ImGui::Begin("Scene Info");
-        _framerate.record();
         ImGui::Text("%s", fmt::format("Display - {:.1f} fps", _framerate.report()).c_str());
+        if (auto firstPixelNs = _firstPixelNs.load(); firstPixelNs >= 0 && _stageReplacedNs >= 0) {
+            ImGui::Text("%s", fmt::format("First frame - {:.0f} ms", double(firstPixelNs - _stageReplacedNs) * 1e-6).c_str());
+        }
+        if (_dynamicResolution.scale() < 1.f) {
+            ImGui::Text("%s", fmt::format("Resolution scale - {:.0f}%", _dynamicResolution.scale() * 100).c_str());
+        }
+        if (_primary && _endTimeCode > _startTimeCode) {
+            if (_playbackMode == PlaybackModes::EVERY_FRAME) {
+                ImGui::Text("%s", fmt::format("Playback - every frame, {:.1f} / {:.1f} fps",
+                                              _playbackLog.achievedFps(), _timeCodesPerSecond).c_str());
+            } else {
+                auto shown = _playbackLog.frames();
+                auto dropped = _playbackLog.dropped();
+                ImGui::Text("%s", fmt::format("Playback - realtime, {} dropped ({:.1f}%)", dropped,
+                                              shown + dropped ? 100.0 * double(dropped) / double(shown + dropped) : 0.0).c_str());
+            }
+        }
+        if (_primary && _model.viewSettings().flipbook()) {
+            auto flipbookStats = _flipbook.stats();
+            ImGui::Text("%s", fmt::format("Flipbook - {} / {} frames, {} in memory, {} on disk",
+                                          flipbookStats.cachedFrames, flipbookStats.frameCount,
+                                          reportMetricSize((long double)flipbookStats.memoryBytes),
+                                          reportMetricSize((long double)flipbookStats.diskBytes)).c_str());
+        }
+        auto &texturePrefetcher = _model.texturePrefetcher();
+        if (texturePrefetcher.active()) {
+            ImGui::Text("%s", fmt::format("Texture prefetch - {} / {} files, {}", texturePrefetcher.readCount(),
+                                          texturePrefetcher.textureCount(),
+                                          reportMetricSize((long double)texturePrefetcher.bytesRead())).c_str());
+        }
+        if (auto &textureBudget = _model.textureBudget(); _primary && textureBudget.budget() > 0) {
+            // Storm reports what its texture objects hold, dome light textures included.
+            auto resident = stats.find("textureMemory");
+            auto residentBytes = resident != stats.end() && resident->second.IsHolding<ulong>() ? resident->second.Get<ulong>() : 0;
+            ImGui::Text("%s", fmt::format("Textures - {} resident, {} requested / {} budget",
+                                          reportMetricSize((long double)residentBytes),
+                                          reportMetricSize((long double)textureBudget.requestedBytes()),
+                                          reportMetricSize((long double)textureBudget.budget())).c_str());
+        }
+        if (auto *meshMerging = _context.meshMerging(); meshMerging && meshMerging->batchCount() > 0) {
+            ImGui::Text("%s", fmt::format("Mesh merging - {} meshes in {} batches", meshMerging->mergedMeshCount(),
+                                          meshMerging->batchCount()).c_str());
+        }
+        if (auto *lod = _context.screenSizeLod(); lod && lod->modelCount() > 0) {
+            ImGui::Text("%s", fmt::format("LOD - {} of {} models as bounds, proxy or cards", lod->reducedCount(),
+                                          lod->modelCount()).c_str());
+        }
+        if (auto *refinement = _context.adaptiveRefinement(); refinement && refinement->meshCount() > 0) {
+            ImGui::Text("%s", fmt::format("Refinement - {} of {} meshes refined, {} triangles",
+                                          refinement->refinedCount(), refinement->meshCount(),
+                                          refinement->triangleCount()).c_str());
+        }
+        if (auto &instancing = _model.autoInstancer().stats(); instancing.instanced > 0) {
+            ImGui::Text("%s", fmt::format("Auto instancing - {} prims, {} prototypes, {} -> {} gprims",
+                                          instancing.instanced, instancing.prototypes,
+                                          instancing.gprimsBefore, instancing.gprimsAfter).c_str());
+        }
+        auto &prefetcher = _model.framePrefetcher();
+        if (prefetcher.valueCount() > 0) {
+            ImGui::Text("%s", fmt::format("Viewer prefetch - {} values, {} hits / {} misses", prefetcher.valueCount(),
+                                          prefetcher.hits(), prefetcher.misses()).c_str());
+        }
+
+        // Frame time distribution; averages hide hitches.
+        ImGui::SliderInt("Window", &_frameStatsWindow, 10, int(_framerate.capacity()));
+        auto frameStats = _framerate.statistics(_frameStatsWindow);
+        ImGui::Text("%s", fmt::format("p50 {:.1f}  p95 {:.1f}  p99 {:.1f}  max {:.1f} ms",
+                                      frameStats.p50 * 1e3, frameStats.p95 * 1e3,
+                                      frameStats.p99 * 1e3, frameStats.max * 1e3).c_str());
+        ImGui::Text("%s", fmt::format("Over {:.1f} ms: {} / {} (total {})", _framerate.budget() * 1e3,
+                                      frameStats.overBudget, frameStats.count, _framerate.totalOverBudget()).c_str());
+        _framerate.history(_frameTimeHistory, _frameStatsWindow);
+        ImGui::PlotLines("##FrameTimes", _frameTimeHistory.data(), int(_frameTimeHistory.size()), 0,
+                         "frame time (ms)", 0.f, float(std::max(frameStats.max, 2 * _framerate.budget()) * 1e3),
+                         ImVec2(0, 60));
         ImGui::Separator();
         for (const auto &stat : stats) {
             ImGui::Text("%s: ", stat.first.c_str());
@@ -230,39 +459,222 @@ void Viewport::drawHUD() {
 
         ImGui::End();
     }
+
+    // Selection region being dragged, in logical pixels.
+    if (_regionActive && _regionPoints.size() >= 2) {
+        auto scale = float(1.0 / devicePixelRatioF());
+        auto *drawList = ImGui::GetForegroundDrawList();
+        const auto fill = IM_COL32(255, 255, 255, 32);
+        const auto outline = IM_COL32(255, 255, 255, 200);
+        if (_model.viewSettings().regionSelectMode() == RegionSelectModes::LASSO) {
+            std::vector<ImVec2> points;
+            points.reserve(_regionPoints.size());
+            for (const auto &point : _regionPoints) {
+                points.emplace_back(float(point[0]) * scale, float(point[1]) * scale);
+            }
+            drawList->AddPolyline(points.data(), int(points.size()), outline, ImDrawFlags_Closed, 1.f);
+        } else {
+            const auto &start = _regionPoints.front();
+            const auto &end = _regionPoints.back();
+            ImVec2 min(float(std::min(start[0], end[0])) * scale, float(std::min(start[1], end[1])) * scale);
+            ImVec2 max(float(std::max(start[0], end[0])) * scale, float(std::max(start[1], end[1])) * scale);
+            drawList->AddRectFilled(min, max, fill);
+            drawList->AddRect(min, max, outline);
+        }
+    }
 }
 
 /// Draws the scene using Hydra.
-pxr::HgiTextureHandle Viewport::drawWithHydra() {
+pxr::HgiTextureHandle Viewport::drawWithHydra(const pxr::GfCamera &gfCamera, float cameraAspect) {
     // Camera projection setup.
-    auto [gfCamera, cameraAspect] = resolveCamera();
     auto frustum = gfCamera.GetFrustum();
     auto viewport = computeWindowViewport();
     if (hasLockedAspectRatio()) {
         viewport = computeCameraViewport(cameraAspect);
     }
 
-    auto renderBufferSize = computeWindowSize();
-    _engine->SetRenderBufferSize(renderBufferSize);
-    _engine->SetFraming(_computeCameraFraming(viewport, renderBufferSize));
-    _engine->SetWindowPolicy(computeWindowPolicy(cameraAspect));
+    // Render at a reduced resolution while navigating; the swapchain blit upscales.
+    auto &viewSettings = _model.viewSettings();
+    if (viewSettings.enableDynamicResolution()) {
+        _dynamicResolution.setTargetFrameTime(1.0 / std::max(1.f, viewSettings.targetInteractiveFps()));
+        _dynamicResolution.update(_framerate.lastFrameTime(), isInteracting());
+    } else {
+        _dynamicResolution.reset();
+    }
+    // Views overriding the draw mode render with an engine of that mode.
+    _context.setRenderMode(this, _renderMode != viewSettings.renderMode() ? _renderMode : std::nullopt);
+    // The AOVs fit the largest view of the engine; this one renders into the corner its scaled window covers.
+    auto windowSize = computeWindowSize();
+    auto renderBufferSize = _context.renderBufferSize(this, windowSize);
+    viewport = _dynamicResolution.scaled(viewport);
+    _aovReadback.setRegion(_dynamicResolution.scaled(windowSize));
+    _makeCurrent();
+    auto framing = _computeCameraFraming(viewport, renderBufferSize);
+    auto windowPolicy = computeWindowPolicy(cameraAspect);
+    // Buffer and framing changes invalidate Hydra state, only push them when they differ.
+    if (_pushedRenderBufferSize != renderBufferSize) {
+        _context.engine(this)->SetRenderBufferSize(renderBufferSize);
+        _pushedRenderBufferSize = renderBufferSize;
+    }
+    if (_pushedFraming != framing) {
+        _context.engine(this)->SetFraming(framing);
+        _pushedFraming = framing;
+    }
+    if (_pushedWindowPolicy != windowPolicy) {
+        _context.engine(this)->SetWindowPolicy(windowPolicy);
+        _pushedWindowPolicy = windowPolicy;
+    }
 
     auto sceneCam = getActiveSceneCamera();
     if (sceneCam) {
-        _engine->SetCameraPath(sceneCam->GetPath());
+        _context.engine(this)->SetCameraPath(sceneCam->GetPath());
     } else {
-        _engine->SetCameraState(frustum.ComputeViewMatrix(),
+        _context.engine(this)->SetCameraState(frustum.ComputeViewMatrix(),
                                 frustum.ComputeProjectionMatrix());
     }
 
+    auto renderStateChanged = _renderStateDirty;
+    if (_renderStateDirty) {
+        _updateRenderParams();
+        _context.engine(this)->SetSelectionColor(_model.viewSettings().highlightColor());
+        _context.engine(this)->SetRendererSetting(HdRenderSettingsTokens->domeLightCameraVisibility,
+                                    pxr::VtValue(_model.viewSettings().domeLightTexturesVisible()));
+        _renderStateDirty = false;
+    }
+    // The camera light follows the camera, so it also has to be pushed when the camera moves.
     auto cam_pos = frustum.GetPosition();
+    auto cameraLightMoved = _model.viewSettings().ambientLightOnly() && _pushedLightPosition != cam_pos;
+    if (renderStateChanged || cameraLightMoved) {
+        VOX_PROFILE_SCOPE("SetLightingState");
+        _updateLightingState(cam_pos);
+    }
+
+    auto highlightMode = _model.viewSettings().selHighlightMode();
+    bool drawSelHighlights;
+    if (_model.playing()) {
+        // Highlight mode must be ALWAYS to draw highlights during playback.
+        drawSelHighlights = highlightMode == SelectionHighlightModes::ALWAYS;
+    } else {
+        // Highlight mode can be ONLY_WHEN_PAUSED or ALWAYS to draw
+        // highlights when paused.
+        drawSelHighlights = highlightMode != SelectionHighlightModes::NEVER;
+    }
+
+    // update per-frame rendering parameters
+    _renderParams.frame = _model.currentFrame();
+    _renderParams.forceRefresh = _forceRefresh;
+    _renderParams.highlight = drawSelHighlights;
+    {
+        VOX_PROFILE_SCOPE("processBBoxes");
+        _processBBoxes();
+    }
+
+    // Render the frame.
+    {
+        VOX_PROFILE_SCOPE("Render");
+        TfErrorMark mark;
+        _context.engine(this)->Render(_model.stage()->GetPseudoRoot(), _renderParams);
+        TF_VERIFY(mark.IsClean(), "Errors occurred while rendering!");
+    }
+
+    // Return the color output.
+    return _context.engine(this)->GetAovTexture(HdAovTokens->color);
+}
+
+void Viewport::_makeCurrent() {
+    if (_context.makeCurrent(this)) {
+        // Another view's framing, camera and lights are in the engine.
+        _pushedRenderBufferSize.reset();
+        _pushedFraming.reset();
+        _pushedWindowPolicy.reset();
+        _pushedLightPosition.reset();
+        _renderStateDirty = true;
+    }
+}
+
+void Viewport::_markRenderStateDirty() {
+    _renderStateDirty = true;
+    _idBuffer.invalidate();
+    _depthProbe.invalidate();
+    _flipbook.invalidate();
+}
+
+void Viewport::_updateTextureBudget(const pxr::GfMatrix4d &viewProjection) {
+    // Reloading textures mid-drag would stall the interaction it follows.
+    constexpr double UpdateIntervalSeconds = 0.5;
+    auto &budget = _model.textureBudget();
+    budget.setBudget(size_t(std::max(0.0, double(_model.viewSettings().textureMemoryBudget())) * double(1 << 30)));
+    auto now = getCurrentTimeInSeconds();
+    if (budget.budget() == 0 || isInteracting() || now - _textureBudgetTime < UpdateIntervalSeconds) {
+        return;
+    }
+    _textureBudgetTime = now;
+    budget.update(viewProjection, computeWindowSize());
+}
+
+void Viewport::_updateScreenSizeLod(const pxr::GfMatrix4d &viewProjection) {
+    auto *lod = _context.screenSizeLod();
+    if (!lod) {
+        return;
+    }
+    auto &modelBounds = _model.modelBounds();
+    auto threshold = _model.viewSettings().lodScreenSize();
+    // Bounds are only computed once the filter is used.
+    static const std::vector<ModelBoundsCache::ModelBounds> none;
+    const auto &components = threshold > 0.f ? modelBounds.components() : none;
+    lod->update(components, modelBounds.version(), viewProjection, computeWindowSize(), threshold);
+}
+
+void Viewport::_updateAdaptiveRefinement(const pxr::GfMatrix4d &viewProjection) {
+    auto *refinement = _context.adaptiveRefinement();
+    if (!refinement) {
+        return;
+    }
+    // Refining a mesh again rebuilds its topology, so levels follow the camera a few times a second.
+    constexpr double UpdateIntervalSeconds = 0.25;
+    auto budget = size_t(std::max(0.0, double(_model.viewSettings().refinementTriangleBudget())) * 1e6);
+    // The complexity setting is the finest level, as UsdImaging maps it: 1.0 is level 0, each 0.1 one more.
+    auto maxLevel = int((_model.viewSettings().complexity().value() + 0.01f - 1.f) * 10.f);
+    // Moving and playing get a level less and a quarter of the budget, restored when the view settles.
+    auto reduced = _model.playing() || isInteracting();
+    if (reduced) {
+        maxLevel -= 1;
+        budget = budget > 0 ? std::max<size_t>(budget / 4, 1) : 0;
+    }
+    auto now = getCurrentTimeInSeconds();
+    if (budget > 0 && reduced == _refinementReduced && now - _refinementTime < UpdateIntervalSeconds) {
+        return;
+    }
+    _refinementTime = now;
+    _refinementReduced = reduced;
+    refinement->update(viewProjection, computeWindowSize(), maxLevel, budget);
+}
+
+void Viewport::_updateFlipbookSettings() {
+    auto &viewSettings = _model.viewSettings();
+    _flipbook.setMemoryBudget(size_t(std::max(0.0, double(viewSettings.flipbookMemoryBudget())) * double(1 << 30)));
+    std::string spillDirectory;
+    if (viewSettings.flipbookDiskSpill()) {
+        std::error_code error;
+        auto temp = std::filesystem::temp_directory_path(error);
+        if (!error) {
+            spillDirectory = (temp / "hydraviewer-flipbook").string();
+        }
+    }
+    _flipbook.setSpillDirectory(spillDirectory);
+    if (!viewSettings.flipbook()) {
+        _flipbook.invalidate();
+    }
+}
+
+void Viewport::_updateLightingState(const pxr::GfVec3d &cameraPosition) {
     pxr::GfVec4f sceneAmbient = GfVec4f(0.1f, 0.1f, 0.1f, 1.0f);
     pxr::GlfSimpleMaterial light_mat;
     GlfSimpleLightVector lights;
     if (_model.viewSettings().ambientLightOnly()) {
         auto l = pxr::GlfSimpleLight();
         l.SetAmbient({0, 0, 0, 0});
-        l.SetPosition({(float)cam_pos[0], (float)cam_pos[1], (float)cam_pos[2], 1});
+        l.SetPosition({(float)cameraPosition[0], (float)cameraPosition[1], (float)cameraPosition[2], 1});
         lights.push_back(l);
     }
 
@@ -280,27 +692,16 @@ pxr::HgiTextureHandle Viewport::drawWithHydra() {
     light_mat.SetAmbient(GfVec4f(kA, kA, kA, 1.0f));
     light_mat.SetSpecular(GfVec4f(kS, kS, kS, 1.0f));
     light_mat.SetShininess(32.0);
-    _engine->SetLightingState(lights, light_mat, sceneAmbient);
-
-    auto highlightMode = _model.viewSettings().selHighlightMode();
-    bool drawSelHighlights;
-    if (_model.playing()) {
-        // Highlight mode must be ALWAYS to draw highlights during playback.
-        drawSelHighlights = highlightMode == SelectionHighlightModes::ALWAYS;
-    } else {
-        // Highlight mode can be ONLY_WHEN_PAUSED or ALWAYS to draw
-        // highlights when paused.
-        drawSelHighlights = highlightMode != SelectionHighlightModes::NEVER;
-    }
+    _context.engine(this)->SetLightingState(lights, light_mat, sceneAmbient);
+    _pushedLightPosition = cameraPosition;
+}
 
-    // update rendering parameters
-    _renderParams.frame = _model.currentFrame();
+void Viewport::_updateRenderParams() {
     _renderParams.complexity = _model.viewSettings().complexity().value();
-    _renderParams.drawMode = _renderModeDict[_model.viewSettings().renderMode()];
+    _renderParams.drawMode = _renderModeDict[_renderMode.value_or(_model.viewSettings().renderMode())];
     _renderParams.showGuides = _model.viewSettings().displayGuide();
     _renderParams.showProxy = _model.viewSettings().displayProxy();
     _renderParams.showRender = _model.viewSettings().displayRender();
-    _renderParams.forceRefresh = _forceRefresh;
     _renderParams.cullStyle = _model.viewSettings().cullBackfaces() ?
                                   pxr::UsdImagingGLCullStyle::CULL_STYLE_BACK_UNLESS_DOUBLE_SIDED :
                                   pxr::UsdImagingGLCullStyle::CULL_STYLE_NOTHING;
@@ -308,7 +709,6 @@ pxr::HgiTextureHandle Viewport::drawWithHydra() {
     _renderParams.gammaCorrectColors = false;
     _renderParams.enableIdRender = _model.viewSettings().displayPrimId();
     _renderParams.enableSampleAlphaToCoverage = !_model.viewSettings().displayPrimId();
-    _renderParams.highlight = drawSelHighlights;
     _renderParams.enableSceneMaterials = _model.viewSettings().enableSceneMaterials();
     _renderParams.enableSceneLights = _model.viewSettings().enableSceneLights();
     _renderParams.clearColor = _model.viewSettings().clearColor();
@@ -320,32 +720,18 @@ pxr::HgiTextureHandle Viewport::drawWithHydra() {
         _renderParams.ocioView = pxr::TfToken(_model.viewSettings().ocioSettings().view());
         _renderParams.ocioColorSpace = pxr::TfToken(_model.viewSettings().ocioSettings().colorSpace());
     }
-    auto pseudoRoot = _model.stage()->GetPseudoRoot();
-
-    _engine->SetSelectionColor(_model.viewSettings().highlightColor());
-    _engine->SetRendererSetting(HdRenderSettingsTokens->domeLightCameraVisibility,
-                                pxr::VtValue(_model.viewSettings().domeLightTexturesVisible()));
-    _processBBoxes();
-
-    // Render the frame.
-    TfErrorMark mark;
-    _engine->Render(_model.stage()->GetPseudoRoot(), _renderParams);
-    TF_VERIFY(mark.IsClean(), "Errors occurred while rendering!");
-
-    // Return the color output.
-    return _engine->GetAovTexture(HdAovTokens->color);
 }
 
 pxr::UsdImagingGLRendererSettingsList Viewport::rendererSettingLists() {
-    return _engine->GetRendererSettingsList();
+    return _context.engine(this)->GetRendererSettingsList();
 }
 
 pxr::VtValue Viewport::rendererSetting(pxr::TfToken const &id) {
-    return _engine->GetRendererSetting(id);
+    return _context.engine(this)->GetRendererSetting(id);
 }
 
 void Viewport::setRendererSetting(pxr::TfToken const &id, pxr::VtValue const &value) {
-    _engine->SetRendererSetting(id, value);
+    _context.setRendererSetting(id, value);
 }
 
 std::pair<pxr::GfCamera, float> Viewport::resolveCamera() {
@@ -353,10 +739,13 @@ std::pair<pxr::GfCamera, float> Viewport::resolveCamera() {
     auto sceneCam = getActiveSceneCamera();
     pxr::GfCamera gfCam;
     if (sceneCam) {
-        gfCam = pxr::UsdGeomCamera(sceneCam.value()).GetCamera(_model.currentFrame());
+        gfCam = _model.attributeQueries().camera(sceneCam.value(), _model.currentFrame());
     } else {
         switchToFreeCamera();
-        gfCam = _model.viewSettings().freeCamera()->computeGfCamera(_bbox, autoClip());
+        // Conformed below to the window unless the aspect ratio is locked; the clipping range has to fit that frustum.
+        auto windowAspect = hasLockedAspectRatio() ? std::nullopt
+                                                   : std::optional<float>(float(size().width()) / std::max(1.f, float(size().height())));
+        gfCam = freeCamera()->computeGfCamera(_bbox, autoClip(), &_model.modelBounds(), windowAspect);
 
         if (hasLockedAspectRatio()) {
             // Copy the camera before calling ConformWindow so we don't
@@ -392,7 +781,22 @@ std::shared_ptr<FreeCamera> Viewport::_createNewFreeCamera(ViewSettingsDataModel
         viewSettings.freeCameraOverrideFar());
 }
 
+std::shared_ptr<FreeCamera> Viewport::freeCamera() {
+    return _primary ? _model.viewSettings().freeCamera() : _freeCamera;
+}
+
+void Viewport::setFreeCamera(std::shared_ptr<FreeCamera> camera) {
+    if (_primary) {
+        _model.viewSettings().setFreeCamera(std::move(camera));
+    } else {
+        _freeCamera = std::move(camera);
+    }
+}
+
 std::optional<pxr::UsdPrim> Viewport::getActiveSceneCamera() {
+    if (!_primary) {
+        return std::nullopt;
+    }
     auto cameraPrim = _model.viewSettings().cameraPrim();
     if (cameraPrim && cameraPrim->IsActive()) {
         return cameraPrim;
@@ -402,7 +806,7 @@ std::optional<pxr::UsdPrim> Viewport::getActiveSceneCamera() {
 
 void Viewport::switchToFreeCamera(bool computeAndSetClosestDistance) {
     auto &viewSettings = _model.viewSettings();
-    if (viewSettings.cameraPrim() != std::nullopt) {
+    if (_primary && viewSettings.cameraPrim() != std::nullopt) {
         std::shared_ptr<FreeCamera> freeCamera{};
         // cameraPrim may no longer be valid,; so use the last-computed gf camera
         if (_lastComputedGfCamera) {
@@ -431,17 +835,38 @@ void Viewport::switchToFreeCamera(bool computeAndSetClosestDistance) {
     }
 }
 
+bool Viewport::isInteracting() const {
+    // Wheel events are discrete, treat the wheel as active for a short while after each one.
+    constexpr double WheelInteractionSeconds = 0.25;
+    auto dragging = _dragActive && (_cameraMode == CameraMode::Tumble ||
+                                    _cameraMode == CameraMode::Truck ||
+                                    _cameraMode == CameraMode::Zoom);
+    return dragging || getCurrentTimeInSeconds() - _lastWheelTime < WheelInteractionSeconds;
+}
+
 bool Viewport::hasLockedAspectRatio() {
     return getActiveSceneCamera() || _model.viewSettings().lockFreeCameraAspect();
 }
 
 void Viewport::computeAndSetClosestDistance() {
-    if (!_model.viewSettings().freeCamera()) {
+    if (!freeCamera()) {
         return;
     }
     auto cameraFrustum = resolveCamera().first.GetFrustum();
+
+    // The last frame's depth is enough when it was rendered from this camera.
+    const auto &probeView = _depthProbe.view();
+    if (probeView && probeView->viewMatrix == cameraFrustum.ComputeViewMatrix() &&
+        probeView->time == _model.currentFrame()) {
+        if (auto point = _depthProbe.closestPoint()) {
+            freeCamera()->setClosestVisibleDistFromPoint(*point);
+            updateView();
+            return;
+        }
+    }
+
     auto trueFar = cameraFrustum.GetNearFar().GetMax();
-    auto smallNear = std::min(FreeCamera::defaultNear, _model.viewSettings().freeCamera()->_selSize / 10.f);
+    auto smallNear = std::min(FreeCamera::defaultNear, freeCamera()->_selSize / 10.f);
     cameraFrustum.SetNearFar(pxr::GfRange1d(smallNear, smallNear * FreeCamera::maxSafeZResolution));
     auto pickResults = pick(cameraFrustum);
     if (!pickResults.has_value() || pickResults->outHitPrimPath == pxr::SdfPath::EmptyPath()) {
@@ -450,7 +875,7 @@ void Viewport::computeAndSetClosestDistance() {
     }
 
     if (pickResults.has_value() && pickResults->outHitPrimPath != pxr::SdfPath::EmptyPath()) {
-        _model.viewSettings().freeCamera()->setClosestVisibleDistFromPoint(pickResults->outHitPoint);
+        freeCamera()->setClosestVisibleDistFromPoint(pickResults->outHitPoint);
         updateView();
     }
 }
@@ -486,7 +911,7 @@ void Viewport::resetCam(float frameFit) {
     auto validFrameRange = (!_selectionBrange.IsEmpty() && _selectionBrange.GetMax() != _selectionBrange.GetMin());
     if (validFrameRange) {
         switchToFreeCamera(false);
-        _model.viewSettings().freeCamera()->frameSelection(_selectionBBox, frameFit);
+        freeCamera()->frameSelection(_selectionBBox, frameFit);
         if (_model.viewSettings().autoComputeClippingPlanes()) {
             computeAndSetClosestDistance();
         }
@@ -550,48 +975,319 @@ pxr::GfVec4i Viewport::computeWindowViewport() {
     return {0, 0, size[0], size[1]};
 }
 
+void Viewport::_selectRegion(Qt::KeyboardModifiers modifiers) {
+    if (!_model.stage() || _regionPoints.size() < 2) {
+        return;
+    }
+    VOX_PROFILE_SCOPE("selectRegion");
+
+    auto lasso = _model.viewSettings().regionSelectMode() == RegionSelectModes::LASSO && _regionPoints.size() > 2;
+    if (!lasso) {
+        _regionPoints = {_regionPoints.front(), _regionPoints.back()};
+    }
+    pxr::GfRange2d rect;
+    for (const auto &point : _regionPoints) {
+        rect.UnionWith(point);
+    }
+    auto center = rect.GetMidpoint();
+    auto halfSize = pxr::GfVec2d(std::max(rect.GetSize()[0], 1.0), std::max(rect.GetSize()[1], 1.0)) * 0.5;
+    auto frustum = computePickFrustum(center[0], center[1], halfSize[0] * 2.0, halfSize[1] * 2.0).second;
+
+    // Even-odd test against the lasso, in whatever space `polygon` is given.
+    auto insidePolygon = [](const std::vector<pxr::GfVec2d> &polygon, const pxr::GfVec2d &point) {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            const auto &a = polygon[i];
+            const auto &b = polygon[j];
+            if ((a[1] > point[1]) != (b[1] > point[1]) &&
+                point[0] < (b[0] - a[0]) * (point[1] - a[1]) / (b[1] - a[1]) + a[0]) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    };
+    PickIndex::RegionTest containsNdc;
+    std::function<bool(const pxr::GfVec2d &)> containsWindow;
+    if (lasso) {
+        // The region frustum maps the lasso's bounding rectangle to [-1, 1], y up.
+        std::vector<pxr::GfVec2d> ndcPolygon;
+        ndcPolygon.reserve(_regionPoints.size());
+        for (const auto &point : _regionPoints) {
+            ndcPolygon.emplace_back((point[0] - center[0]) / halfSize[0], (center[1] - point[1]) / halfSize[1]);
+        }
+        containsNdc = [ndcPolygon, insidePolygon](const pxr::GfVec2d &ndc) { return insidePolygon(ndcPolygon, ndc); };
+        containsWindow = [this, insidePolygon](const pxr::GfVec2d &point) { return insidePolygon(_regionPoints, point); };
+    }
+
+    std::vector<std::pair<pxr::SdfPath, int>> selected;
+    std::set<std::pair<pxr::SdfPath, int>> seen;
+    auto addHit = [&](const pxr::SdfPath &primPath, const pxr::SdfPath &instancerPath, int instanceIndex) {
+        auto entry = instancerPath.IsEmpty() ? std::make_pair(primPath, ALL_INSTANCES) : std::make_pair(instancerPath, instanceIndex);
+        if (seen.insert(entry).second) {
+            selected.push_back(std::move(entry));
+        }
+    };
+
+    _updatePickPurposes();
+    for (const auto &hit : _pickIndex.select(frustum, containsNdc)) {
+        addHit(hit.primPath, hit.instancerPath, hit.instanceIndex);
+    }
+    // Gprims the CPU index doesn't cover can still be found in the id buffer of the last frame.
+    if (_pickIndex.hasUnsupportedGprims() && _context.engine(this) && _idBuffer.isCurrent(_aovView())) {
+        for (const auto &hit : _idBuffer.collect(*_context.engine(this), rect, containsWindow)) {
+            // Merged meshes are made of meshes, which the CPU index already answered for.
+            if (auto *meshMerging = _context.meshMerging(); meshMerging && meshMerging->isMerged(hit.primPath)) {
+                continue;
+            }
+            addHit(hit.primPath, hit.instancerPath, hit.instanceIndex);
+        }
+    }
+    emit signalPrimsRegionSelected(std::move(selected), modifiers);
+}
+
+void Viewport::setRolloverPicking(bool enabled) {
+    if (enabled == _rolloverPicking) {
+        return;
+    }
+    _rolloverPicking = enabled;
+    setMouseTracking(enabled);
+    // A region being selected keeps the ids it reads back.
+    _context.setIdRenderOutputs(this, enabled || _regionActive || _pendingRegionSelect);
+    if (!enabled) {
+        _pendingRollover.reset();
+    }
+    if (!enabled && !_pendingRegionSelect) {
+        _idBuffer.invalidate();
+    }
+}
+
+void Viewport::setRenderMode(std::optional<RenderModes> mode) {
+    if (mode != _renderMode) {
+        _renderMode = mode;
+        _markRenderStateDirty();
+    }
+}
+
+void Viewport::grabFrameBuffer(const std::string &path, bool includeDepth) {
+    _frameCapture.grab(path, includeDepth);
+}
+
+void Viewport::captureSequence(const std::string &directory, int frameCount) {
+    _frameCapture.grabSequence(directory, frameCount);
+}
+
+void Viewport::_updatePickPurposes() {
+    auto &viewSettings = _model.viewSettings();
+    pxr::TfTokenVector purposes = {pxr::UsdGeomTokens->default_};
+    if (viewSettings.displayProxy()) {
+        purposes.push_back(pxr::UsdGeomTokens->proxy);
+    }
+    if (viewSettings.displayGuide()) {
+        purposes.push_back(pxr::UsdGeomTokens->guide);
+    }
+    if (viewSettings.displayRender()) {
+        purposes.push_back(pxr::UsdGeomTokens->render);
+    }
+    _pickIndex.setIncludedPurposes(purposes);
+}
+
 std::optional<Viewport::PickResult> Viewport::pick(const pxr::GfFrustum &pickFrustum) {
     if (!_model.stage()) {
         // error has already been issued
         return {};
     }
 
-    // Need a correct OpenGL Rendering context for FBOs
-    //   makeCurrent();
+    _updatePickPurposes();
+
+    // Limit the ray to the frustum's near/far range, measured along the view direction.
+    auto ray = pickFrustum.ComputeRay(pxr::GfVec2d(0, 0));
+    auto viewDir = pickFrustum.ComputeViewDirection();
+    auto cosine = std::max(1e-6, pxr::GfDot(ray.GetDirection().GetNormalized(), viewDir));
+    auto startDepth = pxr::GfDot(ray.GetStartPoint() - pickFrustum.GetPosition(), viewDir);
+    auto nearFar = pickFrustum.GetNearFar();
+    auto hit = _pickIndex.intersect(ray, (nearFar.GetMin() - startDepth) / cosine,
+                                    (nearFar.GetMax() - startDepth) / cosine);
+    std::optional<PickResult> meshResult;
+    if (hit) {
+        PickResult pickResult;
+        pickResult.outHitPoint = hit->point;
+        pickResult.outHitNormal = hit->normal;
+        pickResult.outHitPrimPath = hit->primPath;
+        pickResult.outHitInstancerPath = hit->instancerPath;
+        pickResult.outHitInstanceIndex = hit->instanceIndex;
+        meshResult = pickResult;
+    }
+    // Curves, points and other gprims the index doesn't hold may be in front of the mesh hit.
+    if (!_pickIndex.hasUnsupportedGprims() || !_context.engine(this)) {
+        return meshResult;
+    }
 
-    // update rendering parameters
-    _renderParams.frame = _model.currentFrame();
-    _renderParams.complexity = _model.viewSettings().complexity().value();
-    _renderParams.drawMode = _renderModeDict[_model.viewSettings().renderMode()];
-    _renderParams.showGuides = _model.viewSettings().displayGuide();
-    _renderParams.showProxy = _model.viewSettings().displayProxy();
-    _renderParams.showRender = _model.viewSettings().displayRender();
-    _renderParams.forceRefresh = _forceRefresh;
-    _renderParams.cullStyle = _model.viewSettings().cullBackfaces() ?
-                                  pxr::UsdImagingGLCullStyle::CULL_STYLE_BACK_UNLESS_DOUBLE_SIDED :
-                                  pxr::UsdImagingGLCullStyle::CULL_STYLE_NOTHING;
-    _renderParams.gammaCorrectColors = false;
-    _renderParams.enableIdRender = true;
-    _renderParams.enableSampleAlphaToCoverage = false;
-    _renderParams.enableSceneMaterials = _model.viewSettings().enableSceneMaterials();
-    _renderParams.enableSceneLights = _model.viewSettings().enableSceneLights();
+    // Picking renders ids with its own parameters, leave the cached display state alone.
+    if (_renderStateDirty) {
+        _updateRenderParams();
+    }
+    auto params = _renderParams;
+    params.frame = _model.currentFrame();
+    params.forceRefresh = _forceRefresh;
+    params.enableIdRender = true;
+    params.enableSampleAlphaToCoverage = false;
 
     PickResult pickResult;
-    auto result = _engine->TestIntersection(
+    auto result = _context.engine(this)->TestIntersection(
         pickFrustum.ComputeViewMatrix(),
         pickFrustum.ComputeProjectionMatrix(),
-        _model.stage()->GetPseudoRoot(), _renderParams,
+        _model.stage()->GetPseudoRoot(), params,
         &pickResult.outHitPoint, &pickResult.outHitNormal, &pickResult.outHitPrimPath,
         &pickResult.outHitInstancerPath, &pickResult.outHitInstanceIndex, &pickResult.outInstancerContext);
-    if (result) {
-        return pickResult;
-    } else {
-        return std::nullopt;
+    if (!result) {
+        return meshResult;
+    }
+    // The id render sees meshes too; whichever hit is nearer along the view direction wins.
+    if (meshResult && pxr::GfDot(meshResult->outHitPoint - pickFrustum.GetPosition(), viewDir) <=
+                          pxr::GfDot(pickResult.outHitPoint - pickFrustum.GetPosition(), viewDir)) {
+        return meshResult;
     }
+    pickResult.outHitPrimPath = _context.sourcePrim(pickResult.outHitPrimPath, pickResult.outHitPoint);
+    return pickResult;
+}
+
+std::pair<bool, pxr::GfFrustum> Viewport::computePickFrustum(qreal x, qreal y) {
+    return computePickFrustum(x, y, 1, 1);
+}
+
+std::pair<bool, pxr::GfFrustum> Viewport::computePickFrustum(qreal x, qreal y, qreal width, qreal height) {
+    // compute pick frustum
+    auto [gfCamera, cameraAspect] = resolveCamera();
+    auto cameraFrustum = gfCamera.GetFrustum();
+
+    auto viewport = computeWindowViewport();
+    if (hasLockedAspectRatio()) {
+        viewport = computeCameraViewport(cameraAspect);
+    }
+
+    // normalize position and pick size by the viewport size
+    auto point = pxr::GfVec2d((x - viewport[0]) / double(viewport[2]),
+                              (y - viewport[1]) / double(viewport[3]));
+    point[0] = (point[0] * 2.0 - 1.0);
+    point[1] = -1.0 * (point[1] * 2.0 - 1.0);
+
+    // half the region size, in normalized [-1, 1] units
+    auto size = pxr::GfVec2d(width / viewport[2], height / viewport[3]);
+
+    // "point" is normalized to the image viewport size, but if the image
+    // is cropped to the camera viewport, the image viewport won't fill the
+    // whole window viewport.  Clicking outside the image will produce
+    // normalized coordinates > 1 or < -1; in this case, we should skip
+    // picking.
+    auto inImageBounds = (abs(point[0]) <= 1.0 && abs(point[1]) <= 1.0);
+
+    return {inImageBounds, cameraFrustum.ComputeNarrowedFrustum(point, size)};
 }
 
 void Viewport::pickObject(qreal x, qreal y, Qt::MouseButton button, Qt::KeyboardModifiers modifiers) {
-    // todo
+    if (!_model.stage()) {
+        return;
+    }
+
+    auto [inImageBounds, pickFrustum] = computePickFrustum(x, y);
+
+    // If we're picking outside the image viewport (maybe because
+    // camera guides are on), treat that as a de-select.
+    PickResult result{{-1.0, -1.0, -1.0}, {}, pxr::SdfPath::EmptyPath(), pxr::SdfPath::EmptyPath(), -1, {}};
+    if (inImageBounds) {
+        if (auto hit = pick(pickFrustum)) {
+            result = hit.value();
+        }
+    }
+
+    if (button) {
+        emit signalPrimSelected(result.outHitPrimPath, result.outHitInstanceIndex, result.outHitInstancerPath,
+                                result.outInstancerContext, result.outHitPoint, button, modifiers);
+    } else {
+        emit signalPrimRollover(result.outHitPrimPath, result.outHitInstanceIndex, result.outHitInstancerPath,
+                                result.outInstancerContext, result.outHitPoint, modifiers);
+    }
+}
+
+AovView Viewport::_aovView() {
+    AovView view;
+    if (_lastComputedGfCamera) {
+        auto frustum = _lastComputedGfCamera->GetFrustum();
+        view.viewMatrix = frustum.ComputeViewMatrix();
+        view.projectionMatrix = frustum.ComputeProjectionMatrix();
+    }
+    view.time = _model.currentFrame();
+    view.windowSize = computeWindowSize();
+    view.viewport = hasLockedAspectRatio() ? computeCameraViewport(_lastAspectRatio) : computeWindowViewport();
+    return view;
+}
+
+void Viewport::_serviceRollover(pxr::Hgi *hgi, uint64_t frameIndex) {
+    if (!_pendingRollover || !_context.engine(this) || !_lastComputedGfCamera) {
+        return;
+    }
+    VOX_PROFILE_SCOPE("rollover");
+
+    auto view = _aovView();
+    if (_idBuffer.isCurrent(view)) {
+        auto query = *_pendingRollover;
+        _pendingRollover.reset();
+        auto hit = _idBuffer.lookup(*_context.engine(this), query.x, query.y);
+        hit.primPath = _context.sourcePrim(hit.primPath, hit.point);
+        emit signalPrimRollover(hit.primPath, hit.instanceIndex, hit.instancerPath, hit.instancerContext,
+                                hit.point, query.modifiers);
+    } else if (!_idBuffer.request(hgi, frameIndex, view, *_context.engine(this))) {
+        // The renderer has no id AOVs, fall back to picking.
+        auto query = *_pendingRollover;
+        _pendingRollover.reset();
+        pickObject(query.x, query.y, Qt::MouseButton::NoButton, query.modifiers);
+    }
+}
+
+void Viewport::_serviceRegionSelect(pxr::Hgi *hgi, uint64_t frameIndex) {
+    if (!_pendingRegionSelect) {
+        return;
+    }
+    auto view = _aovView();
+    auto *engine = _context.engine(this);
+    if (!engine || _idBuffer.isCurrent(view) || !_idBuffer.request(hgi, frameIndex, view, *engine)) {
+        // Without id AOVs only the CPU index answers.
+        _finishRegionSelect();
+    }
+}
+
+void Viewport::_finishRegionSelect() {
+    if (_pendingRegionSelect) {
+        _selectRegion(*_pendingRegionSelect);
+        _pendingRegionSelect.reset();
+    }
+    _regionPoints.clear();
+    _context.setIdRenderOutputs(this, _rolloverPicking);
+}
+
+void Viewport::_applyDepthProbe() {
+    auto camera = freeCamera();
+    if (_depthProbe.frameIndex() <= _appliedDepthFrame || !autoClip() || getActiveSceneCamera() || !camera) {
+        return;
+    }
+    _appliedDepthFrame = _depthProbe.frameIndex();
+    // Every range applied moves near and far; small moves would only keep the clipping planes creeping.
+    constexpr float Tolerance = 0.05f;
+    if (auto point = _depthProbe.closestPoint()) {
+        camera->setClosestVisibleDistFromPoint(*point, Tolerance);
+    }
+}
+
+void Viewport::_requestDepthProbe(pxr::Hgi *hgi, uint64_t frameIndex) {
+    if (!autoClip() || getActiveSceneCamera() || !_context.engine(this) || !_lastComputedGfCamera) {
+        return;
+    }
+    // Near and far are left out: they follow the probe, so comparing them would request a probe after every one applied.
+    auto view = _aovView();
+    const auto &probed = _depthProbe.view();
+    if (!probed || probed->time != view.time || !probed->sameFraming(view)) {
+        _depthProbe.request(hgi, frameIndex, view, _context.engine(this)->GetAovTexture(HdAovTokens->depth));
+    }
 }
 
 pxr::CameraUtilConformWindowPolicy Viewport::computeWindowPolicy(float cameraAspectRatio) {
@@ -637,10 +1333,21 @@ void Viewport::mousePressEvent(QMouseEvent *event) {
             _cameraMode = CameraMode::Zoom;
         }
     } else {
+        _swapchain->makeCurrent();
+        ImGuiIO &io = ImGui::GetIO();
         _cameraMode = CameraMode::Pick;
-        pickObject(x, y, event->button(), event->modifiers());
+        if (!io.WantCaptureMouse) {
+            if (event->button() == Qt::LeftButton) {
+                // A region still waiting for its ids is selected with what is there.
+                _finishRegionSelect();
+                // Picked on release, unless the press turns into a region drag.
+                _regionPoints = {pxr::GfVec2d(x, y)};
+                _regionActive = false;
+            } else {
+                pickObject(x, y, event->button(), event->modifiers());
+            }
+        }
 
-        ImGuiIO &io = ImGui::GetIO();
         io.MouseDown[0] = event->buttons() & Qt::LeftButton;
         io.MouseDown[1] = event->buttons() & Qt::MiddleButton;
         io.MouseDown[2] = event->buttons() & Qt::RightButton;
@@ -650,9 +1357,24 @@ void Viewport::mousePressEvent(QMouseEvent *event) {
 }
 
 void Viewport::mouseReleaseEvent(QMouseEvent *event) {
+    if (_cameraMode == CameraMode::Pick && !_regionPoints.empty()) {
+        if (!_regionActive) {
+            const auto &point = _regionPoints.front();
+            pickObject(point[0], point[1], Qt::LeftButton, event->modifiers());
+            _regionPoints.clear();
+        } else if (_pickIndex.hasUnsupportedGprims()) {
+            // Gprims the CPU index can't represent are only in the id buffer; the next frame reads it back.
+            _pendingRegionSelect = event->modifiers();
+        } else {
+            _selectRegion(event->modifiers());
+            _regionPoints.clear();
+        }
+        _regionActive = false;
+    }
     _cameraMode = CameraMode::None;
     _dragActive = false;
 
+    _swapchain->makeCurrent();
     ImGuiIO &io = ImGui::GetIO();
     io.MouseDown[0] = event->buttons() & Qt::LeftButton;
     io.MouseDown[1] = event->buttons() & Qt::MiddleButton;
@@ -670,7 +1392,23 @@ void Viewport::mouseMoveEvent(QMouseEvent *event) {
             return;
         }
 
-        auto freeCam = _model.viewSettings().freeCamera();
+        if (_cameraMode == CameraMode::Pick && !_regionPoints.empty()) {
+            // A few pixels of travel turn the click into a region drag.
+            constexpr double DragThreshold = 4.0;
+            auto point = pxr::GfVec2d(x, y);
+            if (!_regionActive && (point - _regionPoints.front()).GetLength() >= DragThreshold * devicePixelRatioF()) {
+                _regionActive = true;
+                if (_pickIndex.hasUnsupportedGprims()) {
+                    // The frames drawn during the drag render the ids the release reads back.
+                    _context.setIdRenderOutputs(this, true);
+                }
+            }
+            if (_regionActive && (point - _regionPoints.back()).GetLength() >= devicePixelRatioF()) {
+                _regionPoints.push_back(point);
+            }
+        }
+
+        auto freeCam = freeCamera();
         if (_cameraMode == CameraMode::Tumble) {
             freeCam->Tumble(0.25f * dx, 0.25f * dy);
         } else if (_cameraMode == CameraMode::Zoom) {
@@ -687,7 +1425,7 @@ void Viewport::mouseMoveEvent(QMouseEvent *event) {
             auto height = float(size().height());
             auto pixelsToWorld = freeCam->ComputePixelsToWorldFactor(height);
 
-            _model.viewSettings().freeCamera()->Truck(
+            freeCamera()->Truck(
                 -dx * pixelsToWorld,
                 dy * pixelsToWorld);
         }
@@ -699,14 +1437,17 @@ void Viewport::mouseMoveEvent(QMouseEvent *event) {
     } else if (_cameraMode == CameraMode::None) {
         // Mouse tracking is only enabled when rolloverPicking is enabled,
         // and this function only gets called elsewise when mouse-tracking
-        // is enabled
-        pickObject(event->position().x(), event->position().x(), Qt::MouseButton::NoButton, event->modifiers());
+        // is enabled. The query is answered by the next draw.
+        if (_rolloverPicking) {
+            _pendingRollover = RolloverQuery{x, y, event->modifiers()};
+        }
     } else {
         event->ignore();
     }
 }
 
 void Viewport::wheelEvent(QWheelEvent *event) {
+    _swapchain->makeCurrent();
     ImGuiIO &io = ImGui::GetIO();
 
     if (io.WantCaptureMouse) {
@@ -728,24 +1469,51 @@ void Viewport::wheelEvent(QWheelEvent *event) {
         }
     } else {
         switchToFreeCamera();
-        _model.viewSettings().freeCamera()->AdjustDistance(1.f - std::max(-0.5f, std::min(0.5f, (float(event->angleDelta().y()) / 1000.f))));
+        _lastWheelTime = getCurrentTimeInSeconds();
+        freeCamera()->AdjustDistance(1.f - std::max(-0.5f, std::min(0.5f, (float(event->angleDelta().y()) / 1000.f))));
     }
 }
 
 void Viewport::_stageReplaced() {
     if (_model.stage()) {
+        _stageReplacedNs = Profiler::now();
+        _firstPixelFrame = 0;
+        _firstPixelNs = -1;
         _stageIsZup = (pxr::UsdGeomGetStageUpAxis(_model.stage()) == pxr::UsdGeomTokens->z);
-        auto camera = _createNewFreeCamera(_model.viewSettings(), _stageIsZup);
-        _model.viewSettings().setFreeCamera(camera);
+        _pickIndex.setStage(_model.stage());
+        _startTimeCode = _model.stage()->GetStartTimeCode();
+        _endTimeCode = _model.stage()->GetEndTimeCode();
+        _timeCodesPerSecond = _model.stage()->GetTimeCodesPerSecond();
+        _startTimeInSeconds = 0;
+        _flipbook.setRange(_startTimeCode, _endTimeCode);
+        _playbackLog.clear();
+        setFreeCamera(_createNewFreeCamera(_model.viewSettings(), _stageIsZup));
         updateView(true, true);
+        if (_primary) {
+            // Textures in view are read first, while Hydra populates the new stage.
+            auto frustum = resolveCamera().first.GetFrustum();
+            _model.texturePrefetcher().start(_model.stage(),
+                                             frustum.ComputeViewMatrix() * frustum.ComputeProjectionMatrix());
+        }
 
-        HdDriver driver{HgiTokens->renderDriver, VtValue(_hgi.get())};
-        _engine = std::make_unique<pxr::UsdImagingGLEngine>(driver);
-        _engine->SetEnablePresentation(false);
-        _engine->SetRendererAov(HdAovTokens->color);
+        // The engine is shared and was replaced by the render context.
+        _engineReplaced();
     }
 }
 
+void Viewport::_engineReplaced() {
+    _idBuffer.invalidate();
+    _depthProbe.invalidate();
+    _flipbook.invalidate();
+
+    // The new engine starts from defaults, everything has to be pushed again.
+    _pushedRenderBufferSize.reset();
+    _pushedFraming.reset();
+    _pushedWindowPolicy.reset();
+    _pushedLightPosition.reset();
+    _renderStateDirty = true;
+}
+
 void Viewport::_processBBoxes() {
     // Determine if any bbox should be enabled
     auto enableBBoxes = _model.viewSettings().showBBoxes() && (_model.viewSettings().showBBoxPlayback() || !_model.playing());
@@ -6,6 +6,7 @@
 
 #include "windows.h"
 #include "editor/framerate.h"
+#include "editor/profiler.h"
 #include "panels/stage_tree.h"
 #include "panels/render_settings.h"
 #include "panels/view_settings_view.h"
@@ -25,6 +26,7 @@
 #include <QMessageBox>
 #include <QDesktopServices>
 #include <QFileDialog>
+#include <QInputDialog>
 
 namespace vox {
 namespace {
@@ -51,6 +53,17 @@ Windows::Windows(int width, int height)
     _initUI();
     _initMenuBar();
     _loadStylesheet();
+    connect(&model, &DataModel::signalStageReplaced, this, [this]() {
+        if (model.stage()) {
+            shaderWarmup.noteStage(model.stage()->GetRootLayer()->GetRealPath());
+        }
+        cardBaker.setStage(model.stage());
+    });
+    connect(&model.viewSettings(), &ViewSettingsDataModel::signalSettingChanged, this, [this]() {
+        auto current = model.stage() ? model.stage()->GetRootLayer()->GetRealPath() : std::string();
+        shaderWarmup.setEnabled(model.viewSettings().shaderWarmup(), current);
+        cardBaker.setEnabled(model.viewSettings().cardImpostors());
+    });
     // default scene
     model.setStage(pxr::UsdStage::Open(fmt::format("{}/{}", PROJECT_PATH, "assets/Kitchen_set/Kitchen_set.usd")));
 }
@@ -59,6 +72,20 @@ void Windows::run() {
     show();
     while (isVisible()) {
         viewport->draw();
+        if (splitViewport) {
+            splitViewport->draw();
+        }
+        // Warming compiles on the main thread, so it waits while the user plays or drags.
+        if (shaderWarmup.active() && !model.playing() && QApplication::mouseButtons() == Qt::NoButton) {
+            shaderWarmup.step(viewport->renderParams());
+        }
+        // Cards render on the main thread too; one model per idle pass.
+        if (cardBaker.active() && !model.playing() && QApplication::mouseButtons() == Qt::NoButton) {
+            cardBaker.step(viewport->renderParams());
+        }
+        cardBaker.sync(renderContext.screenSizeLod());
+        // After every view ended its frame, so nothing being encoded refers to them.
+        renderContext.freeRetired();
         QApplication::processEvents();
     }
 }
@@ -73,9 +100,12 @@ void Windows::_initUI() {
     setDockOptions(QMainWindow::AllowNestedDocks | QMainWindow::AllowTabbedDocks);
     setDockNestingEnabled(true);
 
-    viewport = new Viewport(this, model);
-    setCentralWidget(viewport);
+    viewSplitter = new QSplitter(Qt::Horizontal, this);
+    viewport = new Viewport(viewSplitter, model, renderContext);
+    viewSplitter->addWidget(viewport);
+    setCentralWidget(viewSplitter);
     viewport->setFocus();
+    _connectViewport(viewport);
 
     // region Tree
     {
@@ -112,14 +142,127 @@ void Windows::_initUI() {
     }
 }
 
+void Windows::_connectViewport(Viewport *view) {
+    connect(view, &Viewport::signalPrimSelected, this,
+            [this](pxr::SdfPath primPath, int instanceIndex, pxr::SdfPath instancerPath, pxr::HdInstancerContext,
+                   pxr::GfVec3d point, Qt::MouseButton button, Qt::KeyboardModifiers modifiers) {
+                if (button != Qt::LeftButton) {
+                    return;
+                }
+                // Point instancer hits select the instance on the instancer.
+                auto path = instancerPath.IsEmpty() ? primPath : instancerPath;
+                auto instance = instancerPath.IsEmpty() ? ALL_INSTANCES : instanceIndex;
+                auto extend = modifiers & (Qt::ShiftModifier | Qt::ControlModifier);
+                if (path.IsEmpty()) {
+                    if (!extend) {
+                        model.selection().clearPrims();
+                    }
+                } else if (extend) {
+                    model.selection().togglePrimPath(path, instance);
+                } else {
+                    model.selection().setPrimPath(path, instance);
+                }
+                model.selection().setPoint(pxr::GfVec3f(point));
+            });
+    connect(view, &Viewport::signalPrimsRegionSelected, this,
+            [this](const std::vector<std::pair<pxr::SdfPath, int>> &paths, Qt::KeyboardModifiers modifiers) {
+                if (modifiers & (Qt::ShiftModifier | Qt::ControlModifier)) {
+                    model.selection().togglePrimPaths(paths);
+                } else {
+                    model.selection().setPrimPaths(paths);
+                }
+            });
+    connect(view, &Viewport::signalPrimRollover, this,
+            [this](pxr::SdfPath primPath, int instanceIndex, pxr::SdfPath instancerPath, pxr::HdInstancerContext,
+                   pxr::GfVec3d, Qt::KeyboardModifiers) {
+                if (primPath.IsEmpty()) {
+                    l_status->clear();
+                } else if (instancerPath.IsEmpty()) {
+                    l_status->setText(QString::fromStdString(primPath.GetString()));
+                } else {
+                    l_status->setText(QString::fromStdString(
+                        fmt::format("{} (instance {} of {})", primPath.GetString(), instanceIndex, instancerPath.GetString())));
+                }
+            });
+}
+
 void Windows::_initMenuBar() {
     auto file_menu = menuBar()->addMenu("&File");
+    auto view_menu = menuBar()->addMenu("&View");
+    auto debug_menu = menuBar()->addMenu("&Debug");
     auto help_menu = menuBar()->addMenu("&Help");
 
     {
         auto load_geo = new QAction("Load Geometry...", this);
         connect(load_geo, &QAction::triggered, this, &Windows::loadGeometryTriggered);
         file_menu->addAction(load_geo);
+
+        auto generate_proxies = new QAction("Generate Proxy Meshes...", this);
+        connect(generate_proxies, &QAction::triggered, this, &Windows::generateProxiesTriggered);
+        file_menu->addAction(generate_proxies);
+        file_menu->addSeparator();
+
+        auto save_screenshot = new QAction("Save Screenshot...", this);
+        connect(save_screenshot, &QAction::triggered, this, &Windows::saveScreenshotTriggered);
+        file_menu->addAction(save_screenshot);
+
+        auto capture_sequence = new QAction("Capture Sequence...", this);
+        connect(capture_sequence, &QAction::triggered, this, &Windows::captureSequenceTriggered);
+        file_menu->addAction(capture_sequence);
+    }
+    {
+        auto split_view = new QAction("Split View", this);
+        split_view->setCheckable(true);
+        connect(split_view, &QAction::toggled, this, &Windows::_setSplitView);
+        view_menu->addAction(split_view);
+
+        // The second view draws the same scene in its own mode, without a second copy of it.
+        auto draw_mode_menu = view_menu->addMenu("Split View Draw Mode");
+        auto draw_mode_group = new QActionGroup(this);
+        auto add_draw_mode = [&](const QString &name, std::optional<RenderModes> mode) {
+            auto action = new QAction(name, draw_mode_group);
+            action->setCheckable(true);
+            action->setChecked(mode == splitRenderMode);
+            connect(action, &QAction::triggered, this, [this, mode]() {
+                splitRenderMode = mode;
+                if (splitViewport) {
+                    splitViewport->setRenderMode(mode);
+                }
+            });
+            draw_mode_menu->addAction(action);
+        };
+        add_draw_mode("Same as Main View", std::nullopt);
+        draw_mode_menu->addSeparator();
+        for (int i = 0; i < int(RenderModes::Count); ++i) {
+            auto mode = RenderModes(i);
+            add_draw_mode(QString::fromStdString(to_constants(mode)), mode);
+        }
+    }
+    {
+        auto profiling_action = new QAction("Record Frame Timings", this);
+        profiling_action->setCheckable(true);
+        profiling_action->setChecked(Profiler::enabled());
+        connect(profiling_action, &QAction::toggled, this, [](bool checked) {
+            Profiler::instance().setEnabled(checked);
+        });
+        debug_menu->addAction(profiling_action);
+
+        auto export_trace = new QAction("Export Frame Trace...", this);
+        connect(export_trace, &QAction::triggered, this, &Windows::exportFrameTraceTriggered);
+        debug_menu->addAction(export_trace);
+        debug_menu->addSeparator();
+
+        auto playback_log_action = new QAction("Record Playback Log", this);
+        playback_log_action->setCheckable(true);
+        playback_log_action->setChecked(viewport->playbackLog().enabled());
+        connect(playback_log_action, &QAction::toggled, this, [this](bool checked) {
+            viewport->playbackLog().setEnabled(checked);
+        });
+        debug_menu->addAction(playback_log_action);
+
+        auto export_playback_log = new QAction("Export Playback Log...", this);
+        connect(export_playback_log, &QAction::triggered, this, &Windows::exportPlaybackLogTriggered);
+        debug_menu->addAction(export_playback_log);
     }
     {
         auto homepage_action = new QAction("HydraViewer Homepage...", this);
@@ -152,6 +295,22 @@ void Windows::_initMenuBar() {
     }
 }
 
+void Windows::_setSplitView(bool enabled) {
+    if (enabled == (splitViewport != nullptr)) {
+        return;
+    }
+    if (enabled) {
+        splitViewport = new Viewport(viewSplitter, model, renderContext, false);
+        splitViewport->setRenderMode(splitRenderMode);
+        viewSplitter->addWidget(splitViewport);
+        viewSplitter->setSizes({viewSplitter->width() / 2, viewSplitter->width() / 2});
+        _connectViewport(splitViewport);
+    } else {
+        delete splitViewport;
+        splitViewport = nullptr;
+    }
+}
+
 void Windows::_showAboutTriggered() {
     QString info = fmt::format("<p>Version: {}<p><p>&nbsp;</p>", _version).c_str();
     info += "<p><a href='https://github.com/ArcheGraphics/HydraViewer' style='color:#ffffff;'>Homepage...</a></p>";
@@ -195,4 +354,76 @@ void Windows::loadGeometryTriggered() {
     model.setStage(pxr::UsdStage::Open(path.toStdString()));
 }
 
+void Windows::saveScreenshotTriggered() {
+    auto path = QFileDialog::getSaveFileName(this, "Save screenshot", QString(),
+                                             "Images (*.png *.jpg *.exr)");
+    if (!path.isEmpty()) {
+        viewport->grabFrameBuffer(path.toStdString());
+    }
+}
+
+void Windows::captureSequenceTriggered() {
+    auto directory = QFileDialog::getExistingDirectory(this, "Capture sequence to");
+    if (directory.isEmpty()) {
+        return;
+    }
+    bool ok = false;
+    auto frameCount = QInputDialog::getInt(this, "Capture Sequence", "Frames:", 100, 1, 100000, 1, &ok);
+    if (ok) {
+        viewport->captureSequence(directory.toStdString(), frameCount);
+    }
+}
+
+void Windows::generateProxiesTriggered() {
+    if (!model.stage()) {
+        return;
+    }
+    bool ok = false;
+    auto ratio = QInputDialog::getDouble(this, "Generate Proxy Meshes", "Triangles kept:", 0.1, 0.01, 1.0, 2, &ok);
+    if (!ok) {
+        return;
+    }
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    auto &generator = model.proxyGenerator();
+    auto saved = generator.generate(float(ratio));
+    // The LOD filter learns which models have proxies when the engine is created.
+    renderContext.rebuildEngine();
+    QApplication::restoreOverrideCursor();
+
+    const auto &stats = generator.stats();
+    if (!saved) {
+        QMessageBox::warning(this, "Generate Proxy Meshes",
+                             QString("Failed to write %1").arg(QString::fromStdString(generator.sidecarPath())));
+        return;
+    }
+    QMessageBox::information(this, "Generate Proxy Meshes",
+                             QString::fromStdString(fmt::format("{} meshes: {} simplified, {} from the cache.\n"
+                                                                "{} triangles down to {}.\nSaved to {}",
+                                                                stats.meshes, stats.generated, stats.cached,
+                                                                stats.trianglesBefore, stats.trianglesAfter,
+                                                                generator.sidecarPath())));
+}
+
+void Windows::exportFrameTraceTriggered() {
+    auto path = QFileDialog::getSaveFileName(this, "Export frame trace", "frame_trace.json",
+                                             "Chrome trace (*.json)");
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!Profiler::instance().writeChromeTrace(path.toStdString())) {
+        QMessageBox::warning(this, "Export Frame Trace", QString("Failed to write %1").arg(path));
+    }
+}
+
+void Windows::exportPlaybackLogTriggered() {
+    auto path = QFileDialog::getSaveFileName(this, "Export playback log", "playback_log.csv",
+                                             "CSV (*.csv)");
+    if (path.isEmpty()) {
+        return;
+    }
+    if (!viewport->playbackLog().writeCsv(path.toStdString())) {
+        QMessageBox::warning(this, "Export Playback Log", QString("Failed to write %1").arg(path));
+    }
+}
+
 }// namespace vox
\ No newline at end of file
@@ -8,8 +8,11 @@
 
 #include <QMainWindow>
 #include <QLabel>
+#include <QSplitter>
 #include <QtNodes/GraphicsView>
 #include "editor/viewport/viewport.h"
+#include "editor/viewport/shader_warmup.h"
+#include "editor/viewport/card_baker.h"
 #include "editor/model/data_model.h"
 
 namespace vox {
@@ -21,19 +24,38 @@ public:
 
 private:
     DataModel model;
+    RenderContext renderContext{model};
+    ShaderWarmup shaderWarmup{renderContext};
+    CardBaker cardBaker{renderContext};
 
     QDockWidget *stage_tree_dock_widget{};
     QLabel *l_status{};
 
     vox::Viewport *viewport{};
+    QSplitter *viewSplitter{};
+    /// Second view of the stage, sharing the engine of the first.
+    vox::Viewport *splitViewport{};
+    std::optional<RenderModes> splitRenderMode{RenderModes::WIREFRAME};
 
     void _loadStylesheet();
     void _initUI();
     void _initMenuBar();
+    void _connectViewport(Viewport *view);
+    void _setSplitView(bool enabled);
     QtNodes::GraphicsView *_create_node_graph();
     void _showAboutTriggered();
     float _version{0.01};
 
     void loadGeometryTriggered();
+
+    void saveScreenshotTriggered();
+
+    void captureSequenceTriggered();
+
+    void generateProxiesTriggered();
+
+    void exportFrameTraceTriggered();
+
+    void exportPlaybackLogTriggered();
 };
 }// namespace vox
\ No newline at end of file